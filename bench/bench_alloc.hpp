@@ -0,0 +1,17 @@
+#pragma once
+
+#include "alloc_counter.hpp"
+
+#include <benchmark/benchmark.h>
+
+// Reports the allocations and heap bytes of a single iteration
+inline auto reportAllocations(
+    benchmark::State& state,
+    const AllocationCount& before,
+    const AllocationCount& after
+) -> void {
+    auto iterations = static_cast<double>(state.iterations());
+    state.counters["allocs"] = static_cast<double>(after.allocations - before.allocations)
+        / iterations;
+    state.counters["bytes"] = static_cast<double>(after.bytes - before.bytes) / iterations;
+}
@@ -0,0 +1,381 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_alloc.hpp"
+
+#include <fwcompact.hpp>
+#include <fwfinder.hpp>
+#include <usbdef.hpp>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+// Internal to src/fwfinder.cpp
+auto _generateUniqueIDFromUSBPortChain(const std::vector<uint32_t>& usbPortChain) -> uint64_t;
+
+// Full discovery against whatever is attached to the host running the benchmark.
+// Arg 0 is the platform default backend (libudev on Linux), 1 walks sysfs directly.
+static void BM_FindAll(benchmark::State& state) {
+    const auto options = Fw::FindOptions {
+        .backend = static_cast<Fw::FindBackend>(state.range(0)),
+        .root = {},
+        .stats = nullptr,
+        .threads = 1,
+        .stop = {},
+    };
+    size_t deviceCount = 0;
+    for (auto _: state) {
+        auto devices = Fw::find_all(options);
+        if (!devices.has_value()) {
+            state.SkipWithError(devices.error().c_str());
+            break;
+        }
+        deviceCount = devices.value().size();
+        benchmark::DoNotOptimize(devices);
+    }
+    state.counters["devices"] = static_cast<double>(deviceCount);
+}
+BENCHMARK(BM_FindAll)
+    ->ArgName("backend")
+    ->Arg(static_cast<int64_t>(Fw::FindBackend::Default))
+#ifdef __linux__
+    ->Arg(static_cast<int64_t>(Fw::FindBackend::Sysfs))
+#endif
+    ->Unit(benchmark::kMillisecond);
+
+// Every FreeWili VID/PID plus a couple of unrelated devices, at the locations discovery sees them
+static const std::array<std::array<uint32_t, 3>, 12> usbDeviceTypeInputs = { {
+    { Fw::USB_VID_FW_HUB, Fw::USB_PID_FW_HUB, 0 },
+    { Fw::USB_VID_FW_FTDI, Fw::USB_PID_FW_FTDI, 3 },
+    { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_CDC_PID, 1 },
+    { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_CDC_PID, 2 },
+    { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_2350_UF2_PID, 0 },
+    { Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB, 1 },
+    { Fw::USB_VID_FW2_MAIN, Fw::USB_PID_FW2_MAIN, 1 },
+    { Fw::USB_VID_FW2_DEBUG_PROBE, Fw::USB_PID_FW2_DEBUG_PROBE, 4 },
+    { Fw::USB_VID_FW2_ESP32, Fw::USB_PID_FW2_ESP32_JTAG, 5 },
+    { Fw::USB_VID_FW2_MASS_STORAGE, Fw::USB_PID_FW2_MASS_STORAGE, 6 },
+    { 0x046D, 0xC31C, 2 },
+    { 0x1D6B, 0x0002, 1 },
+} };
+
+static void BM_GetUSBDeviceTypeFrom(benchmark::State& state) {
+    for (auto _: state) {
+        for (const auto& [vid, pid, location]: usbDeviceTypeInputs) {
+            benchmark::DoNotOptimize(Fw::getUSBDeviceTypeFrom(
+                static_cast<uint16_t>(vid),
+                static_cast<uint16_t>(pid),
+                location
+            ));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * std::ssize(usbDeviceTypeInputs));
+}
+BENCHMARK(BM_GetUSBDeviceTypeFrom);
+
+static void BM_GenerateUniqueIDFromUSBPortChain(benchmark::State& state) {
+    // Bus 3, then hubs down to the requested depth
+    std::vector<uint32_t> portChain = { 3 };
+    for (int64_t depth = 1; depth < state.range(0); ++depth) {
+        portChain.push_back(static_cast<uint32_t>(depth % 7 + 1));
+    }
+    for (auto _: state) {
+        benchmark::DoNotOptimize(_generateUniqueIDFromUSBPortChain(portChain));
+    }
+}
+BENCHMARK(BM_GenerateUniqueIDFromUSBPortChain)->Arg(1)->Arg(3)->Arg(7);
+
+// The FREE-WILi2 stack as discovery hands it to fromUSBDevices(), hub last
+static auto makeFreeWili2USBDevices() -> Fw::USBDevices {
+    auto usbDevice = [](Fw::USBDeviceType kind,
+                        uint16_t vid,
+                        uint16_t pid,
+                        std::string name,
+                        std::string serial,
+                        uint32_t location) {
+        return Fw::USBDevice {
+            .kind = kind,
+            .vid = vid,
+            .pid = pid,
+            .name = std::move(name),
+            .serial = std::move(serial),
+            .location = location,
+            .portChain = location == 0 ? std::vector<uint32_t> { 3, 4 }
+                                       : std::vector<uint32_t> { 3, 4, location },
+            .paths = kind == Fw::USBDeviceType::MassStorage
+                ? std::optional<std::vector<std::string>>({ "/media/fw/FX0025" })
+                : std::nullopt,
+            .port = kind == Fw::USBDeviceType::MassStorage
+                ? std::nullopt
+                : std::optional<std::string>("/dev/ttyACM" + std::to_string(location)),
+            ._raw = "/sys/devices/pci0000:00/0000:00:14.0/usb3/3-4/3-4."
+                + std::to_string(location),
+        };
+    };
+    return {
+        usbDevice(
+            Fw::USBDeviceType::SerialMain,
+            Fw::USB_VID_FW2_MAIN,
+            Fw::USB_PID_FW2_MAIN,
+            "FW2 v07",
+            "FX0025",
+            1
+        ),
+        usbDevice(
+            Fw::USBDeviceType::FTDI,
+            Fw::USB_VID_FW2_FTDI,
+            Fw::USB_PID_FW2_FTDI,
+            "FREE-WILi FW2",
+            "FX0025",
+            3
+        ),
+        usbDevice(
+            Fw::USBDeviceType::DebugProbe,
+            Fw::USB_VID_FW2_DEBUG_PROBE,
+            Fw::USB_PID_FW2_DEBUG_PROBE,
+            "FreeWili Debug Probe (CMSIS-DAP)",
+            "E66568714F28A828",
+            4
+        ),
+        usbDevice(
+            Fw::USBDeviceType::ESP32,
+            Fw::USB_VID_FW2_ESP32,
+            Fw::USB_PID_FW2_ESP32_JTAG,
+            "USB JTAG/serial debug unit",
+            "3C:DC:75:9A:BB:40",
+            5
+        ),
+        usbDevice(
+            Fw::USBDeviceType::MassStorage,
+            Fw::USB_VID_FW2_MASS_STORAGE,
+            Fw::USB_PID_FW2_MASS_STORAGE,
+            "FW Ultra Fast Media",
+            "0000395D5D4D",
+            6
+        ),
+        usbDevice(
+            Fw::USBDeviceType::Hub,
+            Fw::USB_VID_FW2_HUB,
+            Fw::USB_PID_FW2_HUB,
+            "FREE-WILi2",
+            "FX0025",
+            0
+        ),
+    };
+}
+
+static void BM_FromUSBDevices_FreeWili2(benchmark::State& state) {
+    const auto usbDevices = makeFreeWili2USBDevices();
+    for (auto _: state) {
+        auto device = Fw::FreeWiliDevice::fromUSBDevices(usbDevices);
+        if (!device.has_value()) {
+            state.SkipWithError(device.error().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(device);
+    }
+}
+BENCHMARK(BM_FromUSBDevices_FreeWili2);
+
+static void BM_FromUSBDevices_Standalone(benchmark::State& state) {
+    const Fw::USBDevices usbDevices = { Fw::USBDevice {
+        .kind = Fw::USBDeviceType::MassStorage,
+        .vid = Fw::USB_VID_FW_RPI,
+        .pid = Fw::USB_PID_FW_RPI_2350_UF2_PID,
+        .name = "Raspberry Pi RP2350 Boot",
+        .serial = "E0C9125B0D9B",
+        .location = 2,
+        .portChain = { 3, 2 },
+        .paths = std::vector<std::string> { "/media/RP2350" },
+        .port = std::nullopt,
+        ._raw = "/sys/devices/pci0000:00/0000:00:14.0/usb3/3-2",
+    } };
+    for (auto _: state) {
+        auto device = Fw::FreeWiliDevice::fromUSBDevices(usbDevices);
+        if (!device.has_value()) {
+            state.SkipWithError(device.error().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(device);
+    }
+}
+BENCHMARK(BM_FromUSBDevices_Standalone);
+
+// Arg 0 filters a single type, 1 a list of types, 2 returns everything
+static void BM_GetUSBDevices(benchmark::State& state) {
+    auto device = Fw::FreeWiliDevice::fromUSBDevices(makeFreeWili2USBDevices());
+    if (!device.has_value()) {
+        state.SkipWithError(device.error().c_str());
+        return;
+    }
+    const std::vector<Fw::USBDeviceType> types = {
+        Fw::USBDeviceType::SerialMain,
+        Fw::USBDeviceType::FTDI,
+        Fw::USBDeviceType::MassStorage,
+    };
+    for (auto _: state) {
+        switch (state.range(0)) {
+            case 0:
+                benchmark::DoNotOptimize(device->getUSBDevices(Fw::USBDeviceType::SerialMain));
+                break;
+            case 1:
+                benchmark::DoNotOptimize(device->getUSBDevices(types));
+                break;
+            default:
+                benchmark::DoNotOptimize(device->getUSBDevices());
+                break;
+        }
+    }
+}
+BENCHMARK(BM_GetUSBDevices)->ArgName("filter")->Arg(0)->Arg(1)->Arg(2);
+
+static void BM_GetMainUSBDevice(benchmark::State& state) {
+    auto device = Fw::FreeWiliDevice::fromUSBDevices(makeFreeWili2USBDevices());
+    if (!device.has_value()) {
+        state.SkipWithError(device.error().c_str());
+        return;
+    }
+    for (auto _: state) {
+        benchmark::DoNotOptimize(device->getMainUSBDevice());
+    }
+}
+BENCHMARK(BM_GetMainUSBDevice);
+
+// Same filters as BM_GetUSBDevices without copying, 2 walks the whole span
+static void BM_ViewUSBDevices(benchmark::State& state) {
+    auto device = Fw::FreeWiliDevice::fromUSBDevices(makeFreeWili2USBDevices());
+    if (!device.has_value()) {
+        state.SkipWithError(device.error().c_str());
+        return;
+    }
+    for (auto _: state) {
+        size_t count = 0;
+        if (state.range(0) == 0) {
+            for (const auto& usbDevice: device->viewUSBDevices(Fw::USBDeviceType::SerialMain)) {
+                benchmark::DoNotOptimize(&usbDevice);
+                ++count;
+            }
+        } else {
+            for (const auto& usbDevice: device->viewUSBDevices()) {
+                benchmark::DoNotOptimize(&usbDevice);
+                ++count;
+            }
+        }
+        benchmark::DoNotOptimize(count);
+    }
+}
+BENCHMARK(BM_ViewUSBDevices)->ArgName("filter")->Arg(0)->Arg(2);
+
+static void BM_FindMainUSBDevice(benchmark::State& state) {
+    auto device = Fw::FreeWiliDevice::fromUSBDevices(makeFreeWili2USBDevices());
+    if (!device.has_value()) {
+        state.SkipWithError(device.error().c_str());
+        return;
+    }
+    for (auto _: state) {
+        benchmark::DoNotOptimize(device->findMainUSBDevice());
+    }
+}
+BENCHMARK(BM_FindMainUSBDevice);
+
+// What discovery does once the USBDevices of every board are enumerated: build the devices,
+// collect them and sort them by uniqueID. Arg 0 hands fromUSBDevices() a copy, 1 moves.
+static void BM_BuildSortedDevices(benchmark::State& state) {
+    const size_t boardCount = 16;
+    std::vector<Fw::USBDevices> boards;
+    // Reverse uniqueID order, the sort has to move every device
+    for (size_t i = boardCount; i > 0; --i) {
+        auto usbDevices = makeFreeWili2USBDevices();
+        for (auto& usbDevice: usbDevices) {
+            usbDevice.portChain[0] = static_cast<uint32_t>(i);
+        }
+        boards.push_back(std::move(usbDevices));
+    }
+    const bool move = state.range(0) != 0;
+    size_t allocations = 0;
+    for (auto _: state) {
+        state.PauseTiming();
+        auto enumerated = boards;
+        Fw::FreeWiliDevices devices;
+        devices.reserve(boardCount);
+        state.ResumeTiming();
+        auto before = allocationCount();
+        for (auto& usbDevices: enumerated) {
+            auto device = move ? Fw::FreeWiliDevice::fromUSBDevices(std::move(usbDevices))
+                               : Fw::FreeWiliDevice::fromUSBDevices(usbDevices);
+            if (device.has_value()) {
+                devices.push_back(std::move(device.value()));
+            }
+        }
+        std::sort(devices.begin(), devices.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.uniqueID < rhs.uniqueID;
+        });
+        allocations += allocationCount().allocations - before.allocations;
+        benchmark::DoNotOptimize(devices);
+    }
+    state.counters["allocs_per_device"] = static_cast<double>(allocations)
+        / (static_cast<double>(state.iterations()) * static_cast<double>(boardCount));
+}
+BENCHMARK(BM_BuildSortedDevices)->ArgName("move")->Arg(0)->Arg(1);
+
+// count FREE-WILi2 stacks on distinct root ports, each with its own serials
+static auto makeFreeWili2Snapshot(size_t count) -> Fw::FreeWiliDevices {
+    Fw::FreeWiliDevices devices;
+    for (size_t i = 0; i < count; ++i) {
+        auto usbDevices = makeFreeWili2USBDevices();
+        for (auto& usbDevice: usbDevices) {
+            usbDevice.portChain[0] = static_cast<uint32_t>(i + 1);
+            usbDevice.serial += std::to_string(i);
+            usbDevice._raw += "." + std::to_string(i);
+        }
+        if (auto device = Fw::FreeWiliDevice::fromUSBDevices(usbDevices); device.has_value()) {
+            devices.push_back(std::move(device.value()));
+        }
+    }
+    return devices;
+}
+
+// What every DiscoveryCache::find_all() caller pays for its own copy
+static void BM_CopySnapshot(benchmark::State& state) {
+    const auto devices = makeFreeWili2Snapshot(static_cast<size_t>(state.range(0)));
+    auto before = allocationCount();
+    for (auto _: state) {
+        auto copy = devices;
+        benchmark::DoNotOptimize(copy);
+    }
+    reportAllocations(state, before, allocationCount());
+}
+BENCHMARK(BM_CopySnapshot)->ArgName("devices")->Arg(1)->Arg(8);
+
+static void BM_CopyCompactSnapshot(benchmark::State& state) {
+    auto compact =
+        Fw::CompactDevices::from(makeFreeWili2Snapshot(static_cast<size_t>(state.range(0))));
+    if (!compact.has_value()) {
+        state.SkipWithError(compact.error().c_str());
+        return;
+    }
+    auto before = allocationCount();
+    for (auto _: state) {
+        auto copy = compact.value();
+        benchmark::DoNotOptimize(copy);
+    }
+    reportAllocations(state, before, allocationCount());
+    state.counters["memoryUsage"] = static_cast<double>(compact->memoryUsage());
+}
+BENCHMARK(BM_CopyCompactSnapshot)->ArgName("devices")->Arg(1)->Arg(8);
+
+static void BM_CompactDevicesFrom(benchmark::State& state) {
+    const auto devices = makeFreeWili2Snapshot(static_cast<size_t>(state.range(0)));
+    auto before = allocationCount();
+    for (auto _: state) {
+        auto compact = Fw::CompactDevices::from(devices);
+        if (!compact.has_value()) {
+            state.SkipWithError(compact.error().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(compact);
+    }
+    reportAllocations(state, before, allocationCount());
+}
+BENCHMARK(BM_CompactDevicesFrom)->ArgName("devices")->Arg(1)->Arg(8);
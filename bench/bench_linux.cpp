@@ -0,0 +1,441 @@
+#include <benchmark/benchmark.h>
+
+#include <fwcache.hpp>
+#include <fwcompact.hpp>
+#include <fwfinder.hpp>
+#include <fwfinder_linux.hpp>
+#include <usbdef.hpp>
+
+#include "bench_alloc.hpp"
+#include "sysfs_fixture.hpp"
+
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+
+// Builds a DeviceTable with hubCount FREE-WILi2 boards spread over root hubs, each
+// root hub also carrying an unrelated keyboard so the scan has non-FreeWili noise.
+static auto makeSyntheticTable(size_t hubCount) -> DeviceTable {
+    const std::string controller = "/sys/devices/pci0000:00/0000:00:14.0";
+    const uint32_t portsPerRootHub = 8;
+    DeviceTable table;
+
+    auto addNode = [&](const std::string& parent,
+                       const std::string& name,
+                       uint16_t vid,
+                       uint16_t pid,
+                       std::vector<uint32_t> portChain,
+                       const std::string& serial) -> std::string {
+        std::string syspath = parent + "/" + name;
+        table.usbDevices.push_back(UsbNode {
+            .syspath = syspath,
+            .parentSyspath = parent == controller ? "" : parent,
+            .vid = vid,
+            .pid = pid,
+            .manufacturer = "Intrepid Control Systems, Inc.",
+            .product = "FREE-WILi2",
+            .serial = serial,
+            .location = portChain.back(),
+            .portChain = portChain,
+        });
+        return syspath;
+    };
+
+    for (size_t i = 0; i < hubCount; ++i) {
+        auto bus = static_cast<uint32_t>(i / portsPerRootHub + 1);
+        auto port = static_cast<uint32_t>(i % portsPerRootHub + 1);
+        auto busName = std::to_string(bus);
+        auto rootHub = controller + "/usb" + busName;
+        if (port == 1) {
+            addNode(controller, "usb" + busName, 0x1D6B, 0x0002, { bus }, "");
+            addNode(rootHub, busName + "-9", 0x046D, 0xC31C, { bus, 9 }, "");
+        }
+        auto serial = "FX" + std::to_string(1000 + i);
+        auto hubName = busName + "-" + std::to_string(port);
+        auto hub = addNode(
+            rootHub,
+            hubName,
+            Fw::USB_VID_FW2_HUB,
+            Fw::USB_PID_FW2_HUB,
+            { bus, port },
+            serial
+        );
+        auto child = [&](uint32_t hubPort, uint16_t vid, uint16_t pid) {
+            return addNode(
+                hub,
+                hubName + "." + std::to_string(hubPort),
+                vid,
+                pid,
+                { bus, port, hubPort },
+                serial
+            );
+        };
+        auto main = child(1, Fw::USB_VID_FW2_MAIN, Fw::USB_PID_FW2_MAIN);
+        auto ftdi = child(3, Fw::USB_VID_FW2_FTDI, Fw::USB_PID_FW2_FTDI);
+        child(4, Fw::USB_VID_FW2_DEBUG_PROBE, Fw::USB_PID_FW2_DEBUG_PROBE);
+        child(5, Fw::USB_VID_FW2_ESP32, Fw::USB_PID_FW2_ESP32_JTAG);
+        auto storage = child(6, Fw::USB_VID_FW2_MASS_STORAGE, Fw::USB_PID_FW2_MASS_STORAGE);
+
+        table.serialPorts.push_back(SerialInfo {
+            .devPath = main,
+            .ttyName = "/dev/ttyACM" + std::to_string(i),
+        });
+        table.serialPorts.push_back(SerialInfo {
+            .devPath = ftdi,
+            .ttyName = "/dev/ttyUSB" + std::to_string(i),
+        });
+        table.disks.push_back(DiskInfo {
+            .devPath = storage,
+            .diskName = "/dev/sd" + std::to_string(i),
+            .blockDevices = { BlockDevice {
+                .devNum = static_cast<dev_t>(i),
+                .devNode = "/dev/sd" + std::to_string(i),
+            } },
+            .mountPoints = { "/media/fw/" + serial },
+        });
+    }
+    return table;
+}
+
+// Hub discovery over an in-memory table, isolates the hub -> children resolution from udev.
+static void BM_FindAllFreeWili_SyntheticHubs(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    const auto table = makeSyntheticTable(hubCount);
+    for (auto _: state) {
+        const auto index = _buildDeviceIndex(table);
+        auto devices = _find_all_freewili(table, index);
+        if (devices.size() != hubCount) {
+            state.SkipWithError("Unexpected number of FreeWili devices");
+            break;
+        }
+        benchmark::DoNotOptimize(devices);
+    }
+    state.SetComplexityN(state.range(0));
+    state.counters["usb_devices"] = static_cast<double>(table.usbDevices.size());
+}
+BENCHMARK(BM_FindAllFreeWili_SyntheticHubs)
+    ->Arg(1)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(500)
+    ->Unit(benchmark::kMicrosecond)
+    ->Complexity();
+
+// End to end sysfs discovery over a generated tree, file system reads included.
+static void BM_FindAllSysfsFixture(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_" + std::to_string(hubCount));
+    addFreeWili2Farm(sysfs, hubCount);
+    const auto options = sysfs.options();
+    for (auto _: state) {
+        auto devices = Fw::find_all(options);
+        if (!devices.has_value() || devices.value().size() != hubCount) {
+            state.SkipWithError("Unexpected number of FreeWili devices");
+            break;
+        }
+        benchmark::DoNotOptimize(devices);
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_FindAllSysfsFixture)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(500)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity();
+
+// BM_FindAllSysfsFixture counting allocations, arg(1) packs the result into an arena
+static void BM_FindAllSysfsArena(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_arena_" + std::to_string(hubCount));
+    addFreeWili2Farm(sysfs, hubCount);
+    const auto options = sysfs.options();
+    std::vector<std::byte> buffer(256 * 1024);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+    auto before = allocationCount();
+    for (auto _: state) {
+        size_t found = 0;
+        if (state.range(1) == 0) {
+            auto devices = Fw::find_all(options);
+            found = devices.has_value() ? devices->size() : 0;
+        } else {
+            auto devices = Fw::find_all(&arena, options);
+            found = devices.has_value() ? devices->devices().size() : 0;
+        }
+        // The whole snapshot goes in one call, the next one reuses the buffer
+        arena.release();
+        if (found != hubCount) {
+            state.SkipWithError("Unexpected number of FreeWili devices");
+            break;
+        }
+    }
+    reportAllocations(state, before, allocationCount());
+}
+BENCHMARK(BM_FindAllSysfsArena)
+    ->ArgNames({ "hubs", "arena" })
+    ->Args({ 10, 0 })
+    ->Args({ 10, 1 })
+    ->Args({ 100, 0 })
+    ->Args({ 100, 1 })
+    ->Unit(benchmark::kMillisecond);
+
+// Single board lookup over the same trees as BM_FindAllSysfsFixture, the last board by uniqueID
+// is asked for so every board ahead of it is built and rejected.
+static void BM_FindBySerialSysfsFixture(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_lookup_" + std::to_string(hubCount));
+    addFreeWili2Farm(sysfs, hubCount);
+    auto options = sysfs.options();
+    const auto serial = Fw::find_all(options).value().back().serial;
+    for (auto _: state) {
+        auto device = Fw::find_by_serial(serial, options);
+        if (!device.has_value()) {
+            state.SkipWithError(device.error().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(device);
+    }
+    state.SetComplexityN(state.range(0));
+    Fw::FindStats stats;
+    options.stats = &stats;
+    benchmark::DoNotOptimize(Fw::find_by_serial(serial, options));
+    state.counters["attribute_reads"] = static_cast<double>(stats.attributeReads);
+}
+BENCHMARK(BM_FindBySerialSysfsFixture)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(500)
+    ->Unit(benchmark::kMillisecond)
+    ->Complexity();
+
+// Post-flash re-attach check of one board over the BM_FindAllSysfsFixture trees, should stay
+// flat as boards are added.
+static void BM_RefreshSysfsFixture(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_refresh_" + std::to_string(hubCount));
+    addFreeWili2Farm(sysfs, hubCount);
+    const auto options = sysfs.options();
+    auto device = Fw::find_all(options).value().back();
+    for (auto _: state) {
+        if (auto refreshed = Fw::refresh(device, options); !refreshed.has_value()) {
+            state.SkipWithError(refreshed.error().c_str());
+            break;
+        }
+        benchmark::DoNotOptimize(device);
+    }
+}
+BENCHMARK(BM_RefreshSysfsFixture)->Arg(10)->Arg(100)->Arg(500)->Unit(benchmark::kMicrosecond);
+
+// Repeated snapshots of an unchanged tree, the staleness check alone. Captured trees compare
+// directory listings, the live host polls a udev monitor instead (BM_DiscoveryCacheLiveHit).
+static void BM_DiscoveryCacheSysfsHit(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_cache_" + std::to_string(hubCount));
+    addFreeWili2Farm(sysfs, hubCount);
+    Fw::DiscoveryCache cache(sysfs.options());
+    benchmark::DoNotOptimize(cache.snapshot());
+    for (auto _: state) {
+        auto snapshot = cache.snapshot();
+        if (!snapshot.has_value() || snapshot.value()->generation != 1) {
+            state.SkipWithError("Unexpected rescan");
+            break;
+        }
+        benchmark::DoNotOptimize(snapshot);
+    }
+}
+BENCHMARK(BM_DiscoveryCacheSysfsHit)->Arg(10)->Arg(100)->Arg(500)->Unit(benchmark::kMicrosecond);
+
+static void BM_DiscoveryCacheLiveHit(benchmark::State& state) {
+    Fw::DiscoveryCache cache;
+    if (auto snapshot = cache.snapshot(); !snapshot.has_value()) {
+        state.SkipWithError(snapshot.error().c_str());
+        return;
+    }
+    for (auto _: state) {
+        benchmark::DoNotOptimize(cache.snapshot());
+    }
+}
+BENCHMARK(BM_DiscoveryCacheLiveHit);
+
+// A workstation: 4 FREE-WILi2 boards among arg USB devices that aren't FreeWilis, a third each
+// keyboards, serial adapters and mounted USB sticks behind a 7 port hub.
+static void BM_FindAllSysfsForeignDevices(benchmark::State& state) {
+    const auto foreignCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_foreign_" + std::to_string(foreignCount));
+    addFreeWili2Farm(sysfs, 4);
+    const std::string usb2 = "devices/pci0000:00/0000:00:14.0/usb2";
+    sysfs.usbDevice(usb2, 0x1D6B, 0x0002, "0000:00:14.0", "xHCI Host Controller");
+    for (size_t i = 0; i < foreignCount; ++i) {
+        const auto hub = usb2 + "/2-" + std::to_string(i / 7 + 1);
+        if (i % 7 == 0) {
+            sysfs.usbDevice(hub, 0x05E3, 0x0610, "", "USB2.1 Hub");
+        }
+        const auto name = hub.substr(hub.rfind('/') + 1) + "." + std::to_string(i % 7 + 1);
+        const auto path = hub + "/" + name;
+        if (i % 3 == 0) {
+            sysfs.usbDevice(path, 0x046D, 0xC31C, "", "USB Keyboard");
+        } else if (i % 3 == 1) {
+            sysfs.usbDevice(path, 0x067B, 0x2303, "", "USB-Serial Controller");
+            sysfs.ftdiPort(path, name + ":1.0", "ttyUSB" + std::to_string(100 + i));
+        } else {
+            sysfs.usbDevice(path, 0x0781, 0x5581, "4C53" + std::to_string(i), "Ultra");
+            const auto disk = "sdf" + std::string(1, static_cast<char>('a' + i % 26))
+                + std::string(1, static_cast<char>('a' + i / 26 % 26));
+            sysfs.disk(path, disk, static_cast<unsigned int>(1024 + i * 16), "/media/" + disk);
+        }
+    }
+    auto options = sysfs.options();
+    for (auto _: state) {
+        auto devices = Fw::find_all(options);
+        if (!devices.has_value() || devices.value().size() != 4) {
+            state.SkipWithError("Unexpected number of FreeWili devices");
+            break;
+        }
+        benchmark::DoNotOptimize(devices);
+    }
+    Fw::FindStats stats;
+    options.stats = &stats;
+    benchmark::DoNotOptimize(Fw::find_all(options));
+    state.counters["visited"] = static_cast<double>(stats.devicesVisited);
+    state.counters["attribute_reads"] = static_cast<double>(stats.attributeReads);
+    state.counters["matched"] = static_cast<double>(stats.usbDevicesMatched);
+}
+BENCHMARK(BM_FindAllSysfsForeignDevices)
+    ->Arg(0)
+    ->Arg(30)
+    ->Arg(150)
+    ->Unit(benchmark::kMillisecond);
+
+// BM_FindAllSysfsFixture with the attribute reads spread over arg(1) threads
+static void BM_FindAllSysfsThreads(benchmark::State& state) {
+    const auto hubCount = static_cast<size_t>(state.range(0));
+    SysfsFixture sysfs("bench_threads_" + std::to_string(hubCount));
+    addFreeWili2Farm(sysfs, hubCount);
+    const auto options = sysfs.options(nullptr, static_cast<size_t>(state.range(1)));
+    for (auto _: state) {
+        auto devices = Fw::find_all(options);
+        if (!devices.has_value() || devices.value().size() != hubCount) {
+            state.SkipWithError("Unexpected number of FreeWili devices");
+            break;
+        }
+        benchmark::DoNotOptimize(devices);
+    }
+}
+BENCHMARK(BM_FindAllSysfsThreads)
+    ->ArgNames({ "hubs", "threads" })
+    ->Args({ 200, 1 })
+    ->Args({ 200, 2 })
+    ->Args({ 200, 4 })
+    ->Args({ 200, 8 })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Time from the hotplug notification becoming readable to _waitForDevice() returning a mounted
+// RP2350 UF2 drive, the notification being a byte written to a pipe in place of the udev
+// monitor socket. Covers the poll() wake-up, decoding the batch and rebuilding the owner.
+static void BM_WaitForWakeUpLatency(benchmark::State& state) {
+    const std::string uf2 = "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2";
+    const std::string disk = uf2 + "/1-2:1.0/host0/target0:0:0/0:0:0:0/block/sda";
+    const std::vector<TopologyEvent> plug {
+        TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = uf2,
+            .device =
+                UsbNode {
+                    .syspath = uf2,
+                    .parentSyspath = "",
+                    .vid = Fw::USB_VID_FW_RPI,
+                    .pid = Fw::USB_PID_FW_RPI_2350_UF2_PID,
+                    .manufacturer = "Raspberry Pi",
+                    .product = "RP2350 Boot",
+                    .serial = "E0C9125B0D9B",
+                    .location = 2,
+                    .portChain = { 1, 2 },
+                },
+        },
+        TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = disk,
+            .device =
+                DiskInfo {
+                    .devPath = uf2,
+                    .diskName = "/dev/sda",
+                    .blockDevices = {
+                        BlockDevice { .devNum = makedev(8, 0), .devNode = "/dev/sda" },
+                    },
+                    .mountPoints = {},
+                },
+        },
+        TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = disk + "/sda1",
+            .device =
+                PartitionInfo {
+                    .diskSyspath = disk,
+                    .blockDevice = BlockDevice { .devNum = makedev(8, 1), .devNode = "/dev/sda1" },
+                },
+        },
+    };
+    std::istringstream mountInfo("412 22 8:1 / /media/fw/RP2350 rw - vfat /dev/sda1 rw\n");
+    const auto mounts = _parseMountInfo(mountInfo);
+
+    int pipeFds[2];
+    if (::pipe(pipeFds) != 0) {
+        state.SkipWithError("pipe() failed");
+        return;
+    }
+    const TopologyWaitSources sources {
+        .eventFd = pipeFds[0],
+        .mountInfoFd = -1,
+        .drain =
+            [&] {
+                char byte;
+                benchmark::DoNotOptimize(::read(pipeFds[0], &byte, 1));
+                return plug;
+            },
+        .readMounts = [&] { return mounts; },
+    };
+    auto mountedUF2 = [](const Fw::FreeWiliDevice& device) {
+        auto storage = device.getUSBDevices(Fw::USBDeviceType::MassStorage);
+        return device.deviceType == Fw::DeviceType::UF2 && !storage.empty()
+            && !storage[0].paths.value_or(std::vector<std::string> {}).empty();
+    };
+
+    for (auto _: state) {
+        DeviceTopology topology;
+        std::chrono::steady_clock::time_point notified;
+        std::thread plugger([&] {
+            // Long enough for the waiter to be blocked in poll()
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            notified = std::chrono::steady_clock::now();
+            benchmark::DoNotOptimize(::write(pipeFds[1], "x", 1));
+        });
+        auto device = _waitForDevice(
+            topology,
+            sources,
+            mountedUF2,
+            std::chrono::steady_clock::now() + std::chrono::seconds(5)
+        );
+        const auto woken = std::chrono::steady_clock::now();
+        plugger.join();
+        if (!device.has_value()) {
+            state.SkipWithError(device.error().c_str());
+            break;
+        }
+        state.SetIterationTime(std::chrono::duration<double>(woken - notified).count());
+    }
+    ::close(pipeFds[0]);
+    ::close(pipeFds[1]);
+}
+BENCHMARK(BM_WaitForWakeUpLatency)->UseManualTime()->Unit(benchmark::kMicrosecond);
+
+#endif // __linux__
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <usbdef.hpp>
+
+#include <array>
+#include <utility>
+
+// Arg 0 looks up known FreeWili pairs, 1 pairs that aren't whitelisted (the common case
+// when scanning a host full of keyboards, hubs and webcams)
+static void BM_IsVidPidWhitelisted(benchmark::State& state) {
+    static const std::array<std::pair<uint16_t, uint16_t>, 6> whitelisted = { {
+        { Fw::USB_VID_FW_HUB, Fw::USB_PID_FW_HUB },
+        { Fw::USB_VID_FW_FTDI, Fw::USB_PID_FW_FTDI },
+        { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_2350_UF2_PID },
+        { Fw::USB_VID_FW2_ESP32, Fw::USB_PID_FW2_ESP32_JTAG },
+        { Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_WINKY },
+        { Fw::USB_VID_FW2_MASS_STORAGE, Fw::USB_PID_FW2_MASS_STORAGE },
+    } };
+    static const std::array<std::pair<uint16_t, uint16_t>, 6> unknown = { {
+        { 0x046D, 0xC31C },
+        { 0x1D6B, 0x0002 },
+        { 0x05E3, 0x0610 },
+        { 0x8087, 0x0026 },
+        { Fw::USB_VID_FW_ICS, 0x0001 },
+        { Fw::USB_VID_FW_RPI, 0xFFFF },
+    } };
+    const auto& pairs = state.range(0) == 0 ? whitelisted : unknown;
+    for (auto _: state) {
+        for (const auto& [vid, pid]: pairs) {
+            benchmark::DoNotOptimize(Fw::is_vid_pid_whitelisted(vid, pid));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pairs.size()));
+}
+BENCHMARK(BM_IsVidPidWhitelisted)->ArgName("unknown")->Arg(0)->Arg(1);
+
+static void BM_IsFreeWiliHub(benchmark::State& state) {
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Fw::is_freewili_hub(Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB));
+        benchmark::DoNotOptimize(Fw::is_freewili_hub(0x05E3, 0x0610));
+    }
+}
+BENCHMARK(BM_IsFreeWiliHub);
+
+// Discovery asks this of every usb_device on the host, most of which aren't FreeWilis
+static void BM_IsStandAloneDevice(benchmark::State& state) {
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Fw::isStandAloneDevice(Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_WINKY));
+        benchmark::DoNotOptimize(Fw::isStandAloneDevice(0x046D, 0xC31C));
+    }
+}
+BENCHMARK(BM_IsStandAloneDevice);
@@ -1,6 +1,7 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/optional.h>
+#include <nanobind/stl/pair.h>
 #include <nanobind/stl/vector.h>
 
 #include <fwfinder.hpp>
@@ -22,6 +23,48 @@ auto find_all() -> Fw::FreeWiliDevices {
     }
 }
 
+auto find_all_with_stats() -> std::pair<Fw::FreeWiliDevices, Fw::FindStats> {
+    Fw::FindStats stats;
+    const auto options = Fw::FindOptions {
+        .backend = Fw::FindBackend::Default,
+        .root = {},
+        .stats = &stats,
+        .threads = 1,
+        .stop = {},
+    };
+    if (auto devicesResult = Fw::find_all(options); !devicesResult.has_value()) {
+        PyErr_SetString(PyExc_RuntimeError, devicesResult.error().c_str());
+        throw nb::python_error();
+    } else {
+        return { std::move(devicesResult.value()), stats };
+    }
+}
+
+auto find_by_serial(const std::string& serial) -> Fw::FreeWiliDevice {
+    if (auto deviceResult = Fw::find_by_serial(serial); !deviceResult.has_value()) {
+        PyErr_SetString(PyExc_RuntimeError, deviceResult.error().c_str());
+        throw nb::python_error();
+    } else {
+        return std::move(deviceResult.value());
+    }
+}
+
+auto find_by_unique_id(uint64_t uniqueID) -> Fw::FreeWiliDevice {
+    if (auto deviceResult = Fw::find_by_unique_id(uniqueID); !deviceResult.has_value()) {
+        PyErr_SetString(PyExc_RuntimeError, deviceResult.error().c_str());
+        throw nb::python_error();
+    } else {
+        return std::move(deviceResult.value());
+    }
+}
+
+auto refresh(Fw::FreeWiliDevice& device) -> void {
+    if (auto result = Fw::refresh(device); !result.has_value()) {
+        PyErr_SetString(PyExc_RuntimeError, result.error().c_str());
+        throw nb::python_error();
+    }
+}
+
 NB_MODULE(pyfwfinder, m) {
     nb::enum_<Fw::USBDeviceType>(m, "USBDeviceType")
         .value("Hub", Fw::USBDeviceType::Hub)
@@ -172,9 +215,42 @@ NB_MODULE(pyfwfinder, m) {
                 PyErr_SetString(PyExc_RuntimeError, result.error().c_str());
                 throw nb::python_error();
             }
-        });
+        })
+        .def("get_mass_storage_paths", &Fw::FreeWiliDevice::getMassStoragePaths);
+
+    // Durations are exposed in nanoseconds, datetime.timedelta stops at microseconds
+    nb::class_<Fw::FindStats>(m, "FindStats")
+        .def(nb::init<>())
+        .def_prop_ro(
+            "enumerate_time_ns",
+            [](const Fw::FindStats& self) { return self.enumerateTime.count(); }
+        )
+        .def_prop_ro(
+            "mount_time_ns",
+            [](const Fw::FindStats& self) { return self.mountTime.count(); }
+        )
+        .def_prop_ro(
+            "resolve_time_ns",
+            [](const Fw::FindStats& self) { return self.resolveTime.count(); }
+        )
+        .def_prop_ro(
+            "build_time_ns",
+            [](const Fw::FindStats& self) { return self.buildTime.count(); }
+        )
+        .def_prop_ro(
+            "total_time_ns",
+            [](const Fw::FindStats& self) { return self.totalTime.count(); }
+        )
+        .def_ro("devices_visited", &Fw::FindStats::devicesVisited)
+        .def_ro("attribute_reads", &Fw::FindStats::attributeReads)
+        .def_ro("usb_devices_matched", &Fw::FindStats::usbDevicesMatched)
+        .def_ro("devices_found", &Fw::FindStats::devicesFound);
 
     m.def("find_all", &find_all);
+    m.def("find_all_with_stats", &find_all_with_stats);
+    m.def("find_by_serial", &find_by_serial, nb::arg("serial"));
+    m.def("find_by_unique_id", &find_by_unique_id, nb::arg("unique_id"));
+    m.def("refresh", &refresh, nb::arg("device"));
     m.def("get_device_type_name", &Fw::getDeviceTypeName);
     m.def("get_usb_device_type_name", &Fw::getUSBDeviceTypeName);
 }
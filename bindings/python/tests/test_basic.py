@@ -59,7 +59,33 @@ def test_freewilidevice() -> None:
     assert hasattr(pyfwfinder.FreeWiliDevice, "get_fpga_usb_device")
     assert hasattr(pyfwfinder.FreeWiliDevice, "get_debug_probe_usb_device")
     assert hasattr(pyfwfinder.FreeWiliDevice, "get_hub_usb_device")
+    assert hasattr(pyfwfinder.FreeWiliDevice, "get_mass_storage_paths")
 
+def test_findall_with_stats() -> None:
+    devices, stats = pyfwfinder.find_all_with_stats()
+    assert stats.devices_found == len(devices)
+    assert stats.total_time_ns > 0
+    assert hasattr(stats, "enumerate_time_ns")
+    assert hasattr(stats, "mount_time_ns")
+    assert hasattr(stats, "resolve_time_ns")
+    assert hasattr(stats, "build_time_ns")
+    assert hasattr(stats, "devices_visited")
+    assert hasattr(stats, "attribute_reads")
+    assert hasattr(stats, "usb_devices_matched")
+
+def test_find_by_serial() -> None:
+    for device in pyfwfinder.find_all():
+        assert pyfwfinder.find_by_serial(device.serial).unique_id == device.unique_id
+        assert pyfwfinder.find_by_unique_id(device.unique_id).serial == device.serial
+    with pytest.raises(RuntimeError):
+        pyfwfinder.find_by_serial("not a FreeWili serial")
+
+def test_refresh() -> None:
+    assert hasattr(pyfwfinder, "refresh")
+    for device in pyfwfinder.find_all():
+        unique_id = device.unique_id
+        pyfwfinder.refresh(device)
+        assert device.unique_id == unique_id
 
 
 if __name__ == "__main__":
@@ -67,3 +93,4 @@ if __name__ == "__main__":
     test_usbdevicetype()
     test_usbdevice()
     test_freewilidevice()
+    test_findall_with_stats()
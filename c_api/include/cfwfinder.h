@@ -126,6 +126,11 @@ typedef uint32_t fw_usbdevice_iter_set_t;
  *
  * This type is used to represent a USB device in the C API.
  * It is an opaque type, meaning its internal structure is not exposed.
+ *
+ * A fw_freewili_device_t* is a handle, not an address, and must never be dereferenced.
+ * A device keeps its handle across finds for as long as it stays plugged in. Handles of
+ * devices that were unplugged or freed are rejected with fw_error_invalid_device, even
+ * once their slot is reused.
  */
 typedef struct fw_freewili_device_t fw_freewili_device_t;
 
@@ -155,11 +160,56 @@ CFW_FINDER_API fw_error_t fw_device_find_all(
     uint32_t* error_message_size
 );
 
+/**
+ * @brief Timings and counters of a find call.
+ * Mirrors Fw::FindStats, phases a platform doesn't break down stay at zero.
+ * @see fw_device_find_all_with_stats
+ */
+typedef struct fw_find_stats_t {
+    /// Enumerating USB, serial and block devices, attribute reads included
+    uint64_t enumerate_ns;
+    /// Reading the mount table and matching it to disks
+    uint64_t mount_ns;
+    /// Indexing the enumeration and walking the hub children
+    uint64_t resolve_ns;
+    /// Building devices out of their USB devices
+    uint64_t build_ns;
+    /// The whole find call
+    uint64_t total_ns;
+    /// Devices handed over by the enumeration
+    uint64_t devices_visited;
+    /// udev sysattr or sysfs attribute reads
+    uint64_t attribute_reads;
+    /// USB devices kept for discovery
+    uint64_t usb_devices_matched;
+    /// FreeWiLi devices found
+    uint64_t devices_found;
+} fw_find_stats_t;
+
+/**
+ * @brief Finds all available FreeWiLi devices and reports where the time went.
+ * Same as fw_device_find_all, stats is filled in when the call succeeds.
+ * @param[out] devices See fw_device_find_all.
+ * @param[in,out] count See fw_device_find_all.
+ * @param[out] error_message See fw_device_find_all.
+ * @param[out] error_message_size See fw_device_find_all.
+ * @param[out] stats Pointer to a fw_find_stats_t to fill in, NULL to skip measuring.
+ * @return fw_error_t
+ * @see fw_device_find_all
+ */
+CFW_FINDER_API fw_error_t fw_device_find_all_with_stats(
+    fw_freewili_device_t** devices,
+    uint32_t* count,
+    char* const error_message,
+    uint32_t* error_message_size,
+    fw_find_stats_t* stats
+);
+
 /**
  * @brief Checks if a FreeWiLi device is valid.
  *
  * This function checks if the provided FreeWiLi device pointer is valid and initialized.
- * It returns true if the device is valid, false otherwise.
+ * It returns true if the device is valid, false otherwise. Runs in constant time.
  *
  * @param device Pointer to the fw_freewili_device_t to be checked.
  *
@@ -265,6 +315,8 @@ CFW_FINDER_API fw_error_t fw_device_unique_id(fw_freewili_device_t* device, uint
     *
     * @note This function must be called before calling fw_usb_device_next to retrieve USB devices.
     *       It sets up the internal state of the device to start enumerating USB devices.
+    *       That state belongs to the calling thread, threads walking the same device don't
+    *       move each other's position.
     *
     * @see fw_usb_device_next
     * @see fw_usb_device_get_str
@@ -407,6 +459,297 @@ CFW_FINDER_API fw_error_t fw_usb_device_get_port_chain(
     uint32_t* port_chain_size
 );
 
+/**
+ * @brief Opaque type owning a table of FreeWiLi devices and their handles.
+ *
+ * The fw_device_* and fw_usb_device_* functions work on one process-wide context. The
+ * fw_context_* ones take their own, so that independent users don't share handles.
+ *
+ * Every function of a context is thread-safe. Finds and frees are serialized, scan
+ * included, so the last find to return is the one readers see. Readers never wait on
+ * them: they use the devices of the last completed find, which stay alive until the read
+ * is done even when a concurrent find or free drops them. Readers never write to a
+ * context, the USB devices of a device are read by index instead of through a cursor,
+ * from 0 to fw_context_usb_device_count().
+ *
+ * @code{.c}
+ *
+ * fw_context_t* context = NULL;
+ * fw_freewili_device_t* devices[16];
+ * uint32_t count = 16;
+ * if (fw_context_create(&context) == fw_error_success) {
+ *     fw_context_find_all(context, devices, &count, NULL, NULL, NULL);
+ *     fw_context_destroy(context);
+ * }
+ * @endcode
+ */
+typedef struct fw_context_t fw_context_t;
+
+/**
+ * @brief Creates an empty context.
+ *
+ * @param[out] context Set to the new context, NULL on failure.
+ *
+ * @return fw_error_success, fw_error_invalid_parameter when context is NULL, or
+ * fw_error_memory when it couldn't be allocated.
+ *
+ * @see fw_context_destroy
+ */
+CFW_FINDER_API fw_error_t fw_context_create(fw_context_t** context);
+
+/**
+ * @brief Destroys a context and frees all of its devices.
+ *
+ * No other thread may use the context or its devices anymore.
+ *
+ * @param context Context made by fw_context_create().
+ *
+ * @return fw_error_success, or fw_error_invalid_parameter when context is NULL.
+ */
+CFW_FINDER_API fw_error_t fw_context_destroy(fw_context_t* context);
+
+/**
+ * @brief Finds all available FreeWiLi devices into a context.
+ *
+ * Devices found by a previous find of the same context keep their handle, the ones that
+ * are gone are freed. Readers using the previous devices carry on undisturbed.
+ *
+ * @param context Context to find into.
+ * @param[out] devices Array of at least count handles, filled with the devices found.
+ * @param[in,out] count Size of devices, set to the number of handles written.
+ * @param[out] error_message Buffer for the error message when the find fails.
+ * @param[in,out] error_message_size Size of error_message, set to the length written.
+ * @param[out] stats Timings and counters of the find, NULL to skip measuring.
+ *
+ * @return fw_error_success, fw_error_invalid_parameter when context, devices or count is
+ * NULL, fw_error_internal_error when the find failed, or fw_error_memory.
+ *
+ * @see fw_context_device_free
+ */
+CFW_FINDER_API fw_error_t fw_context_find_all(
+    fw_context_t* context,
+    fw_freewili_device_t** devices,
+    uint32_t* count,
+    char* const error_message,
+    uint32_t* error_message_size,
+    fw_find_stats_t* stats
+);
+
+/**
+ * @brief Checks if a handle refers to a device of a context. Runs in constant time.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle to check.
+ *
+ * @return true if the device is valid, false for NULL, freed or made up handles.
+ */
+CFW_FINDER_API bool
+fw_context_device_is_valid(fw_context_t* context, fw_freewili_device_t* device);
+
+/**
+ * @brief Frees devices of a context.
+ *
+ * Readers still using a freed device keep it alive until they are done.
+ *
+ * @param context Context the devices were found into.
+ * @param[in,out] devices Handles to free, each set to NULL. NULL with count 0 frees every
+ * device of the context.
+ * @param count Number of handles in devices.
+ *
+ * @return fw_error_success, fw_error_invalid_parameter when only one of devices and count
+ * is given, or fw_error_memory.
+ */
+CFW_FINDER_API fw_error_t
+fw_context_device_free(fw_context_t* context, fw_freewili_device_t** devices, uint32_t count);
+
+/**
+ * @brief Retrieves a string value from a device of a context.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param str_type fw_stringtype_name, fw_stringtype_serial or fw_stringtype_type.
+ * @param[out] value Buffer where the string is stored.
+ * @param[in,out] value_size Size of value, set to the length written.
+ *
+ * @return fw_error_success, fw_error_invalid_device for a stale handle, fw_error_memory
+ * when value is too small, or fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_device_get_str(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    fw_stringtype_t str_type,
+    char* const value,
+    uint32_t* value_size
+);
+
+/**
+ * @brief Retrieves the type of a device of a context.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param[out] device_type Set to the type of the device.
+ *
+ * @return fw_error_success, fw_error_invalid_device for a stale handle, or
+ * fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_device_get_type(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    fw_devicetype_t* device_type
+);
+
+/**
+ * @brief Determines if a device of a context is standalone, not behind a FreeWiLi hub.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param[out] is_standalone Set to true for a standalone device.
+ *
+ * @return fw_error_success, fw_error_invalid_device for a stale handle, or
+ * fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_device_is_standalone(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    bool* is_standalone
+);
+
+/**
+ * @brief Retrieves the unique ID of a device of a context.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param[out] unique_id Set to the unique ID, stable for as long as the device stays on
+ * the same USB port.
+ *
+ * @return fw_error_success, fw_error_invalid_device for a stale handle, or
+ * fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_device_unique_id(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint64_t* unique_id
+);
+
+/**
+ * @brief Provides the number of USB devices of a device of a context.
+ *
+ * The fw_context_usb_device_*_at() functions take an index below it.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param[out] count Set to the number of USB devices.
+ *
+ * @return fw_error_success, fw_error_invalid_device for a stale handle, or
+ * fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t
+fw_context_usb_device_count(fw_context_t* context, fw_freewili_device_t* device, uint32_t* count);
+
+/**
+ * @brief Finds the index of the main, display, FPGA or hub USB device of a device.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param iter_set Which USB device to look for.
+ * @param[out] index Set to the index of the USB device.
+ * @param[out] error_message Buffer for the reason the USB device wasn't found.
+ * @param[in,out] error_message_size Size of error_message, set to the length written.
+ *
+ * @return fw_error_success, fw_error_no_more_devices when the device has no such USB
+ * device, fw_error_invalid_device for a stale handle, or fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_usb_device_index_of(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    fw_usbdevice_iter_set_t iter_set,
+    uint32_t* index,
+    char* const error_message,
+    uint32_t* error_message_size
+);
+
+/**
+ * @brief Retrieves the type of the USB device at index.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param index USB device, below fw_context_usb_device_count().
+ * @param[out] usb_device_type Set to the type of the USB device.
+ *
+ * @return fw_error_success, fw_error_no_more_devices when index is past the end,
+ * fw_error_invalid_device for a stale handle, or fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_type_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    fw_usbdevicetype_t* usb_device_type
+);
+
+/**
+ * @brief Retrieves a string value from the USB device at index.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param index USB device, below fw_context_usb_device_count().
+ * @param str_type The type of string to retrieve.
+ * @param[out] value Buffer where the string is stored.
+ * @param[in,out] value_size Size of value, set to the length written.
+ *
+ * @return fw_error_success, fw_error_none when the USB device has no such path or port,
+ * fw_error_no_more_devices when index is past the end, fw_error_invalid_device for a
+ * stale handle, fw_error_memory when value is too small, or fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_str_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    fw_stringtype_t str_type,
+    char* const value,
+    uint32_t* value_size
+);
+
+/**
+ * @brief Retrieves an integer value from the USB device at index.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param index USB device, below fw_context_usb_device_count().
+ * @param int_type The type of integer to retrieve (VID, PID, location).
+ * @param[out] value Set to the integer.
+ *
+ * @return fw_error_success, fw_error_no_more_devices when index is past the end,
+ * fw_error_invalid_device for a stale handle, or fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_int_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    fw_inttype_t int_type,
+    uint32_t* value
+);
+
+/**
+ * @brief Retrieves the port chain of the USB device at index.
+ *
+ * @param context Context the device was found into.
+ * @param device Handle of the device.
+ * @param index USB device, below fw_context_usb_device_count().
+ * @param[out] port_chain Buffer where the ports are stored, root hub first.
+ * @param[in,out] port_chain_size Size of port_chain, set to the number of ports written.
+ *
+ * @return fw_error_success, fw_error_no_more_devices when index is past the end,
+ * fw_error_invalid_device for a stale handle, fw_error_memory when port_chain is too
+ * small, or fw_error_invalid_parameter.
+ */
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_port_chain_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    uint32_t* port_chain,
+    uint32_t* port_chain_size
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cfwfinder.h>
+#include <fwfinder.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// What a fw_freewili_device_t handle refers to, immutable once published
+struct DeviceHandleEntry {
+    DeviceHandleEntry(Fw::FreeWiliDevice device, uint64_t scan) noexcept:
+        device(std::move(device)),
+        scan(scan) {}
+
+    const Fw::FreeWiliDevice device;
+
+    /// reconcile() that created the entry, every scan of a device gets a new one
+    const uint64_t scan;
+
+    /// USB device at index, nullptr once past the end
+    auto usbDevice(size_t index) const noexcept -> const Fw::USBDevice* {
+        return index < device.usbDevices.size() ? &device.usbDevices[index] : nullptr;
+    }
+};
+
+/// Layout of a fw_freewili_device_t handle
+struct DeviceHandle {
+    static constexpr int indexBits = std::numeric_limits<uintptr_t>::digits / 2;
+    static constexpr uintptr_t indexMask = (uintptr_t(1) << indexBits) - 1;
+
+    /// Slot indices are stored plus one so no handle is ever NULL
+    static auto encode(uint32_t index, uintptr_t generation) noexcept -> fw_freewili_device_t* {
+        return reinterpret_cast<fw_freewili_device_t*>(
+            (generation << indexBits) | (uintptr_t(index) + 1)
+        );
+    }
+
+    /// Slot index and generation of handle, nullopt for NULL
+    static auto decode(fw_freewili_device_t* handle) noexcept
+        -> std::optional<std::pair<uint32_t, uintptr_t>> {
+        auto value = reinterpret_cast<uintptr_t>(handle);
+        if ((value & indexMask) == 0) {
+            return std::nullopt;
+        }
+        return std::pair { static_cast<uint32_t>((value & indexMask) - 1), value >> indexBits };
+    }
+};
+
+/**
+ * @brief Read-only copy of a DeviceHandleTable.
+ *
+ * Entries are shared with the table, a snapshot keeps the devices it holds alive after the
+ * table freed or replaced them.
+ */
+class DeviceSnapshot {
+public:
+    /// Entry behind handle, nullptr for NULL, freed or made up handles. O(1).
+    auto find(fw_freewili_device_t* handle) const noexcept -> const DeviceHandleEntry* {
+        auto decoded = DeviceHandle::decode(handle);
+        if (!decoded.has_value() || decoded->first >= slots.size()) {
+            return nullptr;
+        }
+        const auto& slot = slots[decoded->first];
+        return slot.generation == decoded->second ? slot.entry.get() : nullptr;
+    }
+
+private:
+    friend class DeviceHandleTable;
+
+    struct Slot {
+        uintptr_t generation = 0;
+        /// nullptr for a free slot
+        std::shared_ptr<const DeviceHandleEntry> entry;
+    };
+
+    std::vector<Slot> slots;
+};
+
+/**
+ * @brief Generational handle table behind the fw_freewili_device_t pointers of the C API.
+ *
+ * A handle is not an address. It packs a slot index, in the low half of the pointer, with
+ * the generation of the slot when the handle was handed out, in the high half. Freeing a
+ * slot bumps its generation, so a stale handle is rejected in O(1) without dereferencing
+ * anything. A device keeps its handle across scans for as long as its uniqueID is found.
+ *
+ * The table isn't thread-safe, readers look handles up in a snapshot() of it instead.
+ *
+ * @code{.cpp}
+ *
+ * DeviceHandleTable table;
+ * std::vector<fw_freewili_device_t*> handles;
+ * table.reconcile(std::move(devices), handles);
+ * if (auto* entry = table.find(handles[0])) {
+ *    std::println("{}", entry->device.serial);
+ * }
+ * @endcode
+ */
+class DeviceHandleTable {
+public:
+    static constexpr size_t maxSlots = DeviceHandle::indexMask - 1;
+
+    /**
+     * @brief Replaces the devices of the table with the ones of a new scan.
+     *
+     * Known uniqueIDs keep their handle and get a new entry. New ones get a slot, the free
+     * slots are reused first. Devices missing from the scan are freed. O(devices + slots).
+     *
+     * @param devices result of the scan
+     * @param handles set to the handle of each device, in devices order
+     * @return false, and the table unchanged, when there are more devices than maxSlots
+     */
+    auto reconcile(Fw::FreeWiliDevices&& devices, std::vector<fw_freewili_device_t*>& handles)
+        -> bool {
+        if (devices.size() > maxSlots) {
+            return false;
+        }
+        ++scan;
+        handles.clear();
+        handles.reserve(devices.size());
+        for (auto& device: devices) {
+            uint32_t index = 0;
+            if (auto it = slotsByUniqueID.find(device.uniqueID); it != slotsByUniqueID.end()) {
+                index = it->second;
+            } else {
+                index = _allocate();
+                slotsByUniqueID.emplace(device.uniqueID, index);
+            }
+            auto& slot = slots[index];
+            slot.entry = std::make_shared<const DeviceHandleEntry>(std::move(device), scan);
+            slot.scan = scan;
+            handles.push_back(DeviceHandle::encode(index, slot.generation));
+        }
+        for (uint32_t index = 0; index < slots.size(); ++index) {
+            if (slots[index].entry && slots[index].scan != scan) {
+                _free(index);
+            }
+        }
+        return true;
+    }
+
+    /// Entry behind handle, nullptr for NULL, freed or made up handles. O(1).
+    auto find(fw_freewili_device_t* handle) const noexcept -> const DeviceHandleEntry* {
+        auto index = _slotOf(handle);
+        return index.has_value() ? slots[index.value()].entry.get() : nullptr;
+    }
+
+    /// Frees the slot of handle, false when handle was already invalid.
+    auto release(fw_freewili_device_t* handle) noexcept -> bool {
+        auto index = _slotOf(handle);
+        if (index.has_value()) {
+            _free(index.value());
+        }
+        return index.has_value();
+    }
+
+    /// Frees every slot, all handles handed out so far become invalid.
+    auto clear() noexcept -> void {
+        for (uint32_t index = 0; index < slots.size(); ++index) {
+            if (slots[index].entry) {
+                _free(index);
+            }
+        }
+    }
+
+    /// Devices currently behind a valid handle
+    auto size() const noexcept -> size_t {
+        return slotsByUniqueID.size();
+    }
+
+    /// Copy of the table for readers, shares its entries. O(slots).
+    auto snapshot() const -> std::shared_ptr<const DeviceSnapshot> {
+        auto snapshot = std::make_shared<DeviceSnapshot>();
+        snapshot->slots.reserve(slots.size());
+        for (const auto& slot: slots) {
+            snapshot->slots.push_back(DeviceSnapshot::Slot {
+                .generation = slot.generation,
+                .entry = slot.entry,
+            });
+        }
+        return snapshot;
+    }
+
+private:
+    struct Slot {
+        /// Bumped when the slot is freed, wraps around after 2^indexBits reuses
+        uintptr_t generation = 0;
+        /// Last reconcile() that found the device
+        uint64_t scan = 0;
+        /// nullptr for a free slot
+        std::shared_ptr<const DeviceHandleEntry> entry;
+    };
+
+    auto _slotOf(fw_freewili_device_t* handle) const noexcept -> std::optional<uint32_t> {
+        auto decoded = DeviceHandle::decode(handle);
+        if (!decoded.has_value() || decoded->first >= slots.size()) {
+            return std::nullopt;
+        }
+        const auto& slot = slots[decoded->first];
+        if (!slot.entry || slot.generation != decoded->second) {
+            return std::nullopt;
+        }
+        return decoded->first;
+    }
+
+    auto _allocate() -> uint32_t {
+        if (!freeSlots.empty()) {
+            auto index = freeSlots.back();
+            freeSlots.pop_back();
+            return index;
+        }
+        slots.emplace_back();
+        // _free() can't fail, every slot has room on the free list
+        freeSlots.reserve(slots.size());
+        return static_cast<uint32_t>(slots.size() - 1);
+    }
+
+    auto _free(uint32_t index) noexcept -> void {
+        auto& slot = slots[index];
+        slotsByUniqueID.erase(slot.entry->device.uniqueID);
+        slot.entry.reset();
+        slot.generation = (slot.generation + 1) & DeviceHandle::indexMask;
+        freeSlots.push_back(index);
+    }
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<uint64_t, uint32_t> slotsByUniqueID;
+    uint64_t scan = 0;
+};
+
+/**
+ * @brief Where the fw_usb_device_* functions are in the USB devices of each handle.
+ *
+ * Each thread owns one, readers never write to the devices they share. A cursor starts at
+ * the first USB device, and over once its device was rescanned.
+ */
+class UsbDeviceCursors {
+public:
+    /**
+     * @brief Cursor of handle, added when missing.
+     *
+     * Cursors of handles no longer in snapshot are dropped before one is added, there are
+     * never more than the devices of the table.
+     *
+     * @return index of the current USB device, nullptr when handle isn't in snapshot
+     */
+    auto find(const DeviceSnapshot& snapshot, fw_freewili_device_t* handle) -> uint32_t* {
+        const auto* entry = snapshot.find(handle);
+        if (entry == nullptr) {
+            cursors.erase(handle);
+            return nullptr;
+        }
+        if (!cursors.contains(handle)) {
+            std::erase_if(cursors, [&](const auto& cursor) {
+                return snapshot.find(cursor.first) == nullptr;
+            });
+        }
+        auto& cursor = cursors[handle];
+        if (cursor.scan != entry->scan) {
+            cursor = Cursor { .scan = entry->scan, .index = 0 };
+        }
+        return &cursor.index;
+    }
+
+    /// Handles with a cursor
+    auto size() const noexcept -> size_t {
+        return cursors.size();
+    }
+
+private:
+    struct Cursor {
+        /// DeviceHandleEntry::scan the cursor was moved on
+        uint64_t scan = 0;
+        uint32_t index = 0;
+    };
+
+    std::unordered_map<fw_freewili_device_t*, Cursor> cursors;
+};
+
+/**
+ * @brief The latest DeviceSnapshot of a table, swapped in RCU style.
+ *
+ * Writers build a new snapshot and publish() it, readers load() whichever is current and
+ * keep it alive for as long as they use it. A reader never waits on a rescan, only on
+ * the pointer swap itself.
+ */
+class PublishedSnapshot {
+public:
+    PublishedSnapshot(): current(std::make_shared<const DeviceSnapshot>()) {}
+
+    auto load() const noexcept -> std::shared_ptr<const DeviceSnapshot> {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        return current.load(std::memory_order_acquire);
+#else
+        std::lock_guard lock(mutex);
+        return current;
+#endif
+    }
+
+    auto publish(std::shared_ptr<const DeviceSnapshot> snapshot) noexcept -> void {
+#if defined(__cpp_lib_atomic_shared_ptr)
+        current.store(std::move(snapshot), std::memory_order_release);
+#else
+        std::lock_guard lock(mutex);
+        current.swap(snapshot);
+#endif
+    }
+
+private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<std::shared_ptr<const DeviceSnapshot>> current;
+#else
+    // The standard library has no std::atomic<std::shared_ptr>, only the swap is guarded
+    mutable std::mutex mutex;
+    std::shared_ptr<const DeviceSnapshot> current;
+#endif
+};
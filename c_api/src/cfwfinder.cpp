@@ -1,23 +1,69 @@
 #include <cfwfinder.h>
+#include <cfwfinder_handles.hpp>
 #include <cfwfinder_internal.hpp>
 #include <fwfinder.hpp>
 #include <algorithm>
-#include <memory>
+#include <expected>
+#include <mutex>
+#include <new>
+#include <vector>
 
 using namespace Fw;
 
-typedef struct fw_freewili_device_t {
-    FreeWiliDevice device;
+struct fw_context_t {
+    /// Serializes the writers, finds and frees, held across the scan
+    std::mutex writer;
+    DeviceHandleTable table;
+    /// Handles of the last find, in find_all() order
+    std::vector<fw_freewili_device_t*> handles;
+    /// What readers look handles up in, without ever taking writer. The snapshot a reader
+    /// loaded keeps its devices alive until the reader is done, even across a rescan or free.
+    PublishedSnapshot snapshot;
+};
+
+// Backs the functions that don't take a context
+static auto defaultContext() -> fw_context_t* {
+    static fw_context_t context;
+    return &context;
+}
 
-    // Iterator for USB devices.
-    USBDevices::iterator usbDevicesIter = device.usbDevices.begin();
+// Cursor of this thread for device, in the process-wide context
+static auto legacyCursor(fw_freewili_device_t* device) -> std::expected<uint32_t*, fw_error_t> {
+    if (device == nullptr) {
+        return std::unexpected(fw_error_invalid_parameter);
+    }
+    thread_local UsbDeviceCursors cursors;
+    try {
+        auto* cursor = cursors.find(*defaultContext()->snapshot.load(), device);
+        if (cursor == nullptr) {
+            return std::unexpected(fw_error_invalid_device);
+        }
+        return cursor;
+    } catch (const std::bad_alloc&) {
+        return std::unexpected(fw_error_memory);
+    }
+}
 
-    bool operator==(const FreeWiliDevice& other) const noexcept {
-        return device == other;
+CFW_FINDER_API fw_error_t fw_context_create(fw_context_t** context) {
+    if (context == nullptr) {
+        return fw_error_invalid_parameter;
+    }
+    try {
+        *context = new fw_context_t;
+    } catch (const std::bad_alloc&) {
+        *context = nullptr;
+        return fw_error_memory;
     }
-} fw_freewili_device_t;
+    return fw_error_success;
+}
 
-static std::vector<std::shared_ptr<fw_freewili_device_t>> fw_devices;
+CFW_FINDER_API fw_error_t fw_context_destroy(fw_context_t* context) {
+    if (context == nullptr) {
+        return fw_error_invalid_parameter;
+    }
+    delete context;
+    return fw_error_success;
+}
 
 CFW_FINDER_API fw_error_t fw_device_find_all(
     fw_freewili_device_t** devices,
@@ -25,11 +71,55 @@ CFW_FINDER_API fw_error_t fw_device_find_all(
     char* const error_message,
     uint32_t* error_message_size
 ) {
-    if (devices == nullptr || count == nullptr) {
+    return fw_context_find_all(
+        defaultContext(),
+        devices,
+        count,
+        error_message,
+        error_message_size,
+        nullptr
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_device_find_all_with_stats(
+    fw_freewili_device_t** devices,
+    uint32_t* count,
+    char* const error_message,
+    uint32_t* error_message_size,
+    fw_find_stats_t* stats
+) {
+    return fw_context_find_all(
+        defaultContext(),
+        devices,
+        count,
+        error_message,
+        error_message_size,
+        stats
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_context_find_all(
+    fw_context_t* context,
+    fw_freewili_device_t** devices,
+    uint32_t* count,
+    char* const error_message,
+    uint32_t* error_message_size,
+    fw_find_stats_t* stats
+) {
+    if (context == nullptr || devices == nullptr || count == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    auto found_fw_devices = find_all();
+    // Taken before the scan, an older scan can't publish over a newer one
+    std::lock_guard lock(context->writer);
+    FindStats findStats;
+    auto found_fw_devices = find_all(FindOptions {
+        .backend = FindBackend::Default,
+        .root = {},
+        .stats = stats ? &findStats : nullptr,
+        .threads = 1,
+        .stop = {},
+    });
     if (!found_fw_devices.has_value()) {
         if (error_message == nullptr || error_message_size == nullptr) {
             return fw_error_invalid_parameter;
@@ -43,95 +133,81 @@ CFW_FINDER_API fw_error_t fw_device_find_all(
         }
     }
 
-    // Add or update the found devices
-    for (const auto& device: found_fw_devices.value()) {
-        if (std::none_of(
-                fw_devices.begin(),
-                fw_devices.end(),
-                [&device](const std::shared_ptr<fw_freewili_device_t> fw_device) {
-                    return *fw_device == device;
-                }
-            ))
-        {
-            // Device not found in the existing list, add it
-            fw_devices.push_back(std::make_shared<fw_freewili_device_t>(device));
-        } else {
-            // Device already exists, update its information
-            auto it = std::find_if(
-                fw_devices.begin(),
-                fw_devices.end(),
-                [&device](const std::shared_ptr<fw_freewili_device_t> fw_device) {
-                    return *fw_device == device;
-                }
-            );
-            if (it != fw_devices.end()) {
-                (*it)->device = device; // Update the device information
-            }
+    // Known devices keep their handle, the others are freed
+    try {
+        if (!context->table.reconcile(std::move(found_fw_devices.value()), context->handles)) {
+            return fw_error_memory;
         }
+        context->snapshot.publish(context->table.snapshot());
+    } catch (const std::bad_alloc&) {
+        return fw_error_memory;
     }
 
-    // Remove devices that are no longer present
-    fw_devices.erase(
-        std::remove_if(
-            fw_devices.begin(),
-            fw_devices.end(),
-            [&found_fw_devices](const std::shared_ptr<fw_freewili_device_t>& fw_device) {
-                return std::none_of(
-                    found_fw_devices.value().begin(),
-                    found_fw_devices.value().end(),
-                    [&fw_device](const FreeWiliDevice& device) { return *fw_device == device; }
-                );
-            }
-        ),
-        fw_devices.end()
-    );
+    if (stats != nullptr) {
+        *stats = fw_find_stats_t {
+            .enumerate_ns = static_cast<uint64_t>(findStats.enumerateTime.count()),
+            .mount_ns = static_cast<uint64_t>(findStats.mountTime.count()),
+            .resolve_ns = static_cast<uint64_t>(findStats.resolveTime.count()),
+            .build_ns = static_cast<uint64_t>(findStats.buildTime.count()),
+            .total_ns = static_cast<uint64_t>(findStats.totalTime.count()),
+            .devices_visited = findStats.devicesVisited,
+            .attribute_reads = findStats.attributeReads,
+            .usb_devices_matched = findStats.usbDevicesMatched,
+            .devices_found = findStats.devicesFound,
+        };
+    }
 
-    auto min_size = std::minmax(*count, static_cast<uint32_t>(fw_devices.size())).first;
+    auto min_size = std::minmax(*count, static_cast<uint32_t>(context->handles.size())).first;
     *count = min_size;
 
     for (uint32_t i = 0; i < min_size; ++i) {
-        devices[i] = fw_devices[i].get();
+        devices[i] = context->handles[i];
     }
     return fw_error_success;
 }
 
 CFW_FINDER_API bool fw_device_is_valid(fw_freewili_device_t* device) {
-    if (device == nullptr) {
+    return fw_context_device_is_valid(defaultContext(), device);
+}
+
+CFW_FINDER_API bool
+fw_context_device_is_valid(fw_context_t* context, fw_freewili_device_t* device) {
+    if (context == nullptr) {
         return false;
     }
-    // Check if the device is in the list of known devices
-    return std::any_of(
-        fw_devices.begin(),
-        fw_devices.end(),
-        [&](const std::shared_ptr<fw_freewili_device_t>& fw_device) {
-            return *fw_device == device->device;
-        }
-    );
+    // Handles are never dereferenced, a freed or made up one is just not in the snapshot
+    return context->snapshot.load()->find(device) != nullptr;
 }
 
 CFW_FINDER_API fw_error_t fw_device_free(fw_freewili_device_t** devices, uint32_t count) {
-    if (devices == nullptr && count == 0) {
-        fw_devices.clear();
-        return fw_error_success;
-    }
-    if (devices == nullptr || count == 0) {
+    return fw_context_device_free(defaultContext(), devices, count);
+}
+
+CFW_FINDER_API fw_error_t
+fw_context_device_free(fw_context_t* context, fw_freewili_device_t** devices, uint32_t count) {
+    if (context == nullptr) {
         return fw_error_invalid_parameter;
     }
-    for (uint32_t i = 0; i < count; ++i) {
-        if (devices[i] == nullptr) {
-            continue;
+    std::lock_guard lock(context->writer);
+    if (devices == nullptr && count == 0) {
+        context->table.clear();
+        context->handles.clear();
+    } else if (devices == nullptr || count == 0) {
+        return fw_error_invalid_parameter;
+    } else {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (devices[i] == nullptr) {
+                continue;
+            }
+            context->table.release(devices[i]);
+            devices[i] = nullptr; // Clear the pointer
         }
-        fw_devices.erase(
-            std::remove_if(
-                fw_devices.begin(),
-                fw_devices.end(),
-                [&](const std::shared_ptr<fw_freewili_device_t>& fw_device) {
-                    return fw_device.get() == devices[i];
-                }
-            ),
-            fw_devices.end()
-        );
-        devices[i] = nullptr; // Clear the pointer
+    }
+    // Readers still holding the previous snapshot keep the freed devices alive until done
+    try {
+        context->snapshot.publish(context->table.snapshot());
+    } catch (const std::bad_alloc&) {
+        return fw_error_memory;
     }
     return fw_error_success;
 }
@@ -142,11 +218,23 @@ CFW_FINDER_API fw_error_t fw_device_get_str(
     char* const value,
     uint32_t* value_size
 ) {
-    if (device == nullptr || value == nullptr || value_size == nullptr || value_size == nullptr) {
+    return fw_context_device_get_str(defaultContext(), device, str_type, value, value_size);
+}
+
+CFW_FINDER_API fw_error_t fw_context_device_get_str(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    fw_stringtype_t str_type,
+    char* const value,
+    uint32_t* value_size
+) {
+    if (context == nullptr || device == nullptr || value == nullptr || value_size == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
@@ -160,13 +248,13 @@ CFW_FINDER_API fw_error_t fw_device_get_str(
 
     switch (str_type) {
         case fw_stringtype_name:
-            return copy_value(device->device.name);
+            return copy_value(entry->device.name);
             break;
         case fw_stringtype_serial:
-            return copy_value(device->device.serial);
+            return copy_value(entry->device.serial);
             break;
         case fw_stringtype_type:
-            return copy_value(getDeviceTypeName(device->device.deviceType));
+            return copy_value(getDeviceTypeName(entry->device.deviceType));
         case fw_stringtype_path:
         case fw_stringtype_port:
         case fw_stringtype_raw:
@@ -178,14 +266,24 @@ CFW_FINDER_API fw_error_t fw_device_get_str(
 
 CFW_FINDER_API fw_error_t
 fw_device_get_type(fw_freewili_device_t* device, fw_devicetype_t* device_type) {
-    if (device == nullptr || device_type == nullptr) {
+    return fw_context_device_get_type(defaultContext(), device, device_type);
+}
+
+CFW_FINDER_API fw_error_t fw_context_device_get_type(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    fw_devicetype_t* device_type
+) {
+    if (context == nullptr || device == nullptr || device_type == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
-    *device_type = static_cast<fw_devicetype_t>(device->device.deviceType);
+    *device_type = static_cast<fw_devicetype_t>(entry->device.deviceType);
     return fw_error_success;
 }
 
@@ -230,60 +328,80 @@ fw_device_get_type_name(fw_devicetype_t device_type, char* const name, uint32_t*
 
 CFW_FINDER_API fw_error_t
 fw_device_is_standalone(fw_freewili_device_t* device, bool* is_standalone) {
-    if (device == nullptr || is_standalone == nullptr) {
+    return fw_context_device_is_standalone(defaultContext(), device, is_standalone);
+}
+
+CFW_FINDER_API fw_error_t fw_context_device_is_standalone(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    bool* is_standalone
+) {
+    if (context == nullptr || device == nullptr || is_standalone == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    *is_standalone = device->device.standalone;
+    *is_standalone = entry->device.standalone;
     return fw_error_success;
 }
 
 CFW_FINDER_API fw_error_t fw_device_unique_id(fw_freewili_device_t* device, uint64_t* unique_id) {
-    if (device == nullptr || unique_id == nullptr) {
+    return fw_context_device_unique_id(defaultContext(), device, unique_id);
+}
+
+CFW_FINDER_API fw_error_t fw_context_device_unique_id(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint64_t* unique_id
+) {
+    if (context == nullptr || device == nullptr || unique_id == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    *unique_id = device->device.uniqueID;
+    *unique_id = entry->device.uniqueID;
     return fw_error_success;
 }
 
 CFW_FINDER_API fw_error_t fw_usb_device_begin(fw_freewili_device_t* device) {
-    if (device == nullptr) {
-        return fw_error_invalid_parameter;
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
     }
-
-    if (!fw_device_is_valid(device)) {
-        return fw_error_invalid_device;
-    }
-
     // Reset the iterator to the beginning of the USB devices
-    device->usbDevicesIter = device->device.usbDevices.begin();
+    *cursor.value() = 0;
     return fw_error_success;
 }
 
 CFW_FINDER_API fw_error_t fw_usb_device_next(fw_freewili_device_t* device) {
-    if (device == nullptr) {
-        return fw_error_invalid_parameter;
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
     }
-
-    if (!fw_device_is_valid(device)) {
-        return fw_error_invalid_device;
+    uint32_t size = 0;
+    if (auto error = fw_context_usb_device_count(defaultContext(), device, &size);
+        error != fw_error_success)
+    {
+        return error;
     }
 
-    if (device->usbDevicesIter == device->device.usbDevices.end()) {
+    // Move to the next USB device
+    auto& index = *cursor.value();
+    if (index >= size) {
         return fw_error_no_more_devices; // No more USB devices to enumerate
     }
-
-    ++device->usbDevicesIter; // Move to the next USB device
-    if (device->usbDevicesIter == device->device.usbDevices.end()) {
+    ++index;
+    if (index == size) {
         return fw_error_no_more_devices; // No more USB devices to enumerate
     } else {
         return fw_error_success;
@@ -296,35 +414,62 @@ CFW_FINDER_API fw_error_t fw_usb_device_set(
     char* const error_message,
     uint32_t* error_message_size
 ) {
-    if (device == nullptr || error_message == nullptr || error_message_size == nullptr) {
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
+    }
+    return fw_context_usb_device_index_of(
+        defaultContext(),
+        device,
+        iter_set,
+        cursor.value(),
+        error_message,
+        error_message_size
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_context_usb_device_index_of(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    fw_usbdevice_iter_set_t iter_set,
+    uint32_t* index,
+    char* const error_message,
+    uint32_t* error_message_size
+) {
+    if (context == nullptr || device == nullptr || index == nullptr || error_message == nullptr
+        || error_message_size == nullptr)
+    {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
     auto usb_device = std::expected<USBDevice, std::string> {};
 
     if (iter_set == fw_usbdevice_iter_main) {
-        usb_device = device->device.getMainUSBDevice();
+        usb_device = entry->device.getMainUSBDevice();
     } else if (iter_set == fw_usbdevice_iter_display) {
-        usb_device = device->device.getDisplayUSBDevice();
+        usb_device = entry->device.getDisplayUSBDevice();
     } else if (iter_set == fw_usbdevice_iter_fpga) {
-        usb_device = device->device.getFPGAUSBDevice();
+        usb_device = entry->device.getFPGAUSBDevice();
     } else if (iter_set == fw_usbdevice_iter_hub) {
-        usb_device = device->device.getHubUSBDevice();
+        usb_device = entry->device.getHubUSBDevice();
     } else {
         usb_device = std::unexpected("Invalid USB device iterator set");
     }
 
     if (usb_device.has_value()) {
-        device->usbDevicesIter = std::find_if(
-            device->device.usbDevices.begin(),
-            device->device.usbDevices.end(),
-            [&](USBDevice& d) { return d == usb_device.value(); }
+        auto it = std::find_if(
+            entry->device.usbDevices.begin(),
+            entry->device.usbDevices.end(),
+            [&](const USBDevice& d) { return d == usb_device.value(); }
         );
-        if (device->usbDevicesIter == device->device.usbDevices.end()) {
+        *index = static_cast<uint32_t>(it - entry->device.usbDevices.begin());
+        if (it == entry->device.usbDevices.end()) {
             // Device not found
             if (!fixedStringCopy(
                      error_message,
@@ -348,34 +493,60 @@ CFW_FINDER_API fw_error_t fw_usb_device_set(
 }
 
 CFW_FINDER_API fw_error_t fw_usb_device_count(fw_freewili_device_t* device, uint32_t* count) {
-    if (device == nullptr || count == nullptr) {
+    return fw_context_usb_device_count(defaultContext(), device, count);
+}
+
+CFW_FINDER_API fw_error_t
+fw_context_usb_device_count(fw_context_t* context, fw_freewili_device_t* device, uint32_t* count) {
+    if (context == nullptr || device == nullptr || count == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    *count = static_cast<uint32_t>(device->device.usbDevices.size());
+    *count = static_cast<uint32_t>(entry->device.usbDevices.size());
     return fw_error_success;
 }
 
 CFW_FINDER_API fw_error_t
 fw_usb_device_get_type(fw_freewili_device_t* device, fw_usbdevicetype_t* usb_device_type) {
-    if (device == nullptr || usb_device_type == nullptr) {
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
+    }
+    return fw_context_usb_device_get_type_at(
+        defaultContext(),
+        device,
+        *cursor.value(),
+        usb_device_type
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_type_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    fw_usbdevicetype_t* usb_device_type
+) {
+    if (context == nullptr || device == nullptr || usb_device_type == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    if (device->usbDevicesIter == device->device.usbDevices.end()) {
+    const auto* usbDevice = entry->usbDevice(index);
+    if (usbDevice == nullptr) {
         return fw_error_no_more_devices; // No more USB devices to enumerate
     }
-
-    const auto& usbDevice = *device->usbDevicesIter;
-    *usb_device_type = static_cast<fw_usbdevicetype_t>(usbDevice.kind);
+    *usb_device_type = static_cast<fw_usbdevicetype_t>(usbDevice->kind);
     return fw_error_success;
 }
 
@@ -433,20 +604,43 @@ CFW_FINDER_API fw_error_t fw_usb_device_get_str(
     char* const value,
     uint32_t* value_size
 ) {
-    if (device == nullptr || value == nullptr || value_size == nullptr) {
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
+    }
+    return fw_context_usb_device_get_str_at(
+        defaultContext(),
+        device,
+        *cursor.value(),
+        str_type,
+        value,
+        value_size
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_str_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    fw_stringtype_t str_type,
+    char* const value,
+    uint32_t* value_size
+) {
+    if (context == nullptr || device == nullptr || value == nullptr || value_size == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    if (device->usbDevicesIter == device->device.usbDevices.end()) {
+    const auto* usbDevice = entry->usbDevice(index);
+    if (usbDevice == nullptr) {
         return fw_error_no_more_devices; // No more USB devices to enumerate
     }
 
-    const auto& usbDevice = *device->usbDevicesIter;
-
     auto copy_value = [&value, &value_size](const std::string& str) {
         if (fixedStringCopy(value, value_size, str).has_value()) {
             return fw_error_success;
@@ -457,29 +651,29 @@ CFW_FINDER_API fw_error_t fw_usb_device_get_str(
 
     switch (str_type) {
         case fw_stringtype_name:
-            return copy_value(usbDevice.name);
+            return copy_value(usbDevice->name);
             break;
         case fw_stringtype_serial:
-            return copy_value(usbDevice.serial);
+            return copy_value(usbDevice->serial);
             break;
         case fw_stringtype_path: {
-            if (!usbDevice.paths.has_value() || usbDevice.paths.value().empty()) {
+            if (!usbDevice->paths.has_value() || usbDevice->paths.value().empty()) {
                 return fw_error_none; // No path available for this USB device
             }
-            return copy_value(usbDevice.paths.value().front());
+            return copy_value(usbDevice->paths.value().front());
             break;
         }
         case fw_stringtype_port:
-            if (!usbDevice.port.has_value()) {
+            if (!usbDevice->port.has_value()) {
                 return fw_error_none; // No port available for this USB device
             }
-            return copy_value(usbDevice.port.value());
+            return copy_value(usbDevice->port.value());
             break;
         case fw_stringtype_raw:
-            return copy_value(usbDevice._raw);
+            return copy_value(usbDevice->_raw);
             break;
         case fw_stringtype_type:
-            return copy_value(getUSBDeviceTypeName(usbDevice.kind));
+            return copy_value(getUSBDeviceTypeName(usbDevice->kind));
             break;
     }
     return fw_error_internal_error; // Should not reach here
@@ -487,29 +681,50 @@ CFW_FINDER_API fw_error_t fw_usb_device_get_str(
 
 CFW_FINDER_API fw_error_t
 fw_usb_device_get_int(fw_freewili_device_t* device, fw_inttype_t int_type, uint32_t* value) {
-    if (device == nullptr || value == nullptr) {
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
+    }
+    return fw_context_usb_device_get_int_at(
+        defaultContext(),
+        device,
+        *cursor.value(),
+        int_type,
+        value
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_int_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    fw_inttype_t int_type,
+    uint32_t* value
+) {
+    if (context == nullptr || device == nullptr || value == nullptr) {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    if (device->usbDevicesIter == device->device.usbDevices.end()) {
+    const auto* usbDevice = entry->usbDevice(index);
+    if (usbDevice == nullptr) {
         return fw_error_no_more_devices; // No more USB devices to enumerate
     }
 
-    const auto& usbDevice = *device->usbDevicesIter;
-
     switch (int_type) {
         case fw_inttype_vid:
-            *value = usbDevice.vid;
+            *value = usbDevice->vid;
             break;
         case fw_inttype_pid:
-            *value = usbDevice.pid;
+            *value = usbDevice->pid;
             break;
         case fw_inttype_location:
-            *value = usbDevice.location;
+            *value = usbDevice->location;
             break;
     }
     return fw_error_success;
@@ -520,20 +735,45 @@ CFW_FINDER_API fw_error_t fw_usb_device_get_port_chain(
     uint32_t* port_chain,
     uint32_t* port_chain_size
 ) {
-    if (device == nullptr || port_chain == nullptr || port_chain_size == nullptr) {
+    auto cursor = legacyCursor(device);
+    if (!cursor.has_value()) {
+        return cursor.error();
+    }
+    return fw_context_usb_device_get_port_chain_at(
+        defaultContext(),
+        device,
+        *cursor.value(),
+        port_chain,
+        port_chain_size
+    );
+}
+
+CFW_FINDER_API fw_error_t fw_context_usb_device_get_port_chain_at(
+    fw_context_t* context,
+    fw_freewili_device_t* device,
+    uint32_t index,
+    uint32_t* port_chain,
+    uint32_t* port_chain_size
+) {
+    if (context == nullptr || device == nullptr || port_chain == nullptr
+        || port_chain_size == nullptr)
+    {
         return fw_error_invalid_parameter;
     }
 
-    if (!fw_device_is_valid(device)) {
+    auto snapshot = context->snapshot.load();
+    auto* entry = snapshot->find(device);
+    if (entry == nullptr) {
         return fw_error_invalid_device;
     }
 
-    if (device->usbDevicesIter == device->device.usbDevices.end()) {
+    const auto* usbDevice = entry->usbDevice(index);
+    if (usbDevice == nullptr) {
         return fw_error_no_more_devices; // No more USB devices to enumerate
     }
 
     // Get the port chain and check its size
-    const auto& portChain = device->usbDevicesIter->portChain;
+    const auto& portChain = usbDevice->portChain;
     if (portChain.size() >= *port_chain_size) {
         return fw_error_memory;
     }
@@ -2,6 +2,10 @@
 #include <gtest/gtest.h>
 #include <cfwfinder.h>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 TEST(CFwFinderCAPI, FindAllDevices_InvalidParams) {
     fw_error_t err;
     // Null devices and count
@@ -19,6 +23,41 @@ TEST(CFwFinderCAPI, FindAllDevices_InvalidParams) {
     ASSERT_EQ(err, fw_error_invalid_parameter);
 }
 
+TEST(CFwFinderCAPI, FindAllDevicesWithStats) {
+    char error_message[256] = { 0 };
+    uint32_t error_message_size = sizeof(error_message) / sizeof(error_message[0]);
+    fw_freewili_device_t* devices[32] = { 0 };
+    uint32_t device_count = 32;
+    fw_find_stats_t stats {};
+
+    fw_error_t err = fw_device_find_all_with_stats(
+        devices,
+        &device_count,
+        error_message,
+        &error_message_size,
+        &stats
+    );
+    ASSERT_EQ(err, fw_error_success) << error_message;
+    ASSERT_EQ(stats.devices_found, device_count);
+    ASSERT_GT(stats.total_ns, 0u);
+    ASSERT_LE(
+        stats.enumerate_ns + stats.mount_ns + stats.resolve_ns + stats.build_ns,
+        stats.total_ns
+    );
+
+    // Measuring is optional
+    device_count = 32;
+    err = fw_device_find_all_with_stats(
+        devices,
+        &device_count,
+        error_message,
+        &error_message_size,
+        nullptr
+    );
+    ASSERT_EQ(err, fw_error_success) << error_message;
+    fw_device_free(nullptr, 0);
+}
+
 TEST(CFwFinderCAPI, DeviceIsValid_Null) {
     ASSERT_FALSE(fw_device_is_valid(nullptr));
 }
@@ -252,3 +291,130 @@ TEST(CFwFinderCAPI, UsbDeviceEnumeration_IfDeviceFound) {
     err = fw_device_free(devices, device_count);
     ASSERT_EQ(err, fw_error_success);
 }
+
+TEST(CFwFinderCAPI, Context_InvalidParams) {
+    ASSERT_EQ(fw_context_create(nullptr), fw_error_invalid_parameter);
+    ASSERT_EQ(fw_context_destroy(nullptr), fw_error_invalid_parameter);
+
+    fw_freewili_device_t* devices[1] = { nullptr };
+    uint32_t count = 1;
+    ASSERT_EQ(
+        fw_context_find_all(nullptr, devices, &count, nullptr, nullptr, nullptr),
+        fw_error_invalid_parameter
+    );
+    ASSERT_FALSE(fw_context_device_is_valid(nullptr, devices[0]));
+    ASSERT_EQ(fw_context_device_free(nullptr, nullptr, 0), fw_error_invalid_parameter);
+    uint32_t value = 0;
+    ASSERT_EQ(
+        fw_context_usb_device_get_int_at(nullptr, devices[0], 0, fw_inttype_vid, &value),
+        fw_error_invalid_parameter
+    );
+}
+
+TEST(CFwFinderCAPI, Context_FindAll) {
+    fw_context_t* context = nullptr;
+    ASSERT_EQ(fw_context_create(&context), fw_error_success);
+    ASSERT_NE(context, nullptr);
+
+    char error_message[256] = { 0 };
+    uint32_t error_message_size = sizeof(error_message);
+    fw_freewili_device_t* devices[32] = { 0 };
+    uint32_t device_count = 32;
+    fw_error_t err = fw_context_find_all(
+        context,
+        devices,
+        &device_count,
+        error_message,
+        &error_message_size,
+        nullptr
+    );
+    ASSERT_EQ(err, fw_error_success) << error_message;
+    for (uint32_t i = 0; i < device_count; ++i) {
+        ASSERT_TRUE(fw_context_device_is_valid(context, devices[i]));
+        uint64_t unique_id = 0;
+        ASSERT_EQ(fw_context_device_unique_id(context, devices[i], &unique_id), fw_error_success);
+    }
+
+    // Freeing every device of the context leaves the process-wide one alone, and the other way
+    fw_freewili_device_t* global_devices[32] = { 0 };
+    uint32_t global_count = 32;
+    err = fw_device_find_all(global_devices, &global_count, error_message, &error_message_size);
+    ASSERT_EQ(err, fw_error_success) << error_message;
+    ASSERT_EQ(fw_context_device_free(context, nullptr, 0), fw_error_success);
+    for (uint32_t i = 0; i < device_count; ++i) {
+        ASSERT_FALSE(fw_context_device_is_valid(context, devices[i]));
+    }
+    for (uint32_t i = 0; i < global_count; ++i) {
+        ASSERT_TRUE(fw_device_is_valid(global_devices[i]));
+    }
+    fw_device_free(nullptr, 0);
+    ASSERT_EQ(fw_context_destroy(context), fw_error_success);
+}
+
+TEST(CFwFinderCAPI, Context_ReadersDuringRescan) {
+    fw_context_t* context = nullptr;
+    ASSERT_EQ(fw_context_create(&context), fw_error_success);
+
+    fw_freewili_device_t* devices[32] = { 0 };
+    uint32_t device_count = 32;
+    ASSERT_EQ(
+        fw_context_find_all(context, devices, &device_count, nullptr, nullptr, nullptr),
+        fw_error_success
+    );
+    // Without devices the readers have nothing to read, the snapshot swap itself is covered by
+    // DeviceHandleTableTest.PublishedSnapshotReadersDuringRescan
+    if (device_count == 0) {
+        fw_context_destroy(context);
+        GTEST_SKIP() << "No Free-Wili devices found. Skipping concurrent reader test.";
+    }
+
+    // Readers only ever see a device as valid or invalid, never half freed
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 2; ++reader) {
+        readers.emplace_back([&] {
+            while (!done) {
+                for (uint32_t i = 0; i < device_count; ++i) {
+                    char serial[64] = { 0 };
+                    uint32_t serial_size = sizeof(serial);
+                    auto err = fw_context_device_get_str(
+                        context,
+                        devices[i],
+                        fw_stringtype_serial,
+                        serial,
+                        &serial_size
+                    );
+                    EXPECT_TRUE(err == fw_error_success || err == fw_error_invalid_device);
+                    uint32_t usb_count = 0;
+                    fw_context_usb_device_count(context, devices[i], &usb_count);
+                    for (uint32_t index = 0; index < usb_count; ++index) {
+                        uint32_t vid = 0;
+                        err = fw_context_usb_device_get_int_at(
+                            context,
+                            devices[i],
+                            index,
+                            fw_inttype_vid,
+                            &vid
+                        );
+                        EXPECT_TRUE(err == fw_error_success || err == fw_error_invalid_device);
+                    }
+                }
+            }
+        });
+    }
+    for (int scan = 0; scan < 5; ++scan) {
+        fw_freewili_device_t* rescanned[32] = { 0 };
+        uint32_t rescanned_count = 32;
+        // EXPECT so that a failure still stops and joins the readers
+        EXPECT_EQ(
+            fw_context_find_all(context, rescanned, &rescanned_count, nullptr, nullptr, nullptr),
+            fw_error_success
+        );
+        EXPECT_EQ(fw_context_device_free(context, nullptr, 0), fw_error_success);
+    }
+    done = true;
+    for (auto& reader: readers) {
+        reader.join();
+    }
+    ASSERT_EQ(fw_context_destroy(context), fw_error_success);
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <cfwfinder_handles.hpp>
+#include <fwbuilder.hpp>
+#include <usbdef.hpp>
+
+#include <atomic>
+#include <thread>
+
+class DeviceHandleTableTest: public ::testing::Test {
+protected:
+    static Fw::FreeWiliDevice createDevice(uint64_t uniqueID, std::string serial) {
+        Fw::USBDevices usbDevices = {
+            Fw::USBDevice { .kind = Fw::USBDeviceType::Hub,
+                            .vid = Fw::USB_VID_FW_HUB,
+                            .pid = Fw::USB_PID_FW_HUB,
+                            .name = "FREE-WILi Hub",
+                            .serial = serial,
+                            .location = 1,
+                            .portChain = { 1 },
+                            .paths = std::nullopt,
+                            .port = std::nullopt,
+                            ._raw = "/sys/devices/hub" },
+        };
+        return Fw::FreeWiliDevice::builder()
+            .setDeviceType(Fw::DeviceType::FreeWili)
+            .setName("FreeWili")
+            .setSerial(std::move(serial))
+            .setUniqueID(uniqueID)
+            .setStandalone(false)
+            .setUSBDevices(std::move(usbDevices))
+            .build()
+            .value();
+    }
+
+    static Fw::FreeWiliDevices createDevices(std::initializer_list<uint64_t> uniqueIDs) {
+        Fw::FreeWiliDevices devices;
+        for (auto uniqueID: uniqueIDs) {
+            devices.push_back(createDevice(uniqueID, "FW" + std::to_string(uniqueID)));
+        }
+        return devices;
+    }
+
+    DeviceHandleTable table;
+    std::vector<fw_freewili_device_t*> handles;
+};
+
+TEST_F(DeviceHandleTableTest, HandlesFindTheirDevice) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2, 3 }), handles));
+    ASSERT_EQ(handles.size(), 3u);
+    ASSERT_EQ(table.size(), 3u);
+    for (size_t i = 0; i < handles.size(); ++i) {
+        ASSERT_NE(handles[i], nullptr);
+        auto* entry = table.find(handles[i]);
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(entry->device.uniqueID, i + 1);
+    }
+}
+
+TEST_F(DeviceHandleTableTest, NullAndMadeUpHandlesAreRejected) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1 }), handles));
+    EXPECT_EQ(table.find(nullptr), nullptr);
+    // Out of range slot, and the right slot with the wrong generation
+    EXPECT_EQ(table.find(reinterpret_cast<fw_freewili_device_t*>(uintptr_t(42))), nullptr);
+    auto wrongGeneration = reinterpret_cast<uintptr_t>(handles[0])
+        + (uintptr_t(1) << DeviceHandle::indexBits);
+    EXPECT_EQ(table.find(reinterpret_cast<fw_freewili_device_t*>(wrongGeneration)), nullptr);
+    EXPECT_FALSE(table.release(nullptr));
+}
+
+TEST_F(DeviceHandleTableTest, HandleSurvivesRescan) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2 }), handles));
+    auto first = handles;
+    auto firstScan = table.find(first[1])->scan;
+
+    ASSERT_TRUE(table.reconcile(createDevices({ 2, 1 }), handles));
+    ASSERT_EQ(handles.size(), 2u);
+    EXPECT_EQ(handles[0], first[1]);
+    EXPECT_EQ(handles[1], first[0]);
+    auto* entry = table.find(first[1]);
+    ASSERT_NE(entry, nullptr);
+    // Same handle, new entry
+    EXPECT_NE(entry->scan, firstScan);
+}
+
+TEST_F(DeviceHandleTableTest, StaleHandleIsRejectedAfterDeviceIsGone) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2 }), handles));
+    auto gone = handles[0];
+
+    ASSERT_TRUE(table.reconcile(createDevices({ 2 }), handles));
+    EXPECT_EQ(table.find(gone), nullptr);
+    EXPECT_EQ(table.size(), 1u);
+
+    // The freed slot is reused by the next device, the old handle still doesn't match it
+    ASSERT_TRUE(table.reconcile(createDevices({ 2, 3 }), handles));
+    EXPECT_EQ(table.find(gone), nullptr);
+    ASSERT_NE(table.find(handles[1]), nullptr);
+    EXPECT_EQ(table.find(handles[1])->device.uniqueID, 3u);
+    EXPECT_NE(handles[1], gone);
+}
+
+TEST_F(DeviceHandleTableTest, ReleaseInvalidatesHandle) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2 }), handles));
+    EXPECT_TRUE(table.release(handles[0]));
+    EXPECT_FALSE(table.release(handles[0]));
+    EXPECT_EQ(table.find(handles[0]), nullptr);
+    EXPECT_NE(table.find(handles[1]), nullptr);
+
+    // A released device is handed out again, under a new handle
+    auto released = handles[0];
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2 }), handles));
+    EXPECT_NE(handles[0], released);
+    EXPECT_NE(table.find(handles[0]), nullptr);
+}
+
+TEST_F(DeviceHandleTableTest, ClearInvalidatesEveryHandle) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2, 3 }), handles));
+    table.clear();
+    EXPECT_EQ(table.size(), 0u);
+    for (auto* handle: handles) {
+        EXPECT_EQ(table.find(handle), nullptr);
+    }
+}
+
+TEST_F(DeviceHandleTableTest, SnapshotKeepsFreedDevicesAlive) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2 }), handles));
+    auto released = handles[0];
+    auto snapshot = table.snapshot();
+    auto* entry = snapshot->find(released);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry, table.find(released));
+
+    // Neither a release nor a rescan reusing the slot touches an earlier snapshot
+    table.release(released);
+    ASSERT_TRUE(table.reconcile(createDevices({ 3 }), handles));
+    EXPECT_EQ(table.find(released), nullptr);
+    EXPECT_EQ(snapshot->find(released), entry);
+    EXPECT_EQ(snapshot->find(handles[0]), nullptr);
+    EXPECT_EQ(entry->device.serial, "FW1");
+    EXPECT_EQ(table.snapshot()->find(released), nullptr);
+    EXPECT_EQ(table.snapshot()->find(handles[0])->device.uniqueID, 3u);
+}
+
+TEST_F(DeviceHandleTableTest, UsbDeviceAt) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1 }), handles));
+    auto* entry = table.find(handles[0]);
+    ASSERT_NE(entry->usbDevice(0), nullptr);
+    EXPECT_EQ(entry->usbDevice(0)->kind, Fw::USBDeviceType::Hub);
+    EXPECT_EQ(entry->usbDevice(entry->device.usbDevices.size()), nullptr);
+}
+
+TEST_F(DeviceHandleTableTest, UsbDeviceCursorsStartOverOnRescan) {
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2 }), handles));
+    UsbDeviceCursors cursors;
+    UsbDeviceCursors otherThread;
+    auto* cursor = cursors.find(*table.snapshot(), handles[0]);
+    ASSERT_NE(cursor, nullptr);
+    EXPECT_EQ(*cursor, 0u);
+    *cursor = 1;
+    EXPECT_EQ(*cursors.find(*table.snapshot(), handles[0]), 1u);
+    EXPECT_EQ(*otherThread.find(*table.snapshot(), handles[0]), 0u);
+
+    auto gone = handles[1];
+    ASSERT_NE(cursors.find(*table.snapshot(), gone), nullptr);
+    EXPECT_EQ(cursors.size(), 2u);
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 3 }), handles));
+    EXPECT_EQ(*cursors.find(*table.snapshot(), handles[0]), 0u);
+    EXPECT_EQ(cursors.find(*table.snapshot(), gone), nullptr);
+    EXPECT_EQ(cursors.find(*table.snapshot(), nullptr), nullptr);
+    EXPECT_EQ(cursors.size(), 1u);
+
+    // Cursors of freed handles go once a new handle is walked
+    ASSERT_NE(cursors.find(*table.snapshot(), handles[1]), nullptr);
+    table.release(handles[0]);
+    ASSERT_NE(cursors.find(*table.snapshot(), handles[1]), nullptr);
+    EXPECT_EQ(cursors.size(), 2u);
+    ASSERT_TRUE(table.reconcile(createDevices({ 3, 4 }), handles));
+    ASSERT_NE(cursors.find(*table.snapshot(), handles[1]), nullptr);
+    EXPECT_EQ(cursors.size(), 2u);
+}
+
+TEST_F(DeviceHandleTableTest, PublishedSnapshotReadersDuringRescan) {
+    PublishedSnapshot published;
+    ASSERT_TRUE(table.reconcile(createDevices({ 1, 2, 3 }), handles));
+    published.publish(table.snapshot());
+    auto first = handles;
+
+    std::atomic<bool> done = false;
+    std::atomic<size_t> reads = 0;
+    std::thread reader([&] {
+        while (!done) {
+            auto snapshot = published.load();
+            for (auto* handle: first) {
+                // Gone or still whole, whichever snapshot was current
+                if (auto* entry = snapshot->find(handle)) {
+                    EXPECT_EQ(entry->device.serial, "FW" + std::to_string(entry->device.uniqueID));
+                    ++reads;
+                }
+            }
+        }
+    });
+    for (int scan = 0; scan < 200; ++scan) {
+        ASSERT_TRUE(table.reconcile(createDevices({ 1, 2, 3 }), handles));
+        published.publish(table.snapshot());
+        ASSERT_TRUE(table.reconcile(createDevices({ 2 }), handles));
+        published.publish(table.snapshot());
+    }
+    while (reads == 0) {
+        std::this_thread::yield();
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(published.load()->find(first[0]), nullptr);
+    EXPECT_NE(published.load()->find(first[1]), nullptr);
+}
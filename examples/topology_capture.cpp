@@ -0,0 +1,337 @@
+/**
+ * @file topology_capture.cpp
+ * @brief Capture the USB topology the finder sees and replay it without hardware
+ *
+ * Usage:
+ *   topology_capture capture <archive> [--root <dir>]
+ *   topology_capture replay <archive> [--iterations <n>]
+ *
+ * capture snapshots everything the Linux sysfs backend reads: usb_device attributes,
+ * the tty and block devices hanging off of them and the matching mount table entries.
+ * The archive is a single text file, one symlink or file per line.
+ *
+ * replay rebuilds the tree in a temporary directory and runs Fw::find_all() against it
+ * through Fw::FindOptions::root, printing the devices found and how long discovery took.
+ */
+
+#include <fwfinder.hpp>
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const std::string archiveHeader = "fwfinder-capture 1";
+
+// Archive lines are "<kind> <path> <value>", newlines in file contents are escaped
+static auto escape(const std::string& value) -> std::string {
+    std::string escaped;
+    for (char c: value) {
+        if (c == '\\') {
+            escaped += "\\\\";
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static auto unescape(const std::string& value) -> std::string {
+    std::string unescaped;
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '\\' && i + 1 < value.size()) {
+            unescaped += value[++i] == 'n' ? '\n' : value[i];
+        } else {
+            unescaped += value[i];
+        }
+    }
+    return unescaped;
+}
+
+static auto readFile(const fs::path& path) -> std::string {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+class Capture {
+public:
+    explicit Capture(const fs::path& root): root(fs::canonical(root)) {}
+
+    auto run(std::ostream& archive) -> void {
+        archive << archiveHeader << "\n";
+        captureUsbDevices(archive);
+        captureClass(archive, "tty", { "uevent" });
+        captureClass(archive, "block", { "uevent", "dev", "partition" });
+        captureMounts(archive);
+    }
+
+private:
+    auto relative(const fs::path& path) const -> std::string {
+        return path.lexically_relative(root).generic_string();
+    }
+
+    auto captureFile(std::ostream& archive, const fs::path& path) -> void {
+        std::error_code ec;
+        if (fs::is_regular_file(path, ec)) {
+            archive << "F " << relative(path) << " " << escape(readFile(path)) << "\n";
+        }
+    }
+
+    auto captureLink(std::ostream& archive, const fs::path& link, const fs::path& target)
+        -> void {
+        archive << "L " << relative(link) << " " << relative(target) << "\n";
+    }
+
+    auto hasUsbAncestor(fs::path path) const -> bool {
+        while (path.has_relative_path() && path != root) {
+            path = path.parent_path();
+            if (usbDevices.contains(path)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto captureUsbDevices(std::ostream& archive) -> void {
+        std::error_code ec;
+        for (const auto& entry: fs::directory_iterator(root / "sys/bus/usb/devices", ec)) {
+            // Interfaces ("1-1:1.0") aren't read by discovery
+            if (entry.path().filename().string().contains(':')) {
+                continue;
+            }
+            auto syspath = fs::canonical(entry.path(), ec);
+            if (ec) {
+                continue;
+            }
+            usbDevices.insert(syspath);
+            captureLink(archive, entry.path(), syspath);
+            for (auto attribute: { "idVendor", "idProduct", "manufacturer", "product", "serial" }) {
+                captureFile(archive, syspath / attribute);
+            }
+        }
+    }
+
+    auto captureClass(
+        std::ostream& archive,
+        const std::string& name,
+        std::initializer_list<const char*> attributes
+    ) -> void {
+        std::error_code ec;
+        for (const auto& entry: fs::directory_iterator(root / "sys/class" / name, ec)) {
+            auto syspath = fs::canonical(entry.path(), ec);
+            if (ec || !hasUsbAncestor(syspath)) {
+                continue;
+            }
+            captureLink(archive, entry.path(), syspath);
+            for (auto attribute: attributes) {
+                captureFile(archive, syspath / attribute);
+            }
+            if (name == "block") {
+                devNodes.insert("/dev/" + syspath.filename().string());
+                auto devNum = readFile(syspath / "dev");
+                devNums.insert(devNum.substr(0, devNum.find('\n')));
+            }
+        }
+    }
+
+    // Only the mounts of captured disks are kept, the rest of the host stays private
+    auto captureMounts(std::ostream& archive) -> void {
+        std::ifstream mountInfo(root / "proc/self/mountinfo");
+        std::string line;
+        std::string mounts;
+        if (mountInfo.is_open()) {
+            while (std::getline(mountInfo, line)) {
+                std::istringstream fields(line);
+                std::string id, parent, devNum;
+                fields >> id >> parent >> devNum;
+                if (devNums.contains(devNum)) {
+                    mounts += line + "\n";
+                }
+            }
+            archive << "F proc/self/mountinfo " << escape(mounts) << "\n";
+            return;
+        }
+        std::ifstream procMounts(root / "proc/mounts");
+        while (std::getline(procMounts, line)) {
+            if (devNodes.contains(line.substr(0, line.find(' ')))) {
+                mounts += line + "\n";
+            }
+        }
+        archive << "F proc/mounts " << escape(mounts) << "\n";
+    }
+
+    fs::path root;
+    std::set<fs::path> usbDevices;
+    std::set<std::string> devNodes;
+    std::set<std::string> devNums;
+};
+
+// Archives come from other machines, a path or link target leaving the root is rejected
+static auto isInsideRoot(const fs::path& path) -> bool {
+    if (path.empty() || path.has_root_path()) {
+        return false;
+    }
+    return std::ranges::none_of(path, [](const fs::path& part) { return part == ".."; });
+}
+
+static auto replay(std::istream& archive, const fs::path& root) -> bool {
+    std::string line;
+    if (!std::getline(archive, line) || line != archiveHeader) {
+        std::cerr << "Not a fwfinder capture" << std::endl;
+        return false;
+    }
+    for (size_t lineNumber = 2; std::getline(archive, line); ++lineNumber) {
+        auto pathEnd = line.find(' ', 2);
+        if (line.size() < 3 || pathEnd == std::string::npos) {
+            continue;
+        }
+        const fs::path relativePath = line.substr(2, pathEnd - 2);
+        auto value = line.substr(pathEnd + 1);
+        if (!isInsideRoot(relativePath) || (line[0] == 'L' && !isInsideRoot(value))) {
+            std::cerr << "Line " << lineNumber << " leaves the capture root" << std::endl;
+            return false;
+        }
+        auto path = root / relativePath;
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        if (!ec && line[0] == 'L') {
+            fs::create_directory_symlink(root / value, path, ec);
+        } else if (!ec && line[0] == 'F') {
+            std::ofstream file(path, std::ios::binary);
+            if (!(file << unescape(value))) {
+                ec = std::make_error_code(std::errc::io_error);
+            }
+        }
+        if (ec) {
+            std::cerr << "Line " << lineNumber << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static auto printDevices(const Fw::FreeWiliDevices& devices) -> void {
+    std::cout << "Found " << devices.size() << " FreeWili device(s)" << std::endl;
+    for (const auto& device: devices) {
+        std::cout << "  " << device.name << " (" << Fw::getDeviceTypeName(device.deviceType)
+                  << ") serial " << device.serial << ", unique ID " << device.uniqueID
+                  << std::endl;
+        for (const auto& usbDevice: device.usbDevices) {
+            std::cout << "    " << Fw::getUSBDeviceTypeName(usbDevice.kind) << ": "
+                      << usbDevice.name;
+            if (usbDevice.port.has_value()) {
+                std::cout << " " << usbDevice.port.value();
+            }
+            for (const auto& path: usbDevice.paths.value_or(std::vector<std::string> {})) {
+                std::cout << " " << path;
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+static auto usage() -> int {
+    std::cerr << "Usage:" << std::endl
+              << "  topology_capture capture <archive> [--root <dir>]" << std::endl
+              << "  topology_capture replay <archive> [--iterations <n>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() < 2) {
+        return usage();
+    }
+    const auto& mode = args[0];
+    const auto& archivePath = args[1];
+    std::string root = "/";
+    size_t iterations = 1;
+    for (size_t i = 2; i + 1 < args.size(); i += 2) {
+        if (args[i] == "--root") {
+            root = args[i + 1];
+        } else if (args[i] == "--iterations") {
+            const auto& value = args[i + 1];
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), iterations);
+            if (ec != std::errc {} || end != value.data() + value.size()) {
+                return usage();
+            }
+            iterations = std::max<size_t>(1, iterations);
+        } else {
+            return usage();
+        }
+    }
+
+    if (mode == "capture") {
+        std::ofstream archive(archivePath);
+        if (!archive.is_open()) {
+            std::cerr << "Failed to open " << archivePath << std::endl;
+            return 1;
+        }
+        Capture(root).run(archive);
+        std::cout << "Captured " << root << " to " << archivePath << std::endl;
+        return 0;
+    }
+    if (mode != "replay") {
+        return usage();
+    }
+
+    std::ifstream archive(archivePath);
+    if (!archive.is_open()) {
+        std::cerr << "Failed to open " << archivePath << std::endl;
+        return 1;
+    }
+    std::string tempRoot = (fs::temp_directory_path() / "fwfinder_replay_XXXXXX").string();
+    if (!mkdtemp(tempRoot.data())) {
+        std::cerr << "Failed to create a temporary directory" << std::endl;
+        return 1;
+    }
+    int result = 0;
+    if (replay(archive, tempRoot)) {
+        const auto options = Fw::FindOptions {
+            .backend = Fw::FindBackend::Default,
+            .root = tempRoot,
+            .stats = nullptr,
+            .threads = 1,
+            .stop = {},
+        };
+        std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+        std::chrono::nanoseconds total {};
+        auto devices = Fw::find_all(options);
+        for (size_t i = 0; i < iterations && devices.has_value(); ++i) {
+            auto start = std::chrono::steady_clock::now();
+            devices = Fw::find_all(options);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed);
+            total += elapsed;
+        }
+        if (devices.has_value()) {
+            printDevices(devices.value());
+            std::cout << "find_all() over " << iterations << " iteration(s): best "
+                      << std::chrono::duration<double, std::milli>(best).count() << " ms, mean "
+                      << std::chrono::duration<double, std::milli>(total).count()
+                    / static_cast<double>(iterations)
+                      << " ms" << std::endl;
+        } else {
+            std::cerr << "Failed to find devices: " << devices.error() << std::endl;
+            result = 1;
+        }
+    } else {
+        result = 1;
+    }
+    std::error_code ec;
+    fs::remove_all(tempRoot, ec);
+    return result;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <fwfinder.hpp>
+
+#include <coroutine>
+#include <expected>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+
+namespace Fw {
+
+/// Hands a suspended coroutine back to the loop it belongs to, ie.
+/// `[&io](std::coroutine_handle<> handle) { asio::post(io, handle); }`
+using ResumeExecutor = std::function<void(std::coroutine_handle<>)>;
+
+/**
+ * @brief Runs find_all(options) on a background thread.
+ *
+ * Cancel it through FindOptions::stop, the future then holds "Discovery was cancelled".
+ * Dropping the future doesn't wait for the scan, FindOptions::stats must stay alive until
+ * the scan is done.
+ *
+ * Scans run on a few threads owned by the library. They are joined when it is unloaded,
+ * scans still running or queued then are cancelled.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwasync.hpp>
+ *
+ * std::stop_source stop;
+ * Fw::FindOptions options {};
+ * options.stop = stop.get_token();
+ * auto devices = Fw::find_all_async(options);
+ * // ... keep the loop going, stop.request_stop() on shutdown
+ * if (devices.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+ *    std::println("{} devices", devices.get().value_or(Fw::FreeWiliDevices {}).size());
+ * }
+ * @endcode
+ *
+ * @return future of the find_all() result, holding an error when no thread could be started.
+ */
+auto find_all_async(FindOptions options = {}) noexcept
+    -> std::future<std::expected<FreeWiliDevices, std::string>>;
+
+/// What find_all_awaitable() returns, co_await it once.
+class FindAllAwaitable {
+public:
+    FindAllAwaitable(FindOptions options, ResumeExecutor resume) noexcept;
+
+    auto await_ready() const noexcept -> bool;
+    /// Starts the scan, the coroutine carries on right away when no thread could be started.
+    auto await_suspend(std::coroutine_handle<> handle) noexcept -> bool;
+    auto await_resume() noexcept -> std::expected<FreeWiliDevices, std::string>;
+
+private:
+    struct State;
+
+    FindOptions options;
+    ResumeExecutor resume;
+    /// Created when the scan starts, shared with the thread running it
+    std::shared_ptr<State> state;
+};
+
+/**
+ * @brief co_await-able find_all(options), the scan runs on a background thread.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwasync.hpp>
+ *
+ * auto devices = co_await Fw::find_all_awaitable({}, [&io](std::coroutine_handle<> handle) {
+ *    asio::post(io, handle);
+ * });
+ * @endcode
+ *
+ * @param options as for find_all(), cancel through FindOptions::stop
+ * @param resume where the coroutine is resumed, on the scanning thread when empty
+ */
+auto find_all_awaitable(FindOptions options = {}, ResumeExecutor resume = {}) noexcept
+    -> FindAllAwaitable;
+
+}; // namespace Fw
@@ -62,6 +62,14 @@ public:
      */
     FreeWiliDeviceBuilder& setName(const std::string& name);
 
+    /**
+     * @brief Sets the name for the FreeWiliDevice being built (move).
+     *
+     * @param name The human-readable name of the device
+     * @return Reference to this builder for method chaining
+     */
+    FreeWiliDeviceBuilder& setName(std::string&& name);
+
     /**
      * @brief Sets the serial number for the FreeWiliDevice being built.
      *
@@ -70,6 +78,14 @@ public:
      */
     FreeWiliDeviceBuilder& setSerial(const std::string& serial);
 
+    /**
+     * @brief Sets the serial number for the FreeWiliDevice being built (move).
+     *
+     * @param serial The unique serial number of the device
+     * @return Reference to this builder for method chaining
+     */
+    FreeWiliDeviceBuilder& setSerial(std::string&& serial);
+
     /**
      * @brief Sets the unique ID for the FreeWiliDevice being built.
      *
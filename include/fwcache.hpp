@@ -0,0 +1,88 @@
+#pragma once
+
+#include <fwfinder.hpp>
+
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+
+namespace Fw {
+
+/// A find_all() result shared by every user of a DiscoveryCache, never modified once published
+struct DiscoverySnapshot {
+    /// Bumped every time the cache rescans the host, the first snapshot is generation 1
+    uint64_t generation;
+    /// Devices found by the scan, sorted by uniqueID like find_all()
+    FreeWiliDevices devices;
+};
+
+/**
+ * @brief Shares the last find_all() result between the components of a process.
+ *
+ * A snapshot is reused until the host changes. On Linux the cache listens to udev for
+ * usb, tty and block events and polls /proc/self/mountinfo for mount changes, both are
+ * checked without blocking on every call. With FindOptions::root or FindBackend::Sysfs
+ * the entries of the sysfs class directories and the mount table are compared instead.
+ * Other platforms can't tell, every call rescans.
+ *
+ * All members are thread safe, concurrent callers of a stale cache wait for a single rescan.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwcache.hpp>
+ *
+ * // Cheap enough to call from every component, the host is only rescanned when it changed
+ * if (auto snapshot = Fw::DiscoveryCache::instance().snapshot(); snapshot.has_value()) {
+ *    for (const auto& device : snapshot.value()->devices) {
+ *      std::println("{} {}", device.name, device.serial);
+ *    }
+ * }
+ * @endcode
+ */
+class DiscoveryCache {
+public:
+    /// Process wide cache of the live host with the default backend
+    static auto instance() noexcept -> DiscoveryCache&;
+
+    /**
+     * @brief Starts watching the host, nothing is scanned before the first snapshot().
+     *
+     * @param options used for every rescan, FindOptions::stats is overwritten by each of them
+     */
+    explicit DiscoveryCache(FindOptions options = {}) noexcept;
+
+    DiscoveryCache(DiscoveryCache&& other) noexcept;
+    DiscoveryCache& operator=(DiscoveryCache&& other) noexcept;
+    DiscoveryCache(const DiscoveryCache&) = delete;
+    DiscoveryCache& operator=(const DiscoveryCache&) = delete;
+    ~DiscoveryCache();
+
+    /**
+     * @brief Returns the last snapshot, rescanning first when the host changed since.
+     *
+     * @return DiscoverySnapshot on success, std::string when the rescan failed. The next
+     * call tries again.
+     */
+    auto snapshot() noexcept
+        -> std::expected<std::shared_ptr<const DiscoverySnapshot>, std::string>;
+
+    /// Same as snapshot(), for callers that want their own copy of the devices like find_all().
+    auto find_all() noexcept -> std::expected<FreeWiliDevices, std::string>;
+
+    /// Whether the next snapshot() rescans, the change is remembered until it does.
+    auto isStale() noexcept -> bool;
+
+    /// Forces the next snapshot() to rescan.
+    auto invalidate() noexcept -> void;
+
+    /// Generation of the last snapshot, 0 before the first scan.
+    auto generation() const noexcept -> uint64_t;
+
+private:
+    struct Impl;
+
+    std::unique_ptr<Impl> impl;
+};
+
+}; // namespace Fw
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <fwfinder.hpp>
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Fw {
+
+/// A string of a CompactDevices string table, resolve it with CompactDevices::string()
+struct InternedString {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+
+    bool operator==(const InternedString& other) const noexcept = default;
+};
+
+/// USB port chain stored inline, as deep as the uniqueID of a FreeWiliDevice can encode
+class PortChain {
+public:
+    /// 6 bits per port in the 64 bit uniqueID
+    static constexpr size_t capacity = std::numeric_limits<uint64_t>::digits / 6;
+
+    PortChain() noexcept = default;
+
+    /// Fails when the chain is deeper than capacity or a port number doesn't fit a byte.
+    static auto from(std::span<const uint32_t> ports) noexcept
+        -> std::expected<PortChain, std::string>;
+
+    auto size() const noexcept -> size_t {
+        return depth;
+    }
+
+    auto operator[](size_t index) const noexcept -> uint32_t {
+        return ports[index];
+    }
+
+    /// Same layout as USBDevice::portChain
+    auto toVector() const -> std::vector<uint32_t>;
+
+    bool operator==(const PortChain& other) const noexcept = default;
+
+private:
+    std::array<uint8_t, capacity> ports {};
+    uint8_t depth = 0;
+};
+
+/// USBDevice without any allocation of its own, strings live in the CompactDevices
+struct CompactUSBDevice {
+    InternedString name;
+    InternedString serial;
+    /// Only valid when hasPort is set
+    InternedString port;
+    InternedString _raw;
+    uint32_t location;
+    /// Range of CompactDevices::paths(), only valid when hasPaths is set
+    uint32_t pathsBegin;
+    uint32_t pathsCount;
+    uint16_t vid;
+    uint16_t pid;
+    USBDeviceType kind;
+    PortChain portChain;
+    bool hasPort;
+    bool hasPaths;
+};
+
+/// FreeWiliDevice whose USB devices are a range of CompactDevices::usbDevices()
+struct CompactFreeWiliDevice {
+    uint64_t uniqueID;
+    InternedString name;
+    InternedString serial;
+    uint32_t usbDevicesBegin;
+    uint32_t usbDevicesCount;
+    DeviceType deviceType;
+    bool standalone;
+};
+
+/**
+ * @brief A find_all() result packed into a handful of contiguous arrays.
+ *
+ * Every string is stored once in a shared string table, port chains are stored inline and
+ * the USB devices of all FreeWili devices sit in one array. Copying a snapshot costs four
+ * allocations however many devices it holds, instead of several per USBDevice.
+ *
+ * The toUSBDevice() and toFreeWiliDevice() views rebuild the regular structs for code
+ * that wants them.
+ *
+ * The tables are allocated from a std::pmr::memory_resource, a monotonic arena holds a
+ * whole snapshot and drops it in one go. Copies allocate from the default resource, moves
+ * keep the resource of the original.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwcompact.hpp>
+ *
+ * auto devices = Fw::find_all();
+ * auto compact = Fw::CompactDevices::from(devices.value());
+ * for (const auto& device : compact->devices()) {
+ *    for (const auto& usbDevice : compact->usbDevices(device)) {
+ *      std::println("{} {}", compact->string(device.serial), compact->string(usbDevice.name));
+ *    }
+ * }
+ * @endcode
+ */
+class CompactDevices {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    CompactDevices() noexcept = default;
+    explicit CompactDevices(allocator_type allocator) noexcept;
+
+    /// Fails when a port chain doesn't fit a PortChain or a table outgrows 32 bit offsets.
+    static auto from(
+        const FreeWiliDevices& devices,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+    ) -> std::expected<CompactDevices, std::string>;
+
+    auto get_allocator() const noexcept -> allocator_type {
+        return allocator_type(strings.get_allocator().resource());
+    }
+
+    auto devices() const noexcept -> std::span<const CompactFreeWiliDevice> {
+        return freeWiliDevices;
+    }
+
+    auto usbDevices() const noexcept -> std::span<const CompactUSBDevice> {
+        return allUSBDevices;
+    }
+
+    auto usbDevices(const CompactFreeWiliDevice& device) const noexcept
+        -> std::span<const CompactUSBDevice>;
+
+    auto string(InternedString interned) const noexcept -> std::string_view {
+        return std::string_view(strings).substr(interned.offset, interned.size);
+    }
+
+    /// Mount points of a MassStorage device, empty when it has none
+    auto paths(const CompactUSBDevice& usbDevice) const noexcept
+        -> std::span<const InternedString>;
+
+    /// Rebuilds the USBDevice the compact one was made from
+    auto toUSBDevice(const CompactUSBDevice& usbDevice) const -> USBDevice;
+    /// Rebuilds the FreeWiliDevice the compact one was made from, through its builder
+    auto toFreeWiliDevice(const CompactFreeWiliDevice& device) const
+        -> std::expected<FreeWiliDevice, std::string>;
+    auto toFreeWiliDevices() const -> std::expected<FreeWiliDevices, std::string>;
+
+    /// Bytes the tables hold in their memory resource
+    auto memoryUsage() const noexcept -> size_t;
+
+private:
+    std::pmr::string strings;
+    std::pmr::vector<InternedString> allPaths;
+    std::pmr::vector<CompactUSBDevice> allUSBDevices;
+    std::pmr::vector<CompactFreeWiliDevice> freeWiliDevices;
+};
+
+/**
+ * @brief Finds all Free-Wili devices and packs them into resource.
+ *
+ * The scan itself allocates from the heap and frees everything before returning, only
+ * the result lives in resource.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwcompact.hpp>
+ *
+ * std::array<std::byte, 16 * 1024> buffer;
+ * std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+ * if (auto devices = Fw::find_all(&arena); devices.has_value()) {
+ *    std::println("{} devices", devices->devices().size());
+ * }
+ * @endcode
+ *
+ * @return CompactDevices allocated from resource on success, std::string on failure.
+ */
+auto find_all(std::pmr::memory_resource* resource, const FindOptions& options = {}) noexcept
+    -> std::expected<CompactDevices, std::string>;
+
+}; // namespace Fw
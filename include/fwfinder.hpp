@@ -2,8 +2,14 @@
 
 #include <string>
 #include <expected>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <optional>
+#include <ranges>
+#include <span>
+#include <stop_token>
+#include <string_view>
 #include <vector>
 
 namespace Fw {
@@ -102,6 +108,29 @@ struct USBDevice {
 /// Container of all USB Devices.
 typedef std::vector<USBDevice> USBDevices;
 
+/// Why a FreeWiliDevice::find*USBDevice() accessor came back empty
+enum class USBDeviceError : uint32_t {
+    /// Standalone devices (badges, UF2 bootloaders) only have a Main USB device
+    Standalone,
+    /// The device should have it but it isn't enumerated
+    NotFound,
+};
+
+/// Static description of a USBDeviceError, never allocates.
+auto getUSBDeviceErrorMessage(USBDeviceError error) noexcept -> std::string_view;
+
+/// Predicate of FreeWiliDevice::viewUSBDevices(USBDeviceType)
+struct USBDeviceKindIs {
+    USBDeviceType kind;
+
+    auto operator()(const USBDevice& usbDevice) const noexcept -> bool {
+        return usbDevice.kind == kind;
+    }
+};
+
+/// Lazy view of the USBDevices of one kind, borrowed from the FreeWiliDevice
+using USBDeviceKindView = std::ranges::filter_view<std::span<const USBDevice>, USBDeviceKindIs>;
+
 struct FreeWiliDevice {
     DeviceType deviceType;
 
@@ -126,6 +155,9 @@ struct FreeWiliDevice {
     // Copy assignment operator
     FreeWiliDevice& operator=(const FreeWiliDevice& other) = default;
 
+    // Move assignment operator, std::sort and vector growth rely on it to not copy
+    FreeWiliDevice& operator=(FreeWiliDevice&& other) noexcept;
+
     // Get all USB devices attached to the USB Hub
     // On standalone devices like the badge this will return Main only.
     // specifying an empty vector will return all.
@@ -145,10 +177,27 @@ struct FreeWiliDevice {
     auto getESP32USBDevice() const noexcept -> std::expected<USBDevice, std::string>;
     // Get the Hub as a USBDevice
     auto getHubUSBDevice() const noexcept -> std::expected<USBDevice, std::string>;
+    // Mount points of the MassStorage devices, empty until the automounter mounted them
+    auto getMassStoragePaths() const noexcept -> std::vector<std::string>;
+
+    // Non-owning versions of the getters above, nothing is copied or allocated. Spans, views
+    // and pointers are valid until usbDevices is modified or the device is destroyed.
+    auto viewUSBDevices() const noexcept -> std::span<const USBDevice>;
+    auto viewUSBDevices(USBDeviceType usbDeviceType) const noexcept -> USBDeviceKindView;
+    auto findMainUSBDevice() const noexcept -> std::expected<const USBDevice*, USBDeviceError>;
+    auto findDisplayUSBDevice() const noexcept -> std::expected<const USBDevice*, USBDeviceError>;
+    auto findFPGAUSBDevice() const noexcept -> std::expected<const USBDevice*, USBDeviceError>;
+    auto findDebugProbeUSBDevice() const noexcept
+        -> std::expected<const USBDevice*, USBDeviceError>;
+    auto findESP32USBDevice() const noexcept -> std::expected<const USBDevice*, USBDeviceError>;
+    auto findHubUSBDevice() const noexcept -> std::expected<const USBDevice*, USBDeviceError>;
 
     /// Helper function to create a FreeWiliDevice from USBDevices
     static auto fromUSBDevices(const USBDevices& usbDevices)
         -> std::expected<FreeWiliDevice, std::string>;
+    /// Same as above, usbDevices is sorted in place and becomes FreeWiliDevice::usbDevices
+    static auto fromUSBDevices(USBDevices&& usbDevices)
+        -> std::expected<FreeWiliDevice, std::string>;
 
     /**
      * @brief Creates a new FreeWiliDeviceBuilder for constructing FreeWiliDevice objects.
@@ -167,15 +216,15 @@ private:
 
     FreeWiliDevice(
         Fw::DeviceType type,
-        const std::string& name,
-        const std::string& serial,
+        std::string name,
+        std::string serial,
         uint64_t id,
         bool standalone,
         Fw::USBDevices&& devices
     ):
         deviceType(type),
-        name(name),
-        serial(serial),
+        name(std::move(name)),
+        serial(std::move(serial)),
         uniqueID(id),
         standalone(standalone),
         usbDevices(std::move(devices)) {}
@@ -206,4 +255,113 @@ typedef std::vector<FreeWiliDevice> FreeWiliDevices;
    */
 auto find_all() noexcept -> std::expected<FreeWiliDevices, std::string>;
 
+/// How find_all() enumerates the host, only Linux has more than one backend.
+enum class FindBackend : uint32_t {
+    /// Platform default, libudev on Linux
+    Default,
+    /// Walk /sys directly, for hosts without a usable libudev (Linux only)
+    Sysfs,
+};
+
+/// Where a find_all() call spent its time, see FindOptions::stats.
+/// Phases a platform doesn't break down (only Linux does) stay at zero.
+struct FindStats {
+    /// Enumerating USB, serial and block devices, attribute reads included
+    std::chrono::nanoseconds enumerateTime {};
+    /// Reading the mount table and matching it to disks
+    std::chrono::nanoseconds mountTime {};
+    /// Indexing the enumeration and walking the hub children
+    std::chrono::nanoseconds resolveTime {};
+    /// Building FreeWiliDevices out of their USBDevices
+    std::chrono::nanoseconds buildTime {};
+    /// The whole find_all() call
+    std::chrono::nanoseconds totalTime {};
+    /// Devices handed over by the enumeration
+    uint64_t devicesVisited = 0;
+    /// udev sysattr or sysfs attribute reads
+    uint64_t attributeReads = 0;
+    /// USB devices kept for discovery
+    uint64_t usbDevicesMatched = 0;
+    /// FreeWiliDevices returned
+    uint64_t devicesFound = 0;
+};
+
+/// Options for find_all()
+struct FindOptions {
+    FindBackend backend = FindBackend::Default;
+    /// Directory holding the sys/ and proc/ trees to enumerate, empty for the live host.
+    /// Lets find_all() run against a captured or synthetic tree. udev can't be
+    /// redirected, so a root always enumerates with FindBackend::Sysfs (Linux only).
+    std::string root;
+    /// Overwritten with the timings and counters of the call when set. Nothing is
+    /// measured when left null.
+    FindStats* stats = nullptr;
+    /// Threads reading device attributes, the calling thread included. 0 picks one per core.
+    /// Only FindBackend::Sysfs reads in parallel, libudev objects are confined to one thread.
+    /// The result doesn't depend on it.
+    size_t threads = 1;
+    /// Cancels the call from another thread, it then fails with "Discovery was cancelled".
+    /// Checked between phases, between attribute reads by FindBackend::Sysfs and between
+    /// enumerated devices by libudev.
+    std::stop_token stop;
+};
+
+/**
+   * @brief Finds all Free-Wili devices attached to a host with the given options.
+   *
+   * Every backend produces the same FreeWiliDevices for the same host.
+   *
+   * @return FreeWiliDevices on success, std::string on failure or when the backend
+   * isn't available on this platform.
+   */
+auto find_all(const FindOptions& options) noexcept
+    -> std::expected<FreeWiliDevices, std::string>;
+
+/// Predicate for find_first(), it must not throw.
+using DevicePredicate = std::function<bool(const FreeWiliDevice&)>;
+
+/**
+   * @brief Finds the first Free-Wili device, in find_all() order, that predicate accepts.
+   *
+   * Devices are built and tested one at a time, the ones after the match never are.
+   *
+   * @return FreeWiliDevice on success, std::string on failure or when nothing matched.
+   */
+auto find_first(const DevicePredicate& predicate, const FindOptions& options = {}) noexcept
+    -> std::expected<FreeWiliDevice, std::string>;
+
+/**
+   * @brief Finds the Free-Wili device with the given serial, ie. "FX0025".
+   *
+   * Cheaper than find_all() on a crowded host, the serial ports and disks of the other
+   * devices are never looked up (Linux only, other platforms filter find_all()).
+   *
+   * @return FreeWiliDevice on success, std::string on failure or when no device has the serial.
+   */
+auto find_by_serial(const std::string& serial, const FindOptions& options = {}) noexcept
+    -> std::expected<FreeWiliDevice, std::string>;
+
+/**
+   * @brief Finds the Free-Wili device with the given FreeWiliDevice::uniqueID.
+   *
+   * Same cost as find_by_serial().
+   *
+   * @return FreeWiliDevice on success, std::string on failure or when no device has the ID.
+   */
+auto find_by_unique_id(uint64_t uniqueID, const FindOptions& options = {}) noexcept
+    -> std::expected<FreeWiliDevice, std::string>;
+
+/**
+   * @brief Re-resolves a device found earlier, ie. after flashing firmware.
+   *
+   * Only the hub of the device and the USB devices, serial ports and disks below it are
+   * read again (Linux only, other platforms look the device up in find_all()). The device
+   * is updated in place with what is attached now and keeps its uniqueID.
+   *
+   * @return Nothing on success, std::string on failure or when the device isn't connected
+   * anymore. The device is left untouched on failure.
+   */
+auto refresh(FreeWiliDevice& device, const FindOptions& options = {}) noexcept
+    -> std::expected<void, std::string>;
+
 }; // namespace Fw
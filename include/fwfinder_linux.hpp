@@ -0,0 +1,453 @@
+#pragma once
+#ifdef __linux__
+
+    #include <fwfinder.hpp>
+    #include <fwwatcher.hpp>
+
+    #include <sys/types.h>
+
+    #include <chrono>
+    #include <cstdint>
+    #include <expected>
+    #include <functional>
+    #include <istream>
+    #include <map>
+    #include <optional>
+    #include <set>
+    #include <stop_token>
+    #include <string>
+    #include <string_view>
+    #include <unordered_map>
+    #include <variant>
+    #include <vector>
+
+struct udev;
+struct udev_device;
+struct udev_monitor;
+
+/// Adds the time spent in its scope to one of the Fw::FindStats phases, the clock is
+/// never read when stats is null.
+class PhaseTimer {
+public:
+    PhaseTimer(Fw::FindStats* stats, std::chrono::nanoseconds Fw::FindStats::*phase) noexcept:
+        stats(stats),
+        phase(phase),
+        start(stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point {}
+        ) {}
+    ~PhaseTimer() {
+        if (stats) {
+            stats->*phase += std::chrono::steady_clock::now() - start;
+        }
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    Fw::FindStats* stats;
+    std::chrono::nanoseconds Fw::FindStats::*phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+/// A block device node, either a whole disk or one of its partitions
+struct BlockDevice {
+    /// major:minor
+    dev_t devNum;
+    /// /dev/sdX or /dev/sdX1
+    std::string devNode;
+};
+
+struct DiskInfo {
+    /// /sys/devices/pci0000:00/0000:00:01.2/0000:02:00.0/usb1/1-2/1-2.1
+    std::string devPath;
+    /// /dev/sdX
+    std::string diskName;
+    /// The disk followed by its partitions
+    std::vector<BlockDevice> blockDevices;
+    /// actual file-system mount paths
+    std::vector<std::string> mountPoints;
+};
+
+/// Mount points of every block device, read once per scan
+struct MountTable {
+    /// major:minor -> mount points, from /proc/self/mountinfo
+    std::unordered_map<dev_t, std::vector<std::string>> mountPointsByDevNum;
+    /// mount source (/dev/sdX1) -> mount points, only filled from the /proc/mounts fallback
+    std::unordered_map<std::string, std::vector<std::string>> mountPointsBySource;
+};
+
+/// @brief Parse the contents of /proc/self/mountinfo.
+/// @param mountInfo stream positioned at the start of the file
+/// @return MountTable keyed by major:minor.
+auto _parseMountInfo(std::istream& mountInfo) -> MountTable;
+
+/// @brief Snapshot the mount table, preferring mountinfo over the mounts fallback.
+/// @param mountInfoPath usually /proc/self/mountinfo
+/// @param mountsPath usually /proc/mounts, only read when mountInfoPath can't be opened
+/// @return MountTable, empty when neither file is readable.
+auto _readMountTable(const std::string& mountInfoPath, const std::string& mountsPath)
+    -> MountTable;
+
+/// @brief Collect the mount points of a disk and all of its partitions.
+/// @param mounts MountTable of the scan
+/// @param disk disk to resolve
+/// @return Mount points in disk, then partition order.
+auto _findMountPoints(const MountTable& mounts, const DiskInfo& disk) -> std::vector<std::string>;
+
+struct SerialInfo {
+    /// /sys/devices/pci0000:00/0000:00:01.2/0000:02:00.0/usb1/1-2/1-2.1
+    std::string devPath;
+    /// /dev/ttyACM0 /dev/ttyUSB0
+    std::string ttyName;
+};
+
+/// A usb_device node captured during the enumeration pass
+struct UsbNode {
+    /// /sys/devices/pci0000:00/0000:00:01.2/0000:02:00.0/usb1/1-2/1-2.1
+    std::string syspath;
+    /// syspath of the parent usb_device, empty for root hubs
+    std::string parentSyspath;
+    uint16_t vid;
+    uint16_t pid;
+    std::string manufacturer;
+    std::string product;
+    std::string serial;
+    /// USB physical location, 1 = first port
+    uint32_t location;
+    std::vector<uint32_t> portChain;
+};
+
+/// Everything discovery needs, captured from a single enumeration pass.
+///
+/// Scans only keep the usb_devices discovery reports, see _isDiscoveryCandidate(), along
+/// with the disks and serial ports hanging off of them.
+struct DeviceTable {
+    std::vector<UsbNode> usbDevices;
+    std::vector<DiskInfo> disks;
+    std::vector<SerialInfo> serialPorts;
+    /// Device ScanScope::ownerFilter accepted, built before the serial ports and disks were
+    /// read. _attachPortsAndDisks() completes it.
+    std::optional<Fw::FreeWiliDevice> matchedOwner;
+};
+
+/// @brief Whether discovery reports a usb_device: FreeWili hubs, everything below them and
+/// standalone devices. Decided on VID/PID alone so the rest of the host is rejected before
+/// any string attribute is read.
+/// @param nodesBySyspath every usb_device of the host by syspath, only the VID/PID and
+/// parentSyspath of the entries are looked at
+/// @param node usb_device to decide on
+auto _isDiscoveryCandidate(
+    const std::unordered_map<std::string_view, const UsbNode*>& nodesBySyspath,
+    const UsbNode& node
+) -> bool;
+
+/// What a targeted lookup knows of its device before anything is built, see _mayMatchOwner()
+struct OwnerKey {
+    /// FreeWiliDevice::serial, empty for any
+    std::string serial;
+    /// FreeWiliDevice::uniqueID, derived from the port chain of the owner
+    std::optional<uint64_t> uniqueID;
+};
+
+/// Narrows a scan down, the default scans the whole host
+struct ScanScope {
+    /// When set, only the first owner it accepts is kept, see _keepMatchingOwner()
+    Fw::DevicePredicate ownerFilter;
+    /// Owners that can't match it are dropped before their strings are read or they are built
+    OwnerKey ownerKey;
+    /// When set, the syspath of a usb_device: only it and the devices below it are enumerated
+    std::string subtree;
+};
+
+/// @brief Capture a DeviceTable by walking sysfs directly, without libudev.
+/// @param root directory holding sys/ and proc/, empty for the live host
+/// @param stats enumeration and mount phases are accounted here when set
+/// @param scope part of the host to keep
+/// @param threads attribute reads are spread over this many threads, see Fw::FindOptions
+/// @param stop no attribute is read once it is requested, the scan then fails
+/// @return DeviceTable identical to the udev scan of the same tree, std::string on failure.
+auto _scanSysfsDeviceTable(
+    const std::string& root,
+    Fw::FindStats* stats = nullptr,
+    const ScanScope& scope = {},
+    size_t threads = 1,
+    const std::stop_token& stop = {}
+) noexcept -> std::expected<DeviceTable, std::string>;
+
+/// @brief Capture a DeviceTable from udev, see _scanSysfsDeviceTable().
+/// stop is checked between the devices of the enumeration.
+auto _scanDeviceTable(
+    Fw::FindStats* stats = nullptr,
+    const ScanScope& scope = {},
+    const std::stop_token& stop = {}
+) noexcept -> std::expected<DeviceTable, std::string>;
+
+/// Lookup structures built once per scan over a DeviceTable.
+///
+/// The index holds views into the table, so it must not outlive it.
+struct DeviceIndex {
+    /// usb_device syspath -> node
+    std::unordered_map<std::string_view, const UsbNode*> nodesBySyspath;
+    /// parent usb_device syspath -> direct children, in table order
+    std::unordered_map<std::string_view, std::vector<const UsbNode*>> childrenBySyspath;
+    /// usb_device syspath -> disk hanging off of it
+    std::unordered_map<std::string_view, const DiskInfo*> disksBySyspath;
+    /// usb_device syspath -> serial port hanging off of it
+    std::unordered_map<std::string_view, const SerialInfo*> serialPortsBySyspath;
+};
+
+/// @brief Build the syspath, parent -> children, disk and serial port lookups for a table.
+/// @param table DeviceTable captured by the enumeration pass
+/// @return DeviceIndex referencing the nodes in table.
+auto _buildDeviceIndex(const DeviceTable& table) -> DeviceIndex;
+
+/// @brief Collect every usb_device below a hub.
+/// @param index DeviceIndex of the scan
+/// @param hubSyspath syspath of the hub
+/// @return All descendants of the hub in table order, the hub itself excluded.
+auto _findUsbHubChildren(const DeviceIndex& index, std::string_view hubSyspath)
+    -> std::vector<const UsbNode*>;
+
+/// @brief Find the disk of a usb_device, or of its nearest usb_device ancestor.
+/// @param index DeviceIndex of the scan
+/// @param node usb_device to resolve
+/// @return DiskInfo on success, nullptr when nothing is attached. Cost is O(tree depth).
+auto _findDiskInfo(const DeviceIndex& index, const UsbNode& node) -> const DiskInfo*;
+
+/// @brief Find the serial port of a usb_device, or of its nearest usb_device ancestor.
+/// @param index DeviceIndex of the scan
+/// @param node usb_device to resolve
+/// @return SerialInfo on success, nullptr when nothing is attached. Cost is O(tree depth).
+auto _findSerialInfo(const DeviceIndex& index, const UsbNode& node) -> const SerialInfo*;
+
+/// @brief uniqueID FreeWiliDevice::fromUSBDevices() derives from the port chain of a hub or a
+/// standalone device, defined in fwfinder.cpp.
+auto _generateUniqueIDFromUSBPortChain(const std::vector<uint32_t>& usbPortChain) -> uint64_t;
+
+/// @brief Whether a usb_device is reported as a FreeWiliDevice of its own: a FreeWili hub, or a
+/// standalone device that isn't plugged into one.
+auto _isDiscoveryOwner(const DeviceIndex& index, const UsbNode& node) -> bool;
+
+/// @brief Collect the owners of a table, see _isDiscoveryOwner().
+/// @return Owners sorted by the uniqueID of their FreeWiliDevice, like find_all() reports them.
+auto _findDiscoveryOwners(const DeviceTable& table, const DeviceIndex& index)
+    -> std::vector<const UsbNode*>;
+
+/// @brief Build the FreeWiliDevice of an owner, from the hub and every usb_device below it or
+/// from the standalone device alone.
+/// FreeWiliDevice::fromUSBDevices() is accounted to FindStats::buildTime when stats is set.
+auto _discoverOwner(const DeviceIndex& index, const UsbNode& owner, Fw::FindStats* stats = nullptr)
+    -> std::expected<Fw::FreeWiliDevice, std::string>;
+
+/// @brief Whether owner can be the device key is after, from the usb_devices alone.
+/// The port chain of the owner gives its uniqueID. Its serial is the one of the owner or, for a
+/// hub, of a usb_device below it, the walk stops at the first one carrying it.
+/// @param index DeviceIndex of the scan, only the usb_devices are looked at
+/// @param owner owner to decide on, see _isDiscoveryOwner()
+/// @param key raw identity of a targeted lookup, an empty key accepts every owner
+auto _mayMatchOwner(const DeviceIndex& index, const UsbNode& owner, const OwnerKey& key) -> bool;
+
+/// @brief Drop every usb_device but those of the owners key may match, see _mayMatchOwner().
+/// Scans run it once port chains, and serials when key has one, are read and before any other
+/// string attribute is.
+/// @param table DeviceTable holding usb_devices only
+/// @param key raw identity of a targeted lookup
+/// @return Positions in table.usbDevices, before the call, of the usb_devices kept.
+auto _keepOwnersMatchingKey(DeviceTable& table, const OwnerKey& key) -> std::vector<size_t>;
+
+/// @brief Drop every usb_device but those of the first owner, in uniqueID order, whose device
+/// matches, and keep that device in table.matchedOwner. Scans run it before serial ports and
+/// disks are attached, the devices matches() sees carry names, serials and unique IDs only.
+/// @param table DeviceTable holding usb_devices only
+/// @param matches identity test of a targeted lookup
+auto _keepMatchingOwner(DeviceTable& table, const Fw::DevicePredicate& matches) -> void;
+
+/// @brief Fill in the serial ports and mount points of a device built before they were read.
+/// @param index DeviceIndex of the scan that built device
+/// @param device device whose USBDevices are completed, found by their syspath
+auto _attachPortsAndDisks(const DeviceIndex& index, Fw::FreeWiliDevice& device) -> void;
+
+/// @brief Discover standalone devices (badges, Winky, UF2) that aren't behind a FreeWili hub.
+/// FreeWiliDevice::fromUSBDevices() is accounted to FindStats::buildTime when stats is set.
+auto _find_all_standalone(
+    const DeviceTable& table,
+    const DeviceIndex& index,
+    Fw::FindStats* stats = nullptr
+) noexcept -> Fw::FreeWiliDevices;
+
+/// @brief Discover FREE-WILi and FREE-WILi2 devices from their internal hubs.
+/// FreeWiliDevice::fromUSBDevices() is accounted to FindStats::buildTime when stats is set.
+auto _find_all_freewili(
+    const DeviceTable& table,
+    const DeviceIndex& index,
+    Fw::FindStats* stats = nullptr
+) noexcept -> Fw::FreeWiliDevices;
+
+/// A partition of a USB disk
+struct PartitionInfo {
+    /// syspath of the disk the partition belongs to
+    std::string diskSyspath;
+    BlockDevice blockDevice;
+};
+
+/// @brief Enumerate every device of the usb, tty and block subsystems in a single pass.
+/// @param udev udev context
+/// @param callback called for each device, the device is released once it returns
+/// @param parent when set, only parent and the devices below it are enumerated
+/// @param stop no device is handed to callback once it is requested
+auto _enumerateUdevDevices(
+    struct udev* udev,
+    const std::function<void(udev_device*)>& callback,
+    udev_device* parent = nullptr,
+    const std::stop_token& stop = {}
+) -> void;
+
+/// @brief Decode a usb_device, interfaces and devices without a VID/PID are skipped.
+/// Attribute reads are counted in stats when set.
+auto _usbNodeFromUdev(udev_device* dev, Fw::FindStats* stats = nullptr)
+    -> std::optional<UsbNode>;
+
+/// @brief Decode a tty that hangs off of a usb_device.
+auto _serialInfoFromUdev(udev_device* tty) -> std::optional<SerialInfo>;
+
+/// @brief Decode a whole disk that hangs off of a usb_device, mount points are left empty.
+auto _diskInfoFromUdev(udev_device* disk) -> std::optional<DiskInfo>;
+
+/// @brief Decode a partition, the caller decides whether its disk is of interest.
+auto _partitionInfoFromUdev(udev_device* partition) -> std::optional<PartitionInfo>;
+
+/// Tells a Fw::DiscoveryCache whether anything discovery reads may have changed.
+///
+/// The live host with the default backend is watched through a udev monitor and POLLPRI on
+/// /proc/self/mountinfo. Sysfs scans and captured trees compare the entries of the usb, tty
+/// and block directories and the mount table files instead.
+class HostChangeProbe {
+public:
+    explicit HostChangeProbe(const Fw::FindOptions& options) noexcept;
+    HostChangeProbe(const HostChangeProbe&) = delete;
+    HostChangeProbe& operator=(const HostChangeProbe&) = delete;
+    ~HostChangeProbe();
+
+    /// @brief Check for changes without blocking, pending notifications are consumed.
+    /// @return true when something changed since the last call or construction.
+    auto changed() noexcept -> bool;
+
+private:
+    auto _signature() const -> std::string;
+
+    /// sys/ and proc/ parent, empty for the live host
+    std::string root;
+    struct udev* udev = nullptr;
+    struct udev_monitor* monitor = nullptr;
+    /// /proc/self/mountinfo of the live host, -1 otherwise
+    int mountInfoFd = -1;
+    /// Last _signature(), only used without a monitor
+    std::string signature;
+};
+
+enum class TopologyAction : uint32_t {
+    Add,
+    Change,
+    Remove,
+};
+
+/// A hotplug event reduced to what the topology needs, decoded from udev or replayed
+/// from a recording
+struct TopologyEvent {
+    TopologyAction action;
+    /// syspath of the usb_device, tty, disk or partition the event is about
+    std::string syspath;
+    /// Decoded device for Add and Change, removals only carry the syspath
+    std::variant<std::monostate, UsbNode, SerialInfo, DiskInfo, PartitionInfo> device;
+};
+
+/// @brief Decode a udev device into a TopologyEvent.
+/// @param dev device from an enumeration or a udev_monitor
+/// @param action action reported by udev
+/// @return TopologyEvent, std::nullopt for devices discovery doesn't care about.
+auto _topologyEventFromUdev(udev_device* dev, TopologyAction action)
+    -> std::optional<TopologyEvent>;
+
+/// USB topology kept up to date from hotplug events.
+///
+/// Every node belongs to at most one owner: its nearest FreeWili hub, or itself when it is a
+/// standalone device. Events only mark owners dirty, flush() re-runs discovery on the subtree
+/// of each dirty owner and diffs the result against what it reported before.
+class DeviceTopology {
+public:
+    /// @brief Apply a single event, discovery is deferred until flush().
+    auto apply(const TopologyEvent& event) -> void;
+
+    /// @brief Apply a recorded or received batch of events.
+    ///
+    /// Pending changes are flushed before every removal so a device that appears and
+    /// disappears within one batch (UF2 bootloaders) still reports Added then Removed.
+    /// @return DeviceEvents produced by the batch.
+    auto replay(const std::vector<TopologyEvent>& events) -> Fw::DeviceEvents;
+
+    /// @brief Re-resolve disk mount points, owners of disks whose mounts changed are marked dirty.
+    auto updateMounts(MountTable mounts) -> void;
+
+    /// @brief Rebuild every dirty owner.
+    /// @return DeviceEvents since the last flush, ordered by uniqueID.
+    auto flush() -> Fw::DeviceEvents;
+
+    /// @brief Devices currently known, sorted by uniqueID.
+    auto devices() const -> Fw::FreeWiliDevices;
+
+private:
+    auto _ownerOf(const std::string& usbSyspath) const -> std::optional<std::string>;
+    auto _markDirty(const std::string& usbSyspath) -> void;
+    auto _refreshDisk(const std::string& diskSyspath) -> void;
+    auto _discover(const std::string& owner) const -> Fw::FreeWiliDevices;
+
+    /// usb_device syspath -> node, ordered so a subtree is a contiguous range
+    std::map<std::string, UsbNode> nodes;
+    /// tty syspath -> serial port
+    std::map<std::string, SerialInfo> serialPorts;
+    /// disk syspath -> disk and its partitions
+    std::map<std::string, DiskInfo> disks;
+    /// partition syspath -> partition
+    std::map<std::string, PartitionInfo> partitions;
+    MountTable mounts;
+    /// Set by add and change events, a removal after them flushes first
+    bool pendingAdditions = false;
+
+    /// Owners that need discovery on the next flush
+    std::set<std::string> dirtyOwners;
+    /// owner syspath -> uniqueIDs it produced on the last flush
+    std::map<std::string, std::vector<uint64_t>> ownerDevices;
+    /// uniqueID -> device as last reported
+    std::map<uint64_t, Fw::FreeWiliDevice> devicesById;
+};
+
+/// What _waitForDevice() blocks on, a udev monitor and /proc/self/mountinfo on a live host
+struct TopologyWaitSources {
+    /// Readable when drain() has events to hand over
+    int eventFd = -1;
+    /// Raises POLLPRI when the mount table changed, -1 to only re-read mounts on block events
+    int mountInfoFd = -1;
+    /// Takes every queued event without blocking
+    std::function<std::vector<TopologyEvent>()> drain;
+    /// Current mount table, read after a mount change or a disk or partition event
+    std::function<MountTable()> readMounts;
+};
+
+/// @brief Apply events from sources until the topology reports a device predicate accepts.
+///
+/// Devices the topology already holds are checked first. Added and Changed events are checked
+/// as they come, so a device rejected because its disk isn't mounted yet is offered again
+/// once the mount shows up. topology must already hold the attached devices, a node whose
+/// FreeWili hub it doesn't know isn't attributed to that hub.
+/// @param topology kept up to date with everything received while waiting
+/// @param sources where events and mount changes come from
+/// @param predicate called once per candidate
+/// @param deadline when to give up
+/// @return The first accepted device, std::string on timeout or when poll() fails.
+auto _waitForDevice(
+    DeviceTopology& topology,
+    const TopologyWaitSources& sources,
+    const Fw::DevicePredicate& predicate,
+    std::chrono::steady_clock::time_point deadline
+) -> std::expected<Fw::FreeWiliDevice, std::string>;
+
+#endif // __linux__
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <fwfinder.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Fw {
+
+/// Kind of change reported by the DeviceWatcher
+enum class DeviceEventType : uint32_t {
+    /// A FreeWiliDevice appeared
+    Added,
+    /// A FreeWiliDevice went away, the event carries its last known state
+    Removed,
+    /// A FreeWiliDevice is still present but its USB devices, ports or paths changed
+    Changed,
+};
+
+auto getDeviceEventTypeName(DeviceEventType type) -> std::string;
+
+/// A change of a single FreeWiliDevice, keyed by FreeWiliDevice::uniqueID
+struct DeviceEvent {
+    DeviceEventType type;
+    FreeWiliDevice device;
+};
+
+/// Container of DeviceEvents, in the order they happened.
+typedef std::vector<DeviceEvent> DeviceEvents;
+
+/**
+ * @brief Watches the host for FreeWili devices being plugged, unplugged or changed.
+ *
+ * The watcher keeps the USB topology up to date from hotplug notifications instead
+ * of rescanning, only the FreeWiliDevice owning a changed node is rebuilt.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwwatcher.hpp>
+ * #include <poll.h>
+ *
+ * auto watcher = Fw::DeviceWatcher::create();
+ * if (!watcher.has_value()) {
+ *    std::println("Failed to watch devices: {}", watcher.error());
+ *    return;
+ * }
+ * pollfd pfd { .fd = watcher->fd(), .events = POLLIN, .revents = 0 };
+ * while (::poll(&pfd, 1, -1) > 0) {
+ *    for (auto& event : watcher->poll().value_or(Fw::DeviceEvents {})) {
+ *      std::println("{}: {}", Fw::getDeviceEventTypeName(event.type), event.device.name);
+ *    }
+ * }
+ * @endcode
+ */
+class DeviceWatcher {
+public:
+    /**
+     * @brief Starts listening for hotplug events and captures the devices already attached.
+     *
+     * @return DeviceWatcher on success, std::string on failure or when the platform
+     * has no hotplug support.
+     */
+    static auto create() noexcept -> std::expected<DeviceWatcher, std::string>;
+
+    DeviceWatcher(DeviceWatcher&& other) noexcept;
+    DeviceWatcher& operator=(DeviceWatcher&& other) noexcept;
+    DeviceWatcher(const DeviceWatcher&) = delete;
+    DeviceWatcher& operator=(const DeviceWatcher&) = delete;
+    ~DeviceWatcher();
+
+    /// File descriptor that becomes readable when poll() has events to process, hotplug
+    /// notifications and mount table changes alike. Suitable for poll(), select() or epoll.
+    /// The watcher keeps ownership of it.
+    auto fd() const noexcept -> int;
+
+    /**
+     * @brief Processes every pending hotplug notification without blocking.
+     *
+     * A volume being mounted or unmounted reports its device as Changed, with
+     * FreeWiliDevice::getMassStoragePaths() up to date.
+     *
+     * @return DeviceEvents since the last call (possibly empty), std::string on failure.
+     */
+    auto poll() noexcept -> std::expected<DeviceEvents, std::string>;
+
+    /// Devices currently attached, sorted by uniqueID like find_all().
+    auto devices() const noexcept -> FreeWiliDevices;
+
+    /**
+     * @brief Blocks until a device accepted by predicate is attached.
+     *
+     * Devices already attached are checked first, then every Added or Changed device as the
+     * hotplug notifications come in. A FreeWili is usually reported before its disk is
+     * mounted, a predicate that needs MassStorage paths is called again once they show up.
+     * Events handled while waiting are not returned by a later poll(), devices() has them.
+     *
+     * @param predicate called once per candidate
+     * @param timeout how long to wait for
+     * @return The first accepted device, std::string on timeout or failure.
+     */
+    auto wait_for(const DevicePredicate& predicate, std::chrono::milliseconds timeout) noexcept
+        -> std::expected<FreeWiliDevice, std::string>;
+
+private:
+    struct Impl;
+
+    explicit DeviceWatcher(std::unique_ptr<Impl> impl) noexcept;
+
+    std::unique_ptr<Impl> impl;
+};
+
+/**
+ * @brief Waits for a device accepted by predicate to be plugged in, see DeviceWatcher::wait_for().
+ *
+ * The host is enumerated once the udev monitor listens, like DeviceWatcher::create() does, so
+ * a device coming back under a hub that stayed plugged in belongs to that hub.
+ *
+ * @code{.cpp}
+ *
+ * #include <fwwatcher.hpp>
+ *
+ * // Wait for the UF2 bootloader to show up with its drive mounted
+ * auto uf2 = Fw::wait_for(
+ *     [](const Fw::FreeWiliDevice& device) {
+ *         auto storage = device.getUSBDevices(Fw::USBDeviceType::MassStorage);
+ *         return device.deviceType == Fw::DeviceType::UF2 && !storage.empty()
+ *             && storage[0].paths.has_value() && !storage[0].paths->empty();
+ *     },
+ *     std::chrono::seconds(10)
+ * );
+ * @endcode
+ *
+ * @return The first accepted device, std::string on timeout or when the platform has no
+ * hotplug support.
+ */
+auto wait_for(const DevicePredicate& predicate, std::chrono::milliseconds timeout) noexcept
+    -> std::expected<FreeWiliDevice, std::string>;
+
+/**
+ * @brief Waits for the MassStorage volumes of device to be mounted, so files can be copied
+ * to it without racing the automounter.
+ *
+ * Only device is re-read, see refresh(), each time the mount table changes or udev reports
+ * a device. A captured tree (FindOptions::root) is re-read when a file below its proc/ is
+ * written instead.
+ *
+ * @param device typically from find_all() or a DeviceWatcher event, left untouched
+ * @param timeout how long to wait for
+ * @param options as for refresh()
+ * @return device with FreeWiliDevice::getMassStoragePaths() filled in, right away when it
+ * already is. std::string when device has no MassStorage, on timeout or failure.
+ */
+auto wait_for_mount(
+    const FreeWiliDevice& device,
+    std::chrono::milliseconds timeout,
+    const FindOptions& options = {}
+) noexcept -> std::expected<FreeWiliDevice, std::string>;
+
+}; // namespace Fw
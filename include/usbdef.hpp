@@ -1,8 +1,11 @@
 #pragma once
 
+#include <fwfinder.hpp>
+
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <map>
-#include <vector>
+#include <iterator>
 
 namespace Fw {
 /*
@@ -92,36 +95,104 @@ const uint16_t USB_PID_FW_DEFCON_2024 = 0x2057;
 /// DEFCON 2025 FreeWili Badge Product ID
 const uint16_t USB_PID_FW_DEFCON_BADGE_2025 = 0x2058;
 
-static std::map<uint16_t, std::vector<uint16_t>> WhitelistVIDPID = {
-    { USB_VID_FW_HUB,
-      {
-          USB_PID_FW_HUB,
-      } },
-    { USB_VID_FW_FTDI,
-      {
-          USB_PID_FW_FTDI,
-      } },
-    { USB_VID_FW_RPI,
-      { USB_PID_FW_RPI_CDC_PID,
-        USB_PID_FW_RPI_2040_UF2_PID,
-        USB_PID_FW_RPI_2350_UF2_PID,
-        USB_PID_FW2_DEBUG_PROBE } },
-    { USB_VID_FW2_ESP32,
-      {
-          USB_PID_FW2_ESP32_JTAG,
-      } },
-    { USB_VID_FW_ICS,
-      { USB_PID_FW_MAIN_CDC_PID,
-        USB_PID_FW_DISPLAY_CDC_PID,
-        USB_PID_FW_WINKY,
-        USB_PID_FW_DEFCON_2024,
-        USB_PID_FW_DEFCON_BADGE_2025,
-        USB_PID_FW2_HUB,
-        USB_PID_FW2_MAIN,
-        USB_PID_FW2_DISPLAY,
-        USB_PID_FW2_MASS_STORAGE } },
+/// What the finder knows about a VID/PID pair
+struct USBDeviceDescriptor {
+    uint16_t vid;
+    uint16_t pid;
+    /// Classification reported by getUSBDeviceTypeFrom(), Serial is refined by hub location
+    USBDeviceType kind;
+    /// Internal hub a FreeWili is built around, see is_freewili_hub()
+    bool hub = false;
+    /// Enumerates on its own instead of behind a FreeWili hub, see isStandAloneDevice()
+    bool standalone = false;
+
+    /// Lookup key, VID in the high half
+    constexpr auto key() const -> uint32_t {
+        return static_cast<uint32_t>(vid) << 16 | pid;
+    }
+};
+
+/// Every VID/PID pair that is part of a FreeWili, in VID then PID order.
+/// Pairs shared by FREE-WILi and FREE-WILi2 components (FTDI, ESP32) are listed once.
+inline constexpr USBDeviceDescriptor KnownUSBDevices[] = {
+    { USB_VID_FW_FTDI, USB_PID_FW_FTDI, USBDeviceType::FTDI },
+    { USB_VID_FW_HUB, USB_PID_FW_HUB, USBDeviceType::Hub, true },
+    { USB_VID_FW_ICS, USB_PID_FW_MAIN_CDC_PID, USBDeviceType::SerialMain },
+    { USB_VID_FW_ICS, USB_PID_FW_DISPLAY_CDC_PID, USBDeviceType::SerialDisplay },
+    { USB_VID_FW_ICS, USB_PID_FW_WINKY, USBDeviceType::SerialMain, false, true },
+    { USB_VID_FW_ICS, USB_PID_FW_DEFCON_2024, USBDeviceType::SerialMain, false, true },
+    { USB_VID_FW_ICS, USB_PID_FW_DEFCON_BADGE_2025, USBDeviceType::SerialMain, false, true },
+    { USB_VID_FW2_HUB, USB_PID_FW2_HUB, USBDeviceType::Hub, true },
+    { USB_VID_FW2_MAIN, USB_PID_FW2_MAIN, USBDeviceType::SerialMain },
+    { USB_VID_FW2_MASS_STORAGE, USB_PID_FW2_MASS_STORAGE, USBDeviceType::MassStorage },
+    { USB_VID_FW2_DISPLAY, USB_PID_FW2_DISPLAY, USBDeviceType::SerialDisplay },
+    { USB_VID_FW_RPI, USB_PID_FW_RPI_2040_UF2_PID, USBDeviceType::MassStorage },
+    { USB_VID_FW_RPI, USB_PID_FW_RPI_CDC_PID, USBDeviceType::Serial },
+    { USB_VID_FW2_DEBUG_PROBE, USB_PID_FW2_DEBUG_PROBE, USBDeviceType::DebugProbe },
+    { USB_VID_FW_RPI, USB_PID_FW_RPI_2350_UF2_PID, USBDeviceType::MassStorage, false, true },
+    { USB_VID_FW2_ESP32, USB_PID_FW2_ESP32_JTAG, USBDeviceType::ESP32 },
+};
+
+/// Open addressing without probing: every KnownUSBDevices key lands in its own slot.
+struct _USBDescriptorHash {
+    static constexpr size_t slotBits = 6;
+    /// Multiplier found at compile time, 0 when no collision free one exists
+    uint32_t multiplier;
+    /// Index into KnownUSBDevices plus one, 0 for an empty slot
+    std::array<uint8_t, size_t { 1 } << slotBits> slots;
+
+    constexpr auto slotOf(uint32_t key) const -> size_t {
+        return (key * multiplier) >> (32 - slotBits);
+    }
 };
 
+consteval auto _buildUSBDescriptorHash() -> _USBDescriptorHash {
+    for (size_t i = 0; i < std::size(KnownUSBDevices); ++i) {
+        for (size_t j = i + 1; j < std::size(KnownUSBDevices); ++j) {
+            if (KnownUSBDevices[i].key() == KnownUSBDevices[j].key()) {
+                return _USBDescriptorHash { 0, {} };
+            }
+        }
+    }
+    // Odd multipliers from the golden ratio onwards, a handful of tries is enough for the
+    // table to spread over 64 slots
+    for (uint32_t multiplier = 0x9E3779B1; multiplier != 0x9E3779B1 + 2 * 4096; multiplier += 2) {
+        _USBDescriptorHash hash { multiplier, {} };
+        bool collision = false;
+        for (size_t i = 0; i < std::size(KnownUSBDevices) && !collision; ++i) {
+            auto& slot = hash.slots[hash.slotOf(KnownUSBDevices[i].key())];
+            collision = slot != 0;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        if (!collision) {
+            return hash;
+        }
+    }
+    return _USBDescriptorHash { 0, {} };
+}
+
+inline constexpr _USBDescriptorHash USBDescriptorHash = _buildUSBDescriptorHash();
+static_assert(
+    USBDescriptorHash.multiplier != 0,
+    "KnownUSBDevices has duplicate pairs or outgrew the hash, raise slotBits"
+);
+
+/// @brief Look up a VID/PID pair in KnownUSBDevices, usable in constant expressions.
+///
+/// One multiply, one table load and one compare, no static initialization or heap.
+///
+/// @param vid USB Vendor ID
+/// @param pid USB Product ID
+/// @return Descriptor of the pair, nullptr when it isn't part of a FreeWili.
+constexpr auto find_usb_descriptor(uint16_t vid, uint16_t pid) -> const USBDeviceDescriptor* {
+    const uint32_t key = static_cast<uint32_t>(vid) << 16 | pid;
+    const uint8_t index = USBDescriptorHash.slots[USBDescriptorHash.slotOf(key)];
+    if (index == 0 || KnownUSBDevices[index - 1].key() != key) {
+        return nullptr;
+    }
+    return &KnownUSBDevices[index - 1];
+}
+
 auto is_vid_pid_whitelisted(uint16_t vid, uint16_t pid) -> bool;
 
 /// @brief Check if a VID/PID pair identifies a USB hub that a FreeWili is built around.
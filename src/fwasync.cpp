@@ -0,0 +1,179 @@
+#include <fwasync.hpp>
+#include <fwfinder.hpp>
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/// Library-owned threads the async scans run on, joined when the library is unloaded.
+///
+/// Threads are started as scans come in, up to maxThreads, and then wait for the next one.
+/// Shutdown requests a stop: scans still running are cancelled through FindOptions::stop and
+/// the queued ones run straight into the cancellation, so every future and coroutine gets its
+/// result before the threads are joined.
+class _ScanThreads {
+public:
+    using Scan = std::move_only_function<void(std::stop_token)>;
+
+    static constexpr size_t maxThreads = 4;
+
+    static auto instance() -> _ScanThreads& {
+        static _ScanThreads threads;
+        return threads;
+    }
+
+    ~_ScanThreads() {
+        std::lock_guard lock(mutex);
+        for (auto& thread: threads) {
+            thread.request_stop();
+        }
+    }
+
+    /// Queues scan, an error when there is no thread to run it on.
+    auto submit(Scan scan) noexcept -> std::expected<void, std::string> {
+        std::lock_guard lock(mutex);
+        try {
+            if (idle == 0 && threads.size() < maxThreads) {
+                threads.emplace_back([this](std::stop_token stop) { _run(stop); });
+            }
+        } catch (const std::system_error& error) {
+            if (threads.empty()) {
+                return std::unexpected(std::string("Failed to start discovery: ") + error.what());
+            }
+            // The threads already running pick it up
+        }
+        try {
+            scans.push_back(std::move(scan));
+        } catch (const std::bad_alloc&) {
+            return std::unexpected("Failed to start discovery: out of memory");
+        }
+        pending.notify_one();
+        return {};
+    }
+
+private:
+    _ScanThreads() = default;
+
+    auto _run(std::stop_token stop) -> void {
+        std::unique_lock lock(mutex);
+        while (true) {
+            ++idle;
+            pending.wait(lock, stop, [this] { return !scans.empty(); });
+            --idle;
+            if (scans.empty()) {
+                return;
+            }
+            auto scan = std::move(scans.front());
+            scans.pop_front();
+            lock.unlock();
+            scan(stop);
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable_any pending;
+    std::deque<Scan> scans;
+    size_t idle = 0;
+    // Declared last, joined before the queue they drain is destroyed
+    std::vector<std::jthread> threads;
+};
+
+// find_all(options), cancelled by the caller's token or by the library shutting down
+static auto _find_all(Fw::FindOptions options, std::stop_token shutdown)
+    -> std::expected<Fw::FreeWiliDevices, std::string> {
+    std::stop_source stop;
+    std::stop_callback onShutdown(shutdown, [&stop] { stop.request_stop(); });
+    std::stop_callback onCancel(options.stop, [&stop] { stop.request_stop(); });
+    options.stop = stop.get_token();
+    return Fw::find_all(options);
+}
+
+auto Fw::find_all_async(Fw::FindOptions options) noexcept
+    -> std::future<std::expected<Fw::FreeWiliDevices, std::string>> {
+    std::promise<std::expected<Fw::FreeWiliDevices, std::string>> promise;
+    auto future = promise.get_future();
+    auto scan = [promise = std::move(promise),
+                 options = std::move(options)](std::stop_token stop) mutable {
+        promise.set_value(_find_all(std::move(options), stop));
+    };
+    auto submitted = _ScanThreads::instance().submit(std::move(scan));
+    if (!submitted.has_value()) {
+        std::promise<std::expected<Fw::FreeWiliDevices, std::string>> failed;
+        failed.set_value(std::unexpected(submitted.error()));
+        return failed.get_future();
+    }
+    return future;
+}
+
+/// Shared by the awaitable and the thread scanning for it, either may go first
+struct Fw::FindAllAwaitable::State {
+    Fw::FindOptions options;
+    Fw::ResumeExecutor resume;
+    std::optional<std::expected<Fw::FreeWiliDevices, std::string>> result;
+};
+
+Fw::FindAllAwaitable::FindAllAwaitable(
+    Fw::FindOptions options,
+    Fw::ResumeExecutor resume
+) noexcept:
+    options(std::move(options)),
+    resume(std::move(resume)) {}
+
+auto Fw::FindAllAwaitable::await_ready() const noexcept -> bool {
+    return false;
+}
+
+auto Fw::FindAllAwaitable::await_suspend(std::coroutine_handle<> handle) noexcept -> bool {
+    try {
+        state = std::make_shared<State>(State {
+            .options = std::move(options),
+            .resume = std::move(resume),
+            .result = std::nullopt,
+        });
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+    // The awaitable may be gone by the time the scan is done, the thread holds on to the state
+    auto scan = [handle, state = state](std::stop_token stop) {
+        state->result = _find_all(std::move(state->options), stop);
+        if (state->resume) {
+            state->resume(handle);
+        } else {
+            handle.resume();
+        }
+    };
+    auto submitted = _ScanThreads::instance().submit(std::move(scan));
+    if (!submitted.has_value()) {
+        state->result = std::unexpected(submitted.error());
+        return false;
+    }
+    return true;
+}
+
+auto Fw::FindAllAwaitable::await_resume() noexcept
+    -> std::expected<Fw::FreeWiliDevices, std::string> {
+    if (!state) {
+        return std::unexpected("Failed to start discovery: out of memory");
+    }
+    if (!state->result.has_value()) {
+        return std::unexpected("FindAllAwaitable was resumed before discovery finished");
+    }
+    return std::move(state->result.value());
+}
+
+auto Fw::find_all_awaitable(Fw::FindOptions options, Fw::ResumeExecutor resume) noexcept
+    -> Fw::FindAllAwaitable {
+    return Fw::FindAllAwaitable(std::move(options), std::move(resume));
+}
@@ -13,11 +13,21 @@ FreeWiliDeviceBuilder& FreeWiliDeviceBuilder::setName(const std::string& name) {
     return *this;
 }
 
+FreeWiliDeviceBuilder& FreeWiliDeviceBuilder::setName(std::string&& name) {
+    name_ = std::move(name);
+    return *this;
+}
+
 FreeWiliDeviceBuilder& FreeWiliDeviceBuilder::setSerial(const std::string& serial) {
     serial_ = serial;
     return *this;
 }
 
+FreeWiliDeviceBuilder& FreeWiliDeviceBuilder::setSerial(std::string&& serial) {
+    serial_ = std::move(serial);
+    return *this;
+}
+
 FreeWiliDeviceBuilder& FreeWiliDeviceBuilder::setUniqueID(uint64_t id) {
     uniqueID_ = id;
     return *this;
@@ -46,8 +56,8 @@ std::expected<FreeWiliDevice, std::string> FreeWiliDeviceBuilder::build() {
     // All required fields are present, construct the device
     return FreeWiliDevice(
         deviceType_.value(),
-        name_.value(),
-        serial_.value(),
+        std::move(name_.value()),
+        std::move(serial_.value()),
         uniqueID_.value(),
         standalone_.value(),
         std::move(usbDevices_.value())
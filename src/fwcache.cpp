@@ -0,0 +1,109 @@
+#include <fwcache.hpp>
+#include <fwfinder.hpp>
+
+#ifdef __linux__
+    #include <fwfinder_linux.hpp>
+#endif
+
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#if !defined(__linux__)
+
+// Other platforms have no cheap way to tell, every snapshot() rescans
+class HostChangeProbe {
+public:
+    explicit HostChangeProbe(const Fw::FindOptions&) noexcept {}
+
+    auto changed() noexcept -> bool {
+        return true;
+    }
+};
+
+#endif // !__linux__
+
+struct Fw::DiscoveryCache::Impl {
+    explicit Impl(Fw::FindOptions options) noexcept:
+        options(std::move(options)),
+        probe(this->options) {}
+
+    Fw::FindOptions options;
+    /// Guards everything below, held across a rescan so concurrent callers share it
+    std::mutex mutex;
+    HostChangeProbe probe;
+    /// Set when the probe saw a change that hasn't been rescanned yet
+    bool stale = false;
+    std::shared_ptr<const Fw::DiscoverySnapshot> current;
+};
+
+auto Fw::DiscoveryCache::instance() noexcept -> Fw::DiscoveryCache& {
+    static Fw::DiscoveryCache cache;
+    return cache;
+}
+
+Fw::DiscoveryCache::DiscoveryCache(Fw::FindOptions options) noexcept:
+    impl(std::make_unique<Impl>(std::move(options))) {}
+
+Fw::DiscoveryCache::DiscoveryCache(DiscoveryCache&& other) noexcept = default;
+
+Fw::DiscoveryCache& Fw::DiscoveryCache::operator=(DiscoveryCache&& other) noexcept = default;
+
+Fw::DiscoveryCache::~DiscoveryCache() = default;
+
+auto Fw::DiscoveryCache::snapshot() noexcept
+    -> std::expected<std::shared_ptr<const Fw::DiscoverySnapshot>, std::string> {
+    if (!impl) {
+        return std::unexpected("DiscoveryCache has been moved from");
+    }
+    std::lock_guard lock(impl->mutex);
+    // Consumed before the scan, a change that races with it is seen by the next call
+    impl->stale |= impl->probe.changed();
+    if (impl->current && !impl->stale) {
+        return impl->current;
+    }
+    auto devices = Fw::find_all(impl->options);
+    if (!devices.has_value()) {
+        impl->stale = true;
+        return std::unexpected(devices.error());
+    }
+    impl->current = std::make_shared<const Fw::DiscoverySnapshot>(Fw::DiscoverySnapshot {
+        .generation = impl->current ? impl->current->generation + 1 : 1,
+        .devices = std::move(devices.value()),
+    });
+    impl->stale = false;
+    return impl->current;
+}
+
+auto Fw::DiscoveryCache::find_all() noexcept -> std::expected<Fw::FreeWiliDevices, std::string> {
+    auto current = snapshot();
+    if (!current.has_value()) {
+        return std::unexpected(current.error());
+    }
+    return current.value()->devices;
+}
+
+auto Fw::DiscoveryCache::isStale() noexcept -> bool {
+    if (!impl) {
+        return true;
+    }
+    std::lock_guard lock(impl->mutex);
+    impl->stale |= impl->probe.changed();
+    return impl->stale || !impl->current;
+}
+
+auto Fw::DiscoveryCache::invalidate() noexcept -> void {
+    if (impl) {
+        std::lock_guard lock(impl->mutex);
+        impl->stale = true;
+    }
+}
+
+auto Fw::DiscoveryCache::generation() const noexcept -> uint64_t {
+    if (!impl) {
+        return 0;
+    }
+    std::lock_guard lock(impl->mutex);
+    return impl->current ? impl->current->generation : 0;
+}
@@ -0,0 +1,119 @@
+#ifdef __linux__
+
+    #include <fwfinder.hpp>
+    #include <fwfinder_linux.hpp>
+
+    #include <fcntl.h>
+    #include <libudev.h>
+    #include <poll.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    #include <algorithm>
+    #include <array>
+    #include <filesystem>
+    #include <string>
+    #include <vector>
+
+HostChangeProbe::HostChangeProbe(const Fw::FindOptions& options) noexcept: root(options.root) {
+    if (root.empty()) {
+        // POLLPRI is raised once per mount table change since the previous poll, or since
+        // the file was opened
+        mountInfoFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    }
+    if (root.empty() && options.backend == Fw::FindBackend::Default) {
+        udev = udev_new();
+        monitor = udev ? udev_monitor_new_from_netlink(udev, "udev") : nullptr;
+        if (monitor) {
+            udev_monitor_filter_add_match_subsystem_devtype(monitor, "usb", "usb_device");
+            udev_monitor_filter_add_match_subsystem_devtype(monitor, "tty", nullptr);
+            udev_monitor_filter_add_match_subsystem_devtype(monitor, "block", nullptr);
+            if (udev_monitor_enable_receiving(monitor) < 0) {
+                udev_monitor_unref(monitor);
+                monitor = nullptr;
+            }
+        }
+    }
+    if (!monitor) {
+        signature = _signature();
+    }
+}
+
+HostChangeProbe::~HostChangeProbe() {
+    if (mountInfoFd >= 0) {
+        ::close(mountInfoFd);
+    }
+    if (monitor) {
+        udev_monitor_unref(monitor);
+    }
+    if (udev) {
+        udev_unref(udev);
+    }
+}
+
+// Entry names only, nothing is resolved or read. A device unplugged and plugged back between
+// two calls keeps its names and goes unnoticed, only the udev monitor catches that.
+auto HostChangeProbe::_signature() const -> std::string {
+    std::string signature;
+    std::error_code ec;
+    for (auto directory: { "/sys/bus/usb/devices", "/sys/class/tty", "/sys/class/block" }) {
+        std::vector<std::string> names;
+        for (const auto& entry: std::filesystem::directory_iterator(root + directory, ec)) {
+            names.push_back(entry.path().filename().string());
+        }
+        std::sort(names.begin(), names.end());
+        for (const auto& name: names) {
+            signature += name;
+            signature += '\n';
+        }
+        signature += '\n';
+    }
+    // /proc files report neither a size nor a useful mtime, the live host polls mountinfo
+    if (!root.empty()) {
+        for (auto file: { "/proc/self/mountinfo", "/proc/mounts" }) {
+            struct stat st {};
+            if (::stat((root + file).c_str(), &st) == 0) {
+                signature += std::to_string(st.st_size) + " " + std::to_string(st.st_mtim.tv_sec)
+                    + "." + std::to_string(st.st_mtim.tv_nsec) + "\n";
+            }
+        }
+    }
+    return signature;
+}
+
+auto HostChangeProbe::changed() noexcept -> bool {
+    bool changed = false;
+    std::array<pollfd, 2> fds {};
+    nfds_t count = 0;
+    if (monitor) {
+        fds[count++] =
+            pollfd { .fd = udev_monitor_get_fd(monitor), .events = POLLIN, .revents = 0 };
+    }
+    if (mountInfoFd >= 0) {
+        fds[count++] = pollfd { .fd = mountInfoFd, .events = POLLPRI, .revents = 0 };
+    }
+    if (count > 0 && ::poll(fds.data(), count, 0) > 0) {
+        for (nfds_t i = 0; i < count; ++i) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            changed = true;
+            if (monitor && fds[i].fd == udev_monitor_get_fd(monitor)) {
+                // The monitor socket is non-blocking, this drains whatever is queued
+                while (struct udev_device* dev = udev_monitor_receive_device(monitor)) {
+                    udev_device_unref(dev);
+                }
+            }
+        }
+    }
+    if (!monitor) {
+        auto current = _signature();
+        if (current != signature) {
+            signature = std::move(current);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+#endif // __linux__
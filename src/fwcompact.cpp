@@ -0,0 +1,270 @@
+#include <fwcompact.hpp>
+#include <fwbuilder.hpp>
+#include <fwfinder.hpp>
+
+#include <array>
+#include <cstddef>
+#include <expected>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+auto Fw::PortChain::from(std::span<const uint32_t> ports) noexcept
+    -> std::expected<Fw::PortChain, std::string> {
+    if (ports.size() > capacity) {
+        return std::unexpected(
+            "USB port chain is " + std::to_string(ports.size()) + " deep, at most "
+            + std::to_string(capacity) + " is supported"
+        );
+    }
+    Fw::PortChain chain;
+    for (auto port: ports) {
+        if (port > std::numeric_limits<uint8_t>::max()) {
+            return std::unexpected("USB port " + std::to_string(port) + " is out of range");
+        }
+        chain.ports[chain.depth++] = static_cast<uint8_t>(port);
+    }
+    return chain;
+}
+
+auto Fw::PortChain::toVector() const -> std::vector<uint32_t> {
+    return std::vector<uint32_t>(ports.begin(), ports.begin() + depth);
+}
+
+// Interns strings while the tables are built. Keys point into the FreeWiliDevices being
+// packed, which outlive the builder. The table and its index live in scratch, sized up
+// front so neither rehashes nor grows.
+class StringTableBuilder {
+public:
+    StringTableBuilder(std::pmr::memory_resource* scratch, size_t strings, size_t bytes):
+        table(scratch),
+        interned(scratch) {
+        table.reserve(bytes);
+        interned.reserve(strings);
+    }
+
+    auto strings() const noexcept -> std::string_view {
+        return table;
+    }
+
+    auto intern(std::string_view value) -> std::expected<Fw::InternedString, std::string> {
+        if (value.empty()) {
+            return Fw::InternedString {};
+        }
+        if (auto it = interned.find(value); it != interned.end()) {
+            return it->second;
+        }
+        if (table.size() + value.size() > std::numeric_limits<uint32_t>::max()) {
+            return std::unexpected("CompactDevices string table is full");
+        }
+        auto result = Fw::InternedString {
+            .offset = static_cast<uint32_t>(table.size()),
+            .size = static_cast<uint32_t>(value.size()),
+        };
+        table.append(value);
+        interned.emplace(value, result);
+        return result;
+    }
+
+private:
+    std::pmr::string table;
+    std::pmr::unordered_map<std::string_view, Fw::InternedString> interned;
+};
+
+Fw::CompactDevices::CompactDevices(allocator_type allocator) noexcept:
+    strings(allocator),
+    allPaths(allocator),
+    allUSBDevices(allocator),
+    freeWiliDevices(allocator) {}
+
+auto Fw::CompactDevices::from(
+    const Fw::FreeWiliDevices& devices,
+    std::pmr::memory_resource* resource
+) -> std::expected<Fw::CompactDevices, std::string> {
+    Fw::CompactDevices compact { allocator_type(resource) };
+    size_t usbDeviceCount = 0;
+    size_t pathCount = 0;
+    // Upper bounds, before duplicates are interned away
+    size_t stringCount = 0;
+    size_t stringBytes = 0;
+    for (const auto& device: devices) {
+        usbDeviceCount += device.usbDevices.size();
+        stringCount += 2;
+        stringBytes += device.name.size() + device.serial.size();
+        for (const auto& usbDevice: device.usbDevices) {
+            stringCount += 4;
+            stringBytes += usbDevice.name.size() + usbDevice.serial.size()
+                + (usbDevice.port.has_value() ? usbDevice.port->size() : 0)
+                + usbDevice._raw.size();
+            if (usbDevice.paths.has_value()) {
+                pathCount += usbDevice.paths->size();
+                stringCount += usbDevice.paths->size();
+                for (const auto& path: usbDevice.paths.value()) {
+                    stringBytes += path.size();
+                }
+            }
+        }
+    }
+    if (usbDeviceCount > std::numeric_limits<uint32_t>::max()
+        || pathCount > std::numeric_limits<uint32_t>::max())
+    {
+        return std::unexpected("Too many USB devices for CompactDevices");
+    }
+    compact.freeWiliDevices.reserve(devices.size());
+    compact.allUSBDevices.reserve(usbDeviceCount);
+    compact.allPaths.reserve(pathCount);
+
+    // The interning scratch goes away with from(), a dozen boards fit the stack buffer
+    std::array<std::byte, 16 * 1024> scratchBuffer;
+    std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+    StringTableBuilder table(&scratch, stringCount, stringBytes);
+    // intern() only fails once the table is full, that is checked once per device
+    std::string error;
+    auto intern = [&](std::string_view value) -> Fw::InternedString {
+        auto result = table.intern(value);
+        if (!result.has_value()) {
+            error = result.error();
+            return {};
+        }
+        return result.value();
+    };
+    for (const auto& device: devices) {
+        compact.freeWiliDevices.push_back(Fw::CompactFreeWiliDevice {
+            .uniqueID = device.uniqueID,
+            .name = intern(device.name),
+            .serial = intern(device.serial),
+            .usbDevicesBegin = static_cast<uint32_t>(compact.allUSBDevices.size()),
+            .usbDevicesCount = static_cast<uint32_t>(device.usbDevices.size()),
+            .deviceType = device.deviceType,
+            .standalone = device.standalone,
+        });
+        for (const auto& usbDevice: device.usbDevices) {
+            auto portChain = Fw::PortChain::from(usbDevice.portChain);
+            if (!portChain.has_value()) {
+                return std::unexpected(portChain.error());
+            }
+            auto pathsBegin = static_cast<uint32_t>(compact.allPaths.size());
+            if (usbDevice.paths.has_value()) {
+                for (const auto& path: usbDevice.paths.value()) {
+                    compact.allPaths.push_back(intern(path));
+                }
+            }
+            compact.allUSBDevices.push_back(Fw::CompactUSBDevice {
+                .name = intern(usbDevice.name),
+                .serial = intern(usbDevice.serial),
+                .port = usbDevice.port.has_value() ? intern(usbDevice.port.value())
+                                                : Fw::InternedString {},
+                ._raw = intern(usbDevice._raw),
+                .location = usbDevice.location,
+                .pathsBegin = pathsBegin,
+                .pathsCount = static_cast<uint32_t>(compact.allPaths.size()) - pathsBegin,
+                .vid = usbDevice.vid,
+                .pid = usbDevice.pid,
+                .kind = usbDevice.kind,
+                .portChain = portChain.value(),
+                .hasPort = usbDevice.port.has_value(),
+                .hasPaths = usbDevice.paths.has_value(),
+            });
+        }
+        if (!error.empty()) {
+            return std::unexpected(error);
+        }
+    }
+    // Copied once its final size is known, an arena can't reclaim the blocks outgrown on the way
+    compact.strings.assign(table.strings());
+    return compact;
+}
+
+auto Fw::CompactDevices::usbDevices(const Fw::CompactFreeWiliDevice& device) const noexcept
+    -> std::span<const Fw::CompactUSBDevice> {
+    return usbDevices().subspan(device.usbDevicesBegin, device.usbDevicesCount);
+}
+
+auto Fw::CompactDevices::paths(const Fw::CompactUSBDevice& usbDevice) const noexcept
+    -> std::span<const Fw::InternedString> {
+    return std::span<const Fw::InternedString>(allPaths)
+        .subspan(usbDevice.pathsBegin, usbDevice.pathsCount);
+}
+
+auto Fw::CompactDevices::toUSBDevice(const Fw::CompactUSBDevice& usbDevice) const
+    -> Fw::USBDevice {
+    std::optional<std::vector<std::string>> paths;
+    if (usbDevice.hasPaths) {
+        paths.emplace();
+        paths->reserve(usbDevice.pathsCount);
+        for (const auto& path: this->paths(usbDevice)) {
+            paths->emplace_back(string(path));
+        }
+    }
+    return Fw::USBDevice {
+        .kind = usbDevice.kind,
+        .vid = usbDevice.vid,
+        .pid = usbDevice.pid,
+        .name = std::string(string(usbDevice.name)),
+        .serial = std::string(string(usbDevice.serial)),
+        .location = usbDevice.location,
+        .portChain = usbDevice.portChain.toVector(),
+        .paths = std::move(paths),
+        .port = usbDevice.hasPort ? std::optional<std::string>(string(usbDevice.port))
+                                  : std::nullopt,
+        ._raw = std::string(string(usbDevice._raw)),
+    };
+}
+
+auto Fw::CompactDevices::toFreeWiliDevice(const Fw::CompactFreeWiliDevice& device) const
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    Fw::USBDevices usbDevices;
+    usbDevices.reserve(device.usbDevicesCount);
+    for (const auto& usbDevice: this->usbDevices(device)) {
+        usbDevices.push_back(toUSBDevice(usbDevice));
+    }
+    return Fw::FreeWiliDevice::builder()
+        .setDeviceType(device.deviceType)
+        .setName(std::string(string(device.name)))
+        .setSerial(std::string(string(device.serial)))
+        .setUniqueID(device.uniqueID)
+        .setStandalone(device.standalone)
+        .setUSBDevices(std::move(usbDevices))
+        .build();
+}
+
+auto Fw::CompactDevices::toFreeWiliDevices() const
+    -> std::expected<Fw::FreeWiliDevices, std::string> {
+    Fw::FreeWiliDevices devices;
+    devices.reserve(freeWiliDevices.size());
+    for (const auto& device: freeWiliDevices) {
+        auto result = toFreeWiliDevice(device);
+        if (!result.has_value()) {
+            return std::unexpected(result.error());
+        }
+        devices.push_back(std::move(result.value()));
+    }
+    return devices;
+}
+
+auto Fw::CompactDevices::memoryUsage() const noexcept -> size_t {
+    // Only a string that outgrew the small string buffer owns a heap block
+    auto stringBytes =
+        strings.capacity() > std::pmr::string().capacity() ? strings.capacity() + 1 : 0;
+    return stringBytes + allPaths.capacity() * sizeof(Fw::InternedString)
+        + allUSBDevices.capacity() * sizeof(Fw::CompactUSBDevice)
+        + freeWiliDevices.capacity() * sizeof(Fw::CompactFreeWiliDevice);
+}
+
+auto Fw::find_all(std::pmr::memory_resource* resource, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::CompactDevices, std::string> {
+    auto devices = Fw::find_all(options);
+    if (!devices.has_value()) {
+        return std::unexpected(devices.error());
+    }
+    try {
+        return Fw::CompactDevices::from(devices.value(), resource);
+    } catch (const std::bad_alloc&) {
+        return std::unexpected("Not enough memory for the CompactDevices");
+    }
+}
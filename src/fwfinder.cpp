@@ -7,7 +7,10 @@
 #include <algorithm>
 #include <sstream>
 #include <cassert>
+#include <chrono>
 #include <limits>
+#include <span>
+#include <string_view>
 
 auto _generateUniqueIDFromUSBPortChain(const std::vector<uint32_t>& usbPortChain) -> uint64_t {
     // Limitation: We can do 10 hubs deep and 64 ports per hub with 6 bits allocated per port.
@@ -31,35 +34,13 @@ auto _generateUniqueIDFromUSBPortChain(const std::vector<uint32_t>& usbPortChain
 
 bool Fw::isStandAloneDevice(uint16_t vid, uint16_t pid) {
     // Check if the VID and PID match any known standalone devices
-    return (vid == Fw::USB_VID_FW_RPI && pid == Fw::USB_PID_FW_RPI_2350_UF2_PID)
-        || (vid == Fw::USB_VID_FW_ICS
-            && (pid == Fw::USB_PID_FW_WINKY || pid == Fw::USB_PID_FW_DEFCON_2024
-                || pid == Fw::USB_PID_FW_DEFCON_BADGE_2025));
+    const auto* descriptor = Fw::find_usb_descriptor(vid, pid);
+    return descriptor && descriptor->standalone;
 }
 
 auto Fw::getUSBDeviceTypeFrom(uint16_t vid, uint16_t pid, uint32_t location) -> Fw::USBDeviceType {
-    static std::map<std::tuple<uint16_t, uint16_t>, Fw::USBDeviceType> usbDeviceTypeMap = {
-        { { USB_VID_FW_HUB, USB_PID_FW_HUB }, Fw::USBDeviceType::Hub },
-        { { USB_VID_FW_FTDI, USB_PID_FW_FTDI }, Fw::USBDeviceType::FTDI },
-        { { USB_VID_FW_RPI, USB_PID_FW_RPI_CDC_PID }, Fw::USBDeviceType::Serial },
-        { { USB_VID_FW_RPI, USB_PID_FW_RPI_2040_UF2_PID }, Fw::USBDeviceType::MassStorage },
-        { { USB_VID_FW_RPI, USB_PID_FW_RPI_2350_UF2_PID }, Fw::USBDeviceType::MassStorage },
-        { { USB_VID_FW_ICS, USB_PID_FW_MAIN_CDC_PID }, Fw::USBDeviceType::SerialMain },
-        { { USB_VID_FW_ICS, USB_PID_FW_DISPLAY_CDC_PID }, Fw::USBDeviceType::SerialDisplay },
-        { { USB_VID_FW_ICS, USB_PID_FW_WINKY }, Fw::USBDeviceType::SerialMain },
-        { { USB_VID_FW_ICS, USB_PID_FW_DEFCON_2024 }, Fw::USBDeviceType::SerialMain },
-        { { USB_VID_FW_ICS, USB_PID_FW_DEFCON_BADGE_2025 }, Fw::USBDeviceType::SerialMain },
-        // FREE-WILi2 devices
-        { { USB_VID_FW2_HUB, USB_PID_FW2_HUB }, Fw::USBDeviceType::Hub },
-        { { USB_VID_FW2_MAIN, USB_PID_FW2_MAIN }, Fw::USBDeviceType::SerialMain },
-        { { USB_VID_FW2_DISPLAY, USB_PID_FW2_DISPLAY }, Fw::USBDeviceType::SerialDisplay },
-        { { USB_VID_FW2_DEBUG_PROBE, USB_PID_FW2_DEBUG_PROBE }, Fw::USBDeviceType::DebugProbe },
-        { { USB_VID_FW2_ESP32, USB_PID_FW2_ESP32_JTAG }, Fw::USBDeviceType::ESP32 },
-        { { USB_VID_FW2_MASS_STORAGE, USB_PID_FW2_MASS_STORAGE }, Fw::USBDeviceType::MassStorage },
-    };
-
-    if (auto it = usbDeviceTypeMap.find({ vid, pid }); it != usbDeviceTypeMap.end()) {
-        if (it->second == Fw::USBDeviceType::Serial) {
+    if (const auto* descriptor = Fw::find_usb_descriptor(vid, pid); descriptor) {
+        if (descriptor->kind == Fw::USBDeviceType::Serial) {
             // Further refine Serial type based on location for older firmware
             if (location == static_cast<uint32_t>(Fw::USBHubPortLocation::Main)) {
                 return Fw::USBDeviceType::SerialMain;
@@ -67,7 +48,7 @@ auto Fw::getUSBDeviceTypeFrom(uint16_t vid, uint16_t pid, uint32_t location) ->
                 return Fw::USBDeviceType::SerialDisplay;
             }
         }
-        return it->second;
+        return descriptor->kind;
     }
     return Fw::USBDeviceType::Other;
 }
@@ -128,6 +109,20 @@ Fw::FreeWiliDevice::FreeWiliDevice(FreeWiliDevice&& other) noexcept:
     other.uniqueID = std::numeric_limits<uint64_t>::max();
 }
 
+Fw::FreeWiliDevice& Fw::FreeWiliDevice::operator=(FreeWiliDevice&& other) noexcept {
+    if (this != &other) {
+        deviceType = other.deviceType;
+        name = std::move(other.name);
+        serial = std::move(other.serial);
+        uniqueID = other.uniqueID;
+        standalone = other.standalone;
+        usbDevices = std::move(other.usbDevices);
+        other.deviceType = Fw::DeviceType::Unknown;
+        other.uniqueID = std::numeric_limits<uint64_t>::max();
+    }
+    return *this;
+}
+
 auto Fw::FreeWiliDevice::getUSBDevices(std::vector<Fw::USBDeviceType> usbDeviceTypes) const noexcept
     -> Fw::USBDevices {
     // Helper function to see if a vector contains the DeviceType
@@ -160,6 +155,12 @@ auto Fw::FreeWiliDevice::getUSBDevices() const noexcept -> Fw::USBDevices {
 }
 
 auto Fw::FreeWiliDevice::fromUSBDevices(const Fw::USBDevices& usbDevices)
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    // Copy the USBDevices so we can sort them
+    return fromUSBDevices(Fw::USBDevices(usbDevices));
+}
+
+auto Fw::FreeWiliDevice::fromUSBDevices(Fw::USBDevices&& usbDevices)
     -> std::expected<Fw::FreeWiliDevice, std::string> {
     std::string name;
     std::string serial;
@@ -191,8 +192,8 @@ auto Fw::FreeWiliDevice::fromUSBDevices(const Fw::USBDevices& usbDevices)
         }
     }
 
-    // Copy the USBDevices so we can sort it
-    Fw::USBDevices sortedUsbDevices = usbDevices;
+    // Sorted in place once name, serial and uniqueID have been read
+    Fw::USBDevices& sortedUsbDevices = usbDevices;
 
     // Original hub-based device logic for FreeWili devices
     // Find the name and serial from the hub or FTDI chip
@@ -288,8 +289,8 @@ auto Fw::FreeWiliDevice::fromUSBDevices(const Fw::USBDevices& usbDevices)
 
     return Fw::FreeWiliDevice::builder()
         .setDeviceType(deviceType)
-        .setName(name)
-        .setSerial(serial)
+        .setName(std::move(name))
+        .setSerial(std::move(serial))
         .setUniqueID(uniqueID)
         .setStandalone(isStandaloneDevice)
         .setUSBDevices(std::move(sortedUsbDevices))
@@ -300,11 +301,49 @@ Fw::FreeWiliDeviceBuilder Fw::FreeWiliDevice::builder() {
     return Fw::FreeWiliDeviceBuilder();
 }
 
-auto Fw::FreeWiliDevice::getMainUSBDevice() const noexcept
-    -> std::expected<USBDevice, std::string> {
+auto Fw::getUSBDeviceErrorMessage(Fw::USBDeviceError error) noexcept -> std::string_view {
+    switch (error) {
+        case Fw::USBDeviceError::Standalone:
+            return "Standalone device";
+        case Fw::USBDeviceError::NotFound:
+            return "USB device not found";
+    }
+    return "Unknown USB device error";
+}
+
+// Keeps the messages of the by-value getters, they predate USBDeviceError
+static auto _copyUSBDevice(
+    const std::expected<const Fw::USBDevice*, Fw::USBDeviceError>& found,
+    Fw::DeviceType deviceType,
+    const char* standaloneName,
+    const char* notFoundName
+) -> std::expected<Fw::USBDevice, std::string> {
+    if (found.has_value()) {
+        return *found.value();
+    }
+    if (found.error() == Fw::USBDeviceError::Standalone) {
+        std::stringstream ss;
+        ss << Fw::getDeviceTypeName(deviceType) << " is a standalone device and has no "
+           << standaloneName << " USB device.";
+        return std::unexpected(ss.str());
+    }
+    return std::unexpected(std::string(notFoundName) + " USB device not found");
+}
+
+auto Fw::FreeWiliDevice::viewUSBDevices() const noexcept -> std::span<const USBDevice> {
+    return usbDevices;
+}
+
+auto Fw::FreeWiliDevice::viewUSBDevices(Fw::USBDeviceType usbDeviceType) const noexcept
+    -> Fw::USBDeviceKindView {
+    return Fw::USBDeviceKindView(viewUSBDevices(), Fw::USBDeviceKindIs { usbDeviceType });
+}
+
+auto Fw::FreeWiliDevice::findMainUSBDevice() const noexcept
+    -> std::expected<const USBDevice*, USBDeviceError> {
     if (standalone) {
         if (usbDevices.size() && isStandAloneDevice(usbDevices[0].vid, usbDevices[0].pid)) {
-            return usbDevices[0];
+            return &usbDevices[0];
         }
     } else {
         // First try to find by SerialMain kind (works for both FW1 new-firmware and FW2)
@@ -317,7 +356,7 @@ auto Fw::FreeWiliDevice::getMainUSBDevice() const noexcept
             );
             it != usbDevices.end())
         {
-            return *it;
+            return &*it;
         }
         // Fall back to port location for FW1 old-firmware (RPI CDC on port 1)
         if (auto it = std::find_if(
@@ -331,19 +370,16 @@ auto Fw::FreeWiliDevice::getMainUSBDevice() const noexcept
             );
             it != usbDevices.end())
         {
-            return *it;
+            return &*it;
         }
     }
-    return std::unexpected("Main USB device not found");
+    return std::unexpected(Fw::USBDeviceError::NotFound);
 }
 
-auto Fw::FreeWiliDevice::getDisplayUSBDevice() const noexcept
-    -> std::expected<USBDevice, std::string> {
+auto Fw::FreeWiliDevice::findDisplayUSBDevice() const noexcept
+    -> std::expected<const USBDevice*, USBDeviceError> {
     if (standalone) {
-        std::stringstream ss;
-        ss << getDeviceTypeName(deviceType)
-           << " is a standalone device and has no Display USB device.";
-        return std::unexpected(ss.str());
+        return std::unexpected(Fw::USBDeviceError::Standalone);
     }
     // First try to find by SerialDisplay kind (works for both FW1 new-firmware and FW2)
     if (auto it = std::find_if(
@@ -355,7 +391,7 @@ auto Fw::FreeWiliDevice::getDisplayUSBDevice() const noexcept
         );
         it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
     // Fall back to port location for FW1 old-firmware (RPI CDC on port 2)
     if (auto it = std::find_if(
@@ -369,18 +405,15 @@ auto Fw::FreeWiliDevice::getDisplayUSBDevice() const noexcept
         );
         it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
-    return std::unexpected("Display USB device not found");
+    return std::unexpected(Fw::USBDeviceError::NotFound);
 }
 
-auto Fw::FreeWiliDevice::getFPGAUSBDevice() const noexcept
-    -> std::expected<USBDevice, std::string> {
+auto Fw::FreeWiliDevice::findFPGAUSBDevice() const noexcept
+    -> std::expected<const USBDevice*, USBDeviceError> {
     if (standalone) {
-        std::stringstream ss;
-        ss << getDeviceTypeName(deviceType)
-           << " is a standalone device and has no FPGA USB device.";
-        return std::unexpected(ss.str());
+        return std::unexpected(Fw::USBDeviceError::Standalone);
     }
     // The FPGA is driven by the FTDI chip on both the FREE-WILi and the FREE-WILi2
     if (auto it = std::find_if(
@@ -390,7 +423,7 @@ auto Fw::FreeWiliDevice::getFPGAUSBDevice() const noexcept
         );
         it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
     // Fall back to the hub port the FTDI chip normally sits on
     if (auto it = std::find_if(
@@ -404,18 +437,15 @@ auto Fw::FreeWiliDevice::getFPGAUSBDevice() const noexcept
         );
         it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
-    return std::unexpected("FPGA USB device not found");
+    return std::unexpected(Fw::USBDeviceError::NotFound);
 }
 
-auto Fw::FreeWiliDevice::getDebugProbeUSBDevice() const noexcept
-    -> std::expected<USBDevice, std::string> {
+auto Fw::FreeWiliDevice::findDebugProbeUSBDevice() const noexcept
+    -> std::expected<const USBDevice*, USBDeviceError> {
     if (standalone) {
-        std::stringstream ss;
-        ss << getDeviceTypeName(deviceType)
-           << " is a standalone device and has no Debug Probe USB device.";
-        return std::unexpected(ss.str());
+        return std::unexpected(Fw::USBDeviceError::Standalone);
     }
     if (auto it = std::find_if(
             usbDevices.begin(),
@@ -424,18 +454,15 @@ auto Fw::FreeWiliDevice::getDebugProbeUSBDevice() const noexcept
         );
         it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
-    return std::unexpected("Debug Probe USB device not found");
+    return std::unexpected(Fw::USBDeviceError::NotFound);
 }
 
-auto Fw::FreeWiliDevice::getESP32USBDevice() const noexcept
-    -> std::expected<USBDevice, std::string> {
+auto Fw::FreeWiliDevice::findESP32USBDevice() const noexcept
+    -> std::expected<const USBDevice*, USBDeviceError> {
     if (standalone) {
-        std::stringstream ss;
-        ss << getDeviceTypeName(deviceType)
-           << " is a standalone device and has no ESP32 USB device.";
-        return std::unexpected(ss.str());
+        return std::unexpected(Fw::USBDeviceError::Standalone);
     }
     if (auto it = std::find_if(
             usbDevices.begin(),
@@ -444,24 +471,143 @@ auto Fw::FreeWiliDevice::getESP32USBDevice() const noexcept
         );
         it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
-    return std::unexpected("ESP32 USB device not found");
+    return std::unexpected(Fw::USBDeviceError::NotFound);
 }
 
-auto Fw::FreeWiliDevice::getHubUSBDevice() const noexcept -> std::expected<USBDevice, std::string> {
+auto Fw::FreeWiliDevice::findHubUSBDevice() const noexcept
+    -> std::expected<const USBDevice*, USBDeviceError> {
     if (standalone) {
-        std::stringstream ss;
-        ss << getDeviceTypeName(deviceType) << " is a standalone device and has no HUB USB device.";
-        return std::unexpected(ss.str());
-    } else if (auto it = std::find_if(
-                   usbDevices.begin(),
-                   usbDevices.end(),
-                   [&](const USBDevice& usb_dev) { return usb_dev.kind == Fw::USBDeviceType::Hub; }
-               );
-               it != usbDevices.end())
+        return std::unexpected(Fw::USBDeviceError::Standalone);
+    }
+    if (auto it = std::find_if(
+            usbDevices.begin(),
+            usbDevices.end(),
+            [&](const USBDevice& usb_dev) { return usb_dev.kind == Fw::USBDeviceType::Hub; }
+        );
+        it != usbDevices.end())
     {
-        return *it;
+        return &*it;
     }
-    return std::unexpected("Hub USB device not found");
+    return std::unexpected(Fw::USBDeviceError::NotFound);
 }
+
+auto Fw::FreeWiliDevice::getMainUSBDevice() const noexcept
+    -> std::expected<USBDevice, std::string> {
+    return _copyUSBDevice(findMainUSBDevice(), deviceType, "Main", "Main");
+}
+
+auto Fw::FreeWiliDevice::getDisplayUSBDevice() const noexcept
+    -> std::expected<USBDevice, std::string> {
+    return _copyUSBDevice(findDisplayUSBDevice(), deviceType, "Display", "Display");
+}
+
+auto Fw::FreeWiliDevice::getFPGAUSBDevice() const noexcept
+    -> std::expected<USBDevice, std::string> {
+    return _copyUSBDevice(findFPGAUSBDevice(), deviceType, "FPGA", "FPGA");
+}
+
+auto Fw::FreeWiliDevice::getDebugProbeUSBDevice() const noexcept
+    -> std::expected<USBDevice, std::string> {
+    return _copyUSBDevice(findDebugProbeUSBDevice(), deviceType, "Debug Probe", "Debug Probe");
+}
+
+auto Fw::FreeWiliDevice::getESP32USBDevice() const noexcept
+    -> std::expected<USBDevice, std::string> {
+    return _copyUSBDevice(findESP32USBDevice(), deviceType, "ESP32", "ESP32");
+}
+
+auto Fw::FreeWiliDevice::getHubUSBDevice() const noexcept -> std::expected<USBDevice, std::string> {
+    return _copyUSBDevice(findHubUSBDevice(), deviceType, "HUB", "Hub");
+}
+
+auto Fw::FreeWiliDevice::getMassStoragePaths() const noexcept -> std::vector<std::string> {
+    std::vector<std::string> paths;
+    for (const auto& usbDevice: usbDevices) {
+        if (usbDevice.kind == Fw::USBDeviceType::MassStorage && usbDevice.paths.has_value()) {
+            paths.insert(paths.end(), usbDevice.paths->begin(), usbDevice.paths->end());
+        }
+    }
+    return paths;
+}
+
+#if !defined(__linux__)
+
+// The platform scan of find_all() has no options, they are checked around it
+auto Fw::find_all(const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevices, std::string> {
+    if (options.backend != Fw::FindBackend::Default || !options.root.empty()) {
+        return std::unexpected("Backend not supported on this platform");
+    }
+    // The scan itself can't be interrupted here, its result is dropped instead
+    if (options.stop.stop_requested()) {
+        return std::unexpected("Discovery was cancelled");
+    }
+    if (options.stats) {
+        // Only the total and the result are tracked here, the phases stay at zero
+        *options.stats = Fw::FindStats {};
+    }
+    const auto start = std::chrono::steady_clock::now();
+    auto devices = Fw::find_all();
+    if (options.stop.stop_requested()) {
+        return std::unexpected("Discovery was cancelled");
+    }
+    if (options.stats) {
+        options.stats->totalTime = std::chrono::steady_clock::now() - start;
+        options.stats->devicesFound = devices.has_value() ? devices->size() : 0;
+    }
+    return devices;
+}
+
+// Only the Linux backends can narrow a scan down, elsewhere lookups filter find_all()
+static auto _lookup(
+    const Fw::FindOptions& options,
+    const Fw::DevicePredicate& predicate,
+    const std::string& notFound
+) noexcept -> std::expected<Fw::FreeWiliDevice, std::string> {
+    auto devices = Fw::find_all(options);
+    if (!devices.has_value()) {
+        return std::unexpected(devices.error());
+    }
+    auto it = std::find_if(devices->begin(), devices->end(), predicate);
+    if (it == devices->end()) {
+        return std::unexpected(notFound);
+    }
+    return std::move(*it);
+}
+
+auto Fw::find_first(const Fw::DevicePredicate& predicate, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return _lookup(options, predicate, "No FreeWili device matched");
+}
+
+auto Fw::find_by_serial(const std::string& serial, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return _lookup(
+        options,
+        [&serial](const Fw::FreeWiliDevice& device) { return device.serial == serial; },
+        "No FreeWili device with serial " + serial
+    );
+}
+
+auto Fw::find_by_unique_id(uint64_t uniqueID, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return _lookup(
+        options,
+        [uniqueID](const Fw::FreeWiliDevice& device) { return device.uniqueID == uniqueID; },
+        "No FreeWili device with unique ID " + std::to_string(uniqueID)
+    );
+}
+
+auto Fw::refresh(Fw::FreeWiliDevice& device, const Fw::FindOptions& options) noexcept
+    -> std::expected<void, std::string> {
+    auto refreshed = Fw::find_by_unique_id(device.uniqueID, options);
+    if (!refreshed.has_value()) {
+        return std::unexpected(refreshed.error());
+    }
+    device = std::move(refreshed.value());
+    return {};
+}
+
+#endif // !__linux__
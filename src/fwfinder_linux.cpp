@@ -1,47 +1,53 @@
 #ifdef __linux__
 
     #include <fwfinder.hpp>
+    #include <fwfinder_linux.hpp>
     #include <usbdef.hpp>
 
+    #include <dirent.h>
+    #include <fcntl.h>
     #include <libudev.h>
     #include <mntent.h>
+    #include <sys/sysmacros.h>
+    #include <unistd.h>
 
     #include <expected>
     #include <string>
     #include <cstdio>
-    #include <functional>
     #include <iostream>
     #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <cctype>
+    #include <cerrno>
+    #include <climits>
+    #include <cstdlib>
     #include <charconv>
+    #include <filesystem>
+    #include <fstream>
+    #include <functional>
+    #include <optional>
+    #include <stop_token>
+    #include <string_view>
+    #include <system_error>
+    #include <thread>
+    #include <unordered_map>
+    #include <unordered_set>
+    #include <variant>
+
+// Returned once FindOptions::stop was requested
+static constexpr const char* _cancelled = "Discovery was cancelled";
 
 // Helper function to get udev device attribute
-std::string get_device_property(struct udev_device* dev, const char* property) {
+std::string
+get_device_property(struct udev_device* dev, const char* property, Fw::FindStats* stats = nullptr) {
+    if (stats) {
+        ++stats->attributeReads;
+    }
     const char* value = udev_device_get_sysattr_value(dev, property);
     return value ? value : "";
 }
 
-auto _findMountPoints(const std::string& devnode) noexcept -> std::vector<std::string> {
-    std::vector<std::string> mountPoints;
-    FILE* mtab = setmntent("/proc/mounts", "r");
-    if (!mtab) {
-        perror("setmntent");
-        return mountPoints;
-    }
-
-    struct mntent* ent;
-
-    while ((ent = getmntent(mtab)) != nullptr) {
-        if (std::string(ent->mnt_fsname).contains(devnode)) {
-            mountPoints.push_back(ent->mnt_dir);
-            //std::cout << "Device " << devnode << " is mounted at " << ent->mnt_dir << std::endl;
-        }
-    }
-
-    endmntent(mtab);
-
-    return mountPoints;
-}
-
 // Template function to convert string to integer types
 template<typename T>
 auto string_to_int(const std::string& str, int base = 10) -> std::optional<T>
@@ -54,77 +60,95 @@ auto string_to_int(const std::string& str, int base = 10) -> std::optional<T>
     return std::nullopt;
 }
 
-struct DiskInfo {
-    /// /sys/devices/pci0000:00/0000:00:01.2/0000:02:00.0/usb1/1-2/1-2.1
-    std::string devPath;
-    /// /dev/sdX
-    std::string diskName;
-    /// USB serial descriptor
-    std::string serial;
-    /// actual file-system mount paths
-    std::vector<std::string> mountPoints;
-};
-
-auto _listDisks() noexcept -> std::vector<DiskInfo> {
-    std::vector<DiskInfo> foundDisks;
-    struct udev* udev = udev_new();
-    if (!udev) {
-        return foundDisks;
+// Undo the octal escaping (\040 for a space) the kernel applies to mount paths
+static auto _unescapeMountPath(std::string_view path) -> std::string {
+    std::string unescaped;
+    unescaped.reserve(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (path[i] == '\\' && i + 3 < path.size()) {
+            int value = 0;
+            auto [ptr, ec] = std::from_chars(path.data() + i + 1, path.data() + i + 4, value, 8);
+            if (ec == std::errc {} && ptr == path.data() + i + 4) {
+                unescaped.push_back(static_cast<char>(value));
+                i += 3;
+                continue;
+            }
+        }
+        unescaped.push_back(path[i]);
     }
+    return unescaped;
+}
 
-    struct udev_enumerate* enumerate = udev_enumerate_new(udev);
-    udev_enumerate_add_match_subsystem(enumerate, "block"); // Only block devices
-    udev_enumerate_add_match_property(
-        enumerate,
-        "DEVTYPE",
-        "disk"
-    ); // only whole disks, not partitions
-    udev_enumerate_scan_devices(enumerate);
-
-    struct udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate);
-    struct udev_list_entry* entry;
-
-    udev_list_entry_foreach(entry, devices) {
-        const char* syspath = udev_list_entry_get_name(entry);
-        struct udev_device* usbDisk = udev_device_new_from_syspath(udev, syspath);
-
-        const char* devnode = udev_device_get_devnode(usbDisk); // Should give /dev/sdX
-        if (!devnode) {
-            udev_device_unref(usbDisk);
+auto _parseMountInfo(std::istream& mountInfo) -> MountTable {
+    MountTable mounts;
+    // 36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+    std::string line;
+    while (std::getline(mountInfo, line)) {
+        std::string_view fields = line;
+        std::array<std::string_view, 5> columns;
+        size_t column = 0;
+        while (column < columns.size() && !fields.empty()) {
+            auto end = fields.find(' ');
+            columns[column++] = fields.substr(0, end);
+            fields = end == std::string_view::npos ? std::string_view {} : fields.substr(end + 1);
+        }
+        if (column != columns.size()) {
             continue;
         }
-        // Go up to the USB device
-        struct udev_device* parent =
-            udev_device_get_parent_with_subsystem_devtype(usbDisk, "usb", "usb_device");
-        if (parent) {
-            auto mountPoints = _findMountPoints(devnode);
-            std::string serial = get_device_property(parent, "serial");
-            std::string devPath = udev_device_get_syspath(parent);
-
-            foundDisks.push_back(DiskInfo {
-                .devPath = devPath,
-                .diskName = devnode,
-                .serial = serial,
-                .mountPoints = mountPoints,
-            });
+        auto devNum = columns[2];
+        auto colon = devNum.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
         }
-        udev_device_unref(usbDisk);
+        unsigned int major = 0;
+        unsigned int minor = 0;
+        if (std::from_chars(devNum.data(), devNum.data() + colon, major).ec != std::errc {}
+            || std::from_chars(devNum.data() + colon + 1, devNum.data() + devNum.size(), minor).ec
+                != std::errc {})
+        {
+            continue;
+        }
+        mounts.mountPointsByDevNum[makedev(major, minor)].push_back(
+            _unescapeMountPath(columns[4])
+        );
     }
+    return mounts;
+}
 
-    udev_enumerate_unref(enumerate);
-    udev_unref(udev);
-
-    return foundDisks;
+auto _readMountTable(const std::string& mountInfoPath, const std::string& mountsPath)
+    -> MountTable {
+    if (std::ifstream mountInfo(mountInfoPath); mountInfo.is_open()) {
+        return _parseMountInfo(mountInfo);
+    }
+    // Older kernels and some sandboxes don't expose mountinfo, fall back to the mount sources
+    MountTable mounts;
+    FILE* mtab = setmntent(mountsPath.c_str(), "r");
+    if (!mtab) {
+        return mounts;
+    }
+    struct mntent* ent;
+    while ((ent = getmntent(mtab)) != nullptr) {
+        mounts.mountPointsBySource[ent->mnt_fsname].push_back(ent->mnt_dir);
+    }
+    endmntent(mtab);
+    return mounts;
 }
 
-struct SerialInfo {
-    /// /sys/devices/pci0000:00/0000:00:01.2/0000:02:00.0/usb1/1-2/1-2.1
-    std::string devPath;
-    /// /dev/ttyACM0 /dev/ttyUSB0
-    std::string ttyName;
-    /// USB serial descriptor
-    std::string serial;
-};
+auto _findMountPoints(const MountTable& mounts, const DiskInfo& disk) -> std::vector<std::string> {
+    std::vector<std::string> mountPoints;
+    for (const auto& blockDevice: disk.blockDevices) {
+        if (auto it = mounts.mountPointsByDevNum.find(blockDevice.devNum);
+            it != mounts.mountPointsByDevNum.end())
+        {
+            mountPoints.insert(mountPoints.end(), it->second.begin(), it->second.end());
+        } else if (auto it = mounts.mountPointsBySource.find(blockDevice.devNode);
+                   it != mounts.mountPointsBySource.end())
+        {
+            mountPoints.insert(mountPoints.end(), it->second.begin(), it->second.end());
+        }
+    }
+    return mountPoints;
+}
 
 auto usbPortChainFromUdevDevice(udev_device* dev) -> std::vector<uint32_t> {
     if (!dev) {
@@ -168,393 +192,1158 @@ auto usbPortChainFromUdevDevice(udev_device* dev) -> std::vector<uint32_t> {
     return portChain;
 }
 
-auto _listSerialPorts() noexcept -> std::vector<SerialInfo> {
-    std::vector<SerialInfo> foundSerials;
-    struct udev* udev = udev_new();
-    if (!udev) {
-        return foundSerials;
+// Only the VID/PID are read, enough for _isDiscoveryCandidate()
+static auto _usbNodeIdentityFromUdev(udev_device* dev, Fw::FindStats* stats)
+    -> std::optional<UsbNode> {
+    // Interfaces share the usb subsystem, we only care about the devices themselves
+    const char* devType = udev_device_get_devtype(dev);
+    if (!devType || std::string_view(devType) != "usb_device") {
+        return std::nullopt;
+    }
+    uint16_t vid =
+        string_to_int<uint16_t>(get_device_property(dev, "idVendor", stats), 16).value_or(0);
+    uint16_t pid =
+        string_to_int<uint16_t>(get_device_property(dev, "idProduct", stats), 16).value_or(0);
+    if (vid == 0 || pid == 0) {
+        return std::nullopt;
+    }
+    const char* _sysnum = udev_device_get_sysnum(dev);
+    std::string sysnum = _sysnum ? _sysnum : "";
+    struct udev_device* parent =
+        udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
+
+    return UsbNode {
+        .syspath = udev_device_get_syspath(dev),
+        .parentSyspath = parent ? udev_device_get_syspath(parent) : "",
+        .vid = vid,
+        .pid = pid,
+        .manufacturer = {},
+        .product = {},
+        .serial = {},
+        .location = string_to_int<uint32_t>(sysnum, 10).value_or(0),
+        .portChain = {},
+    };
+}
+
+// What is read of a usb_device past its identity, targeted lookups read it in two goes
+struct _UsbNodeFields {
+    bool names = true;
+    bool serial = true;
+    bool portChain = true;
+};
+
+static auto _readUsbNodeAttributes(
+    udev_device* dev,
+    UsbNode& node,
+    const _UsbNodeFields& fields,
+    Fw::FindStats* stats
+) -> void {
+    if (fields.names) {
+        node.manufacturer = get_device_property(dev, "manufacturer", stats);
+        node.product = get_device_property(dev, "product", stats);
+    }
+    if (fields.serial) {
+        node.serial = get_device_property(dev, "serial", stats);
+    }
+    if (fields.portChain) {
+        node.portChain = usbPortChainFromUdevDevice(dev);
+    }
+}
+
+auto _usbNodeFromUdev(udev_device* dev, Fw::FindStats* stats) -> std::optional<UsbNode> {
+    auto node = _usbNodeIdentityFromUdev(dev, stats);
+    if (node.has_value()) {
+        _readUsbNodeAttributes(dev, node.value(), _UsbNodeFields {}, stats);
+    }
+    return node;
+}
+
+auto _serialInfoFromUdev(udev_device* tty) -> std::optional<SerialInfo> {
+    const char* devNode = udev_device_get_devnode(tty); // Should give /dev/ttyUSBx or /dev/ttyACMx
+    if (!devNode) {
+        return std::nullopt;
+    }
+    // Go up to the USB device
+    struct udev_device* parent =
+        udev_device_get_parent_with_subsystem_devtype(tty, "usb", "usb_device");
+    if (!parent) {
+        return std::nullopt;
+    }
+    return SerialInfo {
+        .devPath = udev_device_get_syspath(parent),
+        .ttyName = devNode,
+    };
+}
+
+static auto _blockDeviceFromUdev(udev_device* dev, std::string_view expectedDevType)
+    -> std::optional<BlockDevice> {
+    const char* devType = udev_device_get_devtype(dev);
+    if (!devType || std::string_view(devType) != expectedDevType) {
+        return std::nullopt;
+    }
+    const char* devnode = udev_device_get_devnode(dev); // Should give /dev/sdX
+    if (!devnode) {
+        return std::nullopt;
+    }
+    return BlockDevice {
+        .devNum = udev_device_get_devnum(dev),
+        .devNode = devnode,
+    };
+}
+
+auto _diskInfoFromUdev(udev_device* disk) -> std::optional<DiskInfo> {
+    auto blockDevice = _blockDeviceFromUdev(disk, "disk");
+    if (!blockDevice.has_value()) {
+        return std::nullopt;
+    }
+    // Go up to the USB device
+    struct udev_device* parent =
+        udev_device_get_parent_with_subsystem_devtype(disk, "usb", "usb_device");
+    if (!parent) {
+        return std::nullopt;
+    }
+    return DiskInfo {
+        .devPath = udev_device_get_syspath(parent),
+        .diskName = blockDevice->devNode,
+        .blockDevices = { std::move(blockDevice.value()) },
+        .mountPoints = {},
+    };
+}
+
+auto _partitionInfoFromUdev(udev_device* partition) -> std::optional<PartitionInfo> {
+    auto blockDevice = _blockDeviceFromUdev(partition, "partition");
+    if (!blockDevice.has_value()) {
+        return std::nullopt;
+    }
+    struct udev_device* disk = udev_device_get_parent(partition);
+    if (!disk) {
+        return std::nullopt;
+    }
+    return PartitionInfo {
+        .diskSyspath = udev_device_get_syspath(disk),
+        .blockDevice = std::move(blockDevice.value()),
+    };
+}
+
+auto _topologyEventFromUdev(udev_device* dev, TopologyAction action)
+    -> std::optional<TopologyEvent> {
+    const char* syspath = udev_device_get_syspath(dev);
+    if (!syspath) {
+        return std::nullopt;
+    }
+    // Removed devices are gone from sysfs, the topology resolves them by syspath
+    if (action == TopologyAction::Remove) {
+        return TopologyEvent { .action = action, .syspath = syspath, .device = {} };
+    }
+    const char* _subsystem = udev_device_get_subsystem(dev);
+    std::string_view subsystem = _subsystem ? _subsystem : "";
+    auto event = TopologyEvent { .action = action, .syspath = syspath, .device = {} };
+    if (subsystem == "usb") {
+        if (auto node = _usbNodeFromUdev(dev); node.has_value()) {
+            event.device = std::move(node.value());
+        }
+    } else if (subsystem == "tty") {
+        if (auto serialPort = _serialInfoFromUdev(dev); serialPort.has_value()) {
+            event.device = std::move(serialPort.value());
+        }
+    } else if (subsystem == "block") {
+        if (auto disk = _diskInfoFromUdev(dev); disk.has_value()) {
+            event.device = std::move(disk.value());
+        } else if (auto partition = _partitionInfoFromUdev(dev); partition.has_value()) {
+            event.device = std::move(partition.value());
+        }
     }
+    if (std::holds_alternative<std::monostate>(event.device)) {
+        return std::nullopt;
+    }
+    return event;
+}
 
+auto _enumerateUdevDevices(
+    struct udev* udev,
+    const std::function<void(udev_device*)>& callback,
+    udev_device* parent,
+    const std::stop_token& stop
+) -> void {
     struct udev_enumerate* enumerate = udev_enumerate_new(udev);
+    if (!enumerate) {
+        return;
+    }
+    if (parent) {
+        udev_enumerate_add_match_parent(enumerate, parent);
+    }
+    udev_enumerate_add_match_subsystem(enumerate, "usb");
     udev_enumerate_add_match_subsystem(enumerate, "tty");
+    udev_enumerate_add_match_subsystem(enumerate, "block");
     udev_enumerate_scan_devices(enumerate);
 
     struct udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate);
     struct udev_list_entry* entry;
-
     udev_list_entry_foreach(entry, devices) {
+        if (stop.stop_requested()) {
+            break;
+        }
         const char* syspath = udev_list_entry_get_name(entry);
-        struct udev_device* tty = udev_device_new_from_syspath(udev, syspath);
-
-        const char* devNode =
-            udev_device_get_devnode(tty); // Should give /dev/ttyUSBx or /dev/ttyACMx
-        if (!devNode) {
-            udev_device_unref(tty);
+        struct udev_device* dev = udev_device_new_from_syspath(udev, syspath);
+        if (!dev) {
             continue;
         }
+        callback(dev);
+        udev_device_unref(dev);
+    }
+    udev_enumerate_unref(enumerate);
+}
 
-        // Go up to the USB device
-        struct udev_device* parent =
-            udev_device_get_parent_with_subsystem_devtype(tty, "usb", "usb_device");
-        if (parent) {
-            std::string serial = get_device_property(parent, "serial");
-            std::string devPath = udev_device_get_syspath(parent);
-            foundSerials.push_back(SerialInfo {
-                .devPath = devPath,
-                .ttyName = devNode,
-                .serial = serial,
-            });
+auto _isDiscoveryCandidate(
+    const std::unordered_map<std::string_view, const UsbNode*>& nodesBySyspath,
+    const UsbNode& node
+) -> bool {
+    if (Fw::is_freewili_hub(node.vid, node.pid) || Fw::isStandAloneDevice(node.vid, node.pid)) {
+        return true;
+    }
+    for (auto it = nodesBySyspath.find(node.parentSyspath); it != nodesBySyspath.end();
+         it = nodesBySyspath.find(it->second->parentSyspath))
+    {
+        if (Fw::is_freewili_hub(it->second->vid, it->second->pid)) {
+            return true;
         }
-        udev_device_unref(tty);
     }
-    udev_enumerate_unref(enumerate);
-    udev_unref(udev);
+    return false;
+}
 
-    return foundSerials;
+// Run work(i, stats) for every i below count on up to threads threads, the calling thread
+// included. Each thread counts into a FindStats of its own, summed into stats at the end.
+// Items are handed out one at a time, every one of them is a few file reads. Nothing more
+// is handed out once stop is requested.
+static auto _parallelFor(
+    size_t count,
+    size_t threads,
+    Fw::FindStats* stats,
+    const std::function<void(size_t, Fw::FindStats*)>& work,
+    const std::stop_token& stop = {}
+) -> void {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count && !stop.stop_requested(); ++i) {
+            work(i, stats);
+        }
+        return;
+    }
+    std::atomic<size_t> next = 0;
+    std::vector<Fw::FindStats> workerStats(threads);
+    auto worker = [&](size_t slot) {
+        Fw::FindStats* counters = stats ? &workerStats[slot] : nullptr;
+        for (size_t i = next++; i < count && !stop.stop_requested(); i = next++) {
+            work(i, counters);
+        }
+    };
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads - 1);
+        try {
+            for (size_t slot = 1; slot < threads; ++slot) {
+                workers.emplace_back(worker, slot);
+            }
+        } catch (const std::system_error&) {
+            // Out of threads, whoever did start shares the work with the calling thread
+        }
+        worker(0);
+    }
+    if (stats) {
+        for (const auto& counters: workerStats) {
+            stats->devicesVisited += counters.devicesVisited;
+            stats->attributeReads += counters.attributeReads;
+        }
+    }
 }
 
-auto _createUSBDeviceFromUDevDevice(
-    udev_device* dev,
-    std::optional<std::reference_wrapper<const DiskInfo>> diskInfo,
-    std::optional<std::reference_wrapper<const SerialInfo>> serialInfo
-) -> std::optional<Fw::USBDevice> {
-    using namespace Fw;
+// Move the candidates of nodes into the table, returns the position in nodes of each one
+static auto _keepDiscoveryCandidates(DeviceTable& table, std::vector<UsbNode> nodes)
+    -> std::vector<size_t> {
+    std::unordered_map<std::string_view, const UsbNode*> nodesBySyspath;
+    nodesBySyspath.reserve(nodes.size());
+    for (const auto& node: nodes) {
+        nodesBySyspath.emplace(node.syspath, &node);
+    }
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (_isDiscoveryCandidate(nodesBySyspath, nodes[i])) {
+            candidates.push_back(i);
+        }
+    }
+    nodesBySyspath.clear();
+    table.usbDevices.reserve(table.usbDevices.size() + candidates.size());
+    for (auto i: candidates) {
+        table.usbDevices.push_back(std::move(nodes[i]));
+    }
+    return candidates;
+}
 
-    if (!dev) {
-        return std::nullopt;
+// read(position, node, fields, stats) reads the attributes of the candidates of a scan on up
+// to threads threads, position being where the node was before _keepDiscoveryCandidates().
+// With a key, what _mayMatchOwner() looks at is read first and the rest only for the owners
+// it lets through.
+static auto _resolveDiscoveryCandidates(
+    DeviceTable& table,
+    std::vector<size_t> positions,
+    const OwnerKey& key,
+    const std::function<void(size_t, UsbNode&, const _UsbNodeFields&, Fw::FindStats*)>& read,
+    size_t threads,
+    Fw::FindStats* stats,
+    const std::stop_token& stop = {}
+) -> void {
+    auto readAll = [&](const _UsbNodeFields& fields) {
+        _parallelFor(
+            table.usbDevices.size(),
+            threads,
+            stats,
+            [&](size_t i, Fw::FindStats* counters) {
+                read(positions[i], table.usbDevices[i], fields, counters);
+            },
+            stop
+        );
+    };
+    if (key.serial.empty() && !key.uniqueID.has_value()) {
+        readAll(_UsbNodeFields {});
+        return;
+    }
+    readAll({ .names = false, .serial = !key.serial.empty(), .portChain = true });
+    if (stop.stop_requested()) {
+        return;
     }
+    auto kept = _keepOwnersMatchingKey(table, key);
+    for (size_t i = 0; i < kept.size(); ++i) {
+        kept[i] = positions[kept[i]];
+    }
+    positions = std::move(kept);
+    readAll({ .names = true, .serial = key.serial.empty(), .portChain = false });
+}
 
-    // Get device properties
-    std::string idVendor = get_device_property(dev, "idVendor");
-    std::string idProduct = get_device_property(dev, "idProduct");
+// Syspaths of the usb_devices a scan kept, views into the table
+static auto _usbDeviceSyspaths(const DeviceTable& table) -> std::unordered_set<std::string_view> {
+    std::unordered_set<std::string_view> syspaths;
+    syspaths.reserve(table.usbDevices.size());
+    for (const auto& node: table.usbDevices) {
+        syspaths.insert(node.syspath);
+    }
+    return syspaths;
+}
 
-    if (idVendor.empty() || idProduct.empty()) {
-        return std::nullopt;
+/// Enumerates the usb, tty and block subsystems in a single udev pass.
+auto _scanDeviceTable(
+    Fw::FindStats* stats,
+    const ScanScope& scope,
+    const std::stop_token& stop
+) noexcept -> std::expected<DeviceTable, std::string> {
+    DeviceTable table;
+    std::optional<PhaseTimer> enumerateTimer(std::in_place, stats, &Fw::FindStats::enumerateTime);
+    struct udev* udev = udev_new();
+    if (!udev) {
+        return std::unexpected("Failed to initialize udev");
+    }
+    struct udev_device* subtree = nullptr;
+    if (!scope.subtree.empty()) {
+        subtree = udev_device_new_from_syspath(udev, scope.subtree.c_str());
+        if (!subtree) {
+            udev_unref(udev);
+            return std::unexpected("Failed to open " + scope.subtree);
+        }
     }
 
-    uint16_t vid = string_to_int<uint16_t>(idVendor, 16).value_or(0);
-    uint16_t pid = string_to_int<uint16_t>(idProduct, 16).value_or(0);
+    // usb_devices are held on to until the prefilter decided which ones get read in full
+    std::vector<UsbNode> nodes;
+    std::vector<udev_device*> nodeDevices;
+    // Attached to the table once it is known which usb_devices are kept
+    std::vector<SerialInfo> serialPorts;
+    std::vector<DiskInfo> disks;
+    // Partitions are enumerated alongside their disk, remember where each disk went
+    std::unordered_map<std::string, size_t> diskSlots;
+    std::vector<PartitionInfo> partitions;
+    _enumerateUdevDevices(
+        udev,
+        [&](udev_device* dev) {
+            if (stats) {
+                ++stats->devicesVisited;
+            }
+            const char* _subsystem = udev_device_get_subsystem(dev);
+            std::string_view subsystem = _subsystem ? _subsystem : "";
+            if (subsystem == "usb") {
+                if (auto node = _usbNodeIdentityFromUdev(dev, stats); node.has_value()) {
+                    nodes.push_back(std::move(node.value()));
+                    nodeDevices.push_back(udev_device_ref(dev));
+                }
+            } else if (subsystem == "tty") {
+                if (auto serialPort = _serialInfoFromUdev(dev); serialPort.has_value()) {
+                    serialPorts.push_back(std::move(serialPort.value()));
+                }
+            } else if (subsystem == "block") {
+                if (auto disk = _diskInfoFromUdev(dev); disk.has_value()) {
+                    diskSlots.emplace(udev_device_get_syspath(dev), disks.size());
+                    disks.push_back(std::move(disk.value()));
+                } else if (auto partition = _partitionInfoFromUdev(dev); partition.has_value()) {
+                    partitions.push_back(std::move(partition.value()));
+                }
+            }
+        },
+        subtree,
+        stop
+    );
 
-    if (vid == 0 || pid == 0) {
-        return std::nullopt;
+    for (auto& partition: partitions) {
+        if (auto it = diskSlots.find(partition.diskSyspath); it != diskSlots.end()) {
+            disks[it->second].blockDevices.push_back(std::move(partition.blockDevice));
+        }
+    }
+    // libudev objects can't be shared between threads
+    _resolveDiscoveryCandidates(
+        table,
+        _keepDiscoveryCandidates(table, std::move(nodes)),
+        scope.ownerKey,
+        [&](size_t i, UsbNode& node, const _UsbNodeFields& fields, Fw::FindStats* counters) {
+            _readUsbNodeAttributes(nodeDevices[i], node, fields, counters);
+        },
+        1,
+        stats,
+        stop
+    );
+    if (scope.ownerFilter && !stop.stop_requested()) {
+        _keepMatchingOwner(table, scope.ownerFilter);
+    }
+    // Disks and serial ports of rejected usb_devices are never looked at by discovery
+    const auto kept = _usbDeviceSyspaths(table);
+    for (auto& serialPort: serialPorts) {
+        if (kept.contains(serialPort.devPath)) {
+            table.serialPorts.push_back(std::move(serialPort));
+        }
+    }
+    for (auto& disk: disks) {
+        if (kept.contains(disk.devPath)) {
+            table.disks.push_back(std::move(disk));
+        }
+    }
+    for (udev_device* dev: nodeDevices) {
+        udev_device_unref(dev);
+    }
+    if (subtree) {
+        udev_device_unref(subtree);
+    }
+    udev_unref(udev);
+    enumerateTimer.reset();
+    if (stop.stop_requested()) {
+        return std::unexpected(_cancelled);
+    }
+    // One mount table snapshot serves every disk and partition of the scan
+    if (!table.disks.empty()) {
+        PhaseTimer mountTimer(stats, &Fw::FindStats::mountTime);
+        const auto mounts = _readMountTable("/proc/self/mountinfo", "/proc/mounts");
+        for (auto& disk: table.disks) {
+            disk.mountPoints = _findMountPoints(mounts, disk);
+        }
     }
 
-    std::string manufacturer = get_device_property(dev, "manufacturer");
-    std::string productName = get_device_property(dev, "product");
-    std::string serial = get_device_property(dev, "serial");
-    const char* _devPath = udev_device_get_syspath(dev);
-    std::string devPath = _devPath ? _devPath : "";
-    const char* _sysnum = udev_device_get_sysnum(dev);
-    std::string sysnum = _sysnum ? _sysnum : "";
-    uint32_t location = string_to_int<uint32_t>(sysnum, 10).value_or(0);
-    std::vector<uint32_t> portChain = usbPortChainFromUdevDevice(dev);
+    return table;
+}
+
+// sysfs never hands out more than a page per attribute
+using _SysfsBuffer = std::array<char, 4096>;
 
-    // Build device name
-    std::string deviceName;
-    if (!manufacturer.empty() && !productName.empty()) {
-        deviceName = manufacturer + " " + productName;
-    } else if (!productName.empty()) {
-        deviceName = productName;
-    } else if (!manufacturer.empty()) {
-        deviceName = manufacturer;
+// Reads directory/name into buffer, the path is assembled in buffer too. Neither an ifstream,
+// which allocates an 8 KiB filebuf, nor a path string allocate for the thousands of reads of
+// a scan.
+static auto _readSysfsFile(std::string_view directory, std::string_view name, _SysfsBuffer& buffer)
+    -> std::optional<std::string_view> {
+    if (directory.size() + name.size() + 2 > buffer.size()) {
+        return std::nullopt;
     }
+    auto end = std::copy(directory.begin(), directory.end(), buffer.begin());
+    *end++ = '/';
+    end = std::copy(name.begin(), name.end(), end);
+    *end = '\0';
+    int fd = ::open(buffer.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    size_t size = 0;
+    while (size < buffer.size()) {
+        auto count = ::read(fd, buffer.data() + size, buffer.size() - size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        size += static_cast<size_t>(count);
+    }
+    ::close(fd);
+    return std::string_view(buffer.data(), size);
+}
 
-    return Fw::USBDevice {
-        .kind = Fw::getUSBDeviceTypeFrom(vid, pid, location),
-        .vid = vid,
-        .pid = pid,
-        .name = deviceName,
-        .serial = serial,
-        .location = static_cast<uint8_t>(location),
-        .portChain = portChain,
-        .paths = diskInfo.has_value()
-            ? std::optional<std::vector<std::string>>(diskInfo->get().mountPoints)
-            : std::nullopt,
-        .port = serialInfo.has_value() ? std::optional<std::string>(serialInfo->get().ttyName)
-                                       : std::nullopt,
-        ._raw = devPath,
-    };
+// Read a sysfs attribute the way udev does, trailing newlines stripped
+static auto _readSysfsAttribute(
+    const std::string& syspath,
+    const char* name,
+    Fw::FindStats* stats = nullptr
+) -> std::string {
+    if (stats) {
+        ++stats->attributeReads;
+    }
+    _SysfsBuffer buffer;
+    auto contents = _readSysfsFile(syspath, name, buffer);
+    if (!contents.has_value()) {
+        return "";
+    }
+    auto value = contents->substr(0, contents->find('\n'));
+    while (!value.empty() && value.back() == ' ') {
+        value.remove_suffix(1);
+    }
+    return std::string(value);
 }
 
-auto _find_all_standalone(
-    const std::vector<DiskInfo>& disks,
-    const std::vector<SerialInfo>& serialPorts
-) noexcept -> std::expected<Fw::FreeWiliDevices, std::string> {
-    using namespace Fw;
-    Fw::FreeWiliDevices fwDevices;
+// Trailing digits of the device name, matches udev_device_get_sysnum()
+static auto _sysnumOf(std::string_view syspath) -> std::string_view {
+    auto sysname = syspath.substr(syspath.rfind('/') + 1);
+    auto end = sysname.size();
+    while (end > 0 && std::isdigit(static_cast<unsigned char>(sysname[end - 1]))) {
+        --end;
+    }
+    return sysname.substr(end);
+}
 
-    struct udev* udev = udev_new();
-    if (!udev) {
-        return std::unexpected("Failed to initialize udev");
+// /dev node of a tty or block device, from DEVNAME in its uevent
+static auto _sysfsDevNode(const std::string& syspath, Fw::FindStats* stats)
+    -> std::optional<std::string> {
+    if (stats) {
+        ++stats->attributeReads;
     }
+    _SysfsBuffer buffer;
+    auto uevent = _readSysfsFile(syspath, "uevent", buffer);
+    while (uevent.has_value() && !uevent->empty()) {
+        auto end = uevent->find('\n');
+        auto line = uevent->substr(0, end);
+        if (line.starts_with("DEVNAME=")) {
+            return "/dev/" + std::string(line.substr(std::string_view("DEVNAME=").size()));
+        }
+        uevent->remove_prefix(end == std::string_view::npos ? uevent->size() : end + 1);
+    }
+    return std::nullopt;
+}
 
-    struct udev_enumerate* enumerate = udev_enumerate_new(udev);
-    udev_enumerate_add_match_subsystem(enumerate, "usb");
-    udev_enumerate_scan_devices(enumerate);
+// Looks std::string keys up by std::string_view without building a std::string
+struct _SyspathHash {
+    using is_transparent = void;
 
-    struct udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate);
-    struct udev_list_entry* dev_list_entry;
+    auto operator()(std::string_view syspath) const noexcept -> size_t {
+        return std::hash<std::string_view> {}(syspath);
+    }
+};
 
-    udev_list_entry_foreach(dev_list_entry, devices) {
-        const char* path = udev_list_entry_get_name(dev_list_entry);
-        struct udev_device* dev = udev_device_new_from_syspath(udev, path);
+using _SyspathSet = std::unordered_set<std::string, _SyspathHash, std::equal_to<>>;
 
-        std::string idVendor = get_device_property(dev, "idVendor");
-        std::string idProduct = get_device_property(dev, "idProduct");
-        uint16_t vid = string_to_int<uint16_t>(idVendor, 16).value_or(0);
-        uint16_t pid = string_to_int<uint16_t>(idProduct, 16).value_or(0);
+// Nearest usb_device above syspath, the device itself excluded
+static auto _sysfsUsbParent(
+    const _SyspathSet& usbDevices,
+    std::string_view syspath
+) -> const std::string* {
+    while (!syspath.empty()) {
+        auto slash = syspath.rfind('/');
+        if (slash == std::string_view::npos || slash == 0) {
+            break;
+        }
+        syspath = syspath.substr(0, slash);
+        if (auto it = usbDevices.find(syspath); it != usbDevices.end()) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
 
-        // Check if this is a standalone device
-        if (!Fw::isStandAloneDevice(vid, pid)) {
-            udev_device_unref(dev);
+// Resolve every entry of a /sys/class or /sys/bus directory to its /sys/devices path,
+// sorted like a udev enumeration. readdir() and realpath() into a stack buffer leave the
+// result string as the only allocation per entry, std::filesystem::canonical() allocates
+// a path per component.
+static auto _sysfsDevices(const std::string& directory) -> std::vector<std::string> {
+    std::vector<std::string> syspaths;
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) {
+        return syspaths;
+    }
+    std::array<char, PATH_MAX> entryPath;
+    std::array<char, PATH_MAX> resolved;
+    while (const dirent* entry = ::readdir(dir)) {
+        std::string_view name = entry->d_name;
+        if (name == "." || name == ".." || directory.size() + name.size() + 2 > PATH_MAX) {
             continue;
         }
-
-        // Check if the parent USB controller is NOT a FreeWili Hub
-        struct udev_device* parent =
-            udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
-        if (parent) {
-            std::string parentIdVendor = get_device_property(parent, "idVendor");
-            std::string parentIdProduct = get_device_property(parent, "idProduct");
-            uint16_t parentVid = string_to_int<uint16_t>(parentIdVendor, 16).value_or(0);
-            uint16_t parentPid = string_to_int<uint16_t>(parentIdProduct, 16).value_or(0);
-
-            // Skip if parent is a FreeWili Hub, it's already accounted for there
-            if (Fw::is_freewili_hub(parentVid, parentPid)) {
-                udev_device_unref(dev);
-                continue;
-            }
+        auto end = std::copy(directory.begin(), directory.end(), entryPath.begin());
+        *end++ = '/';
+        end = std::copy(name.begin(), name.end(), end);
+        *end = '\0';
+        if (::realpath(entryPath.data(), resolved.data())) {
+            syspaths.emplace_back(resolved.data());
         }
+    }
+    ::closedir(dir);
+    std::sort(syspaths.begin(), syspaths.end());
+    return syspaths;
+}
 
-        // Get device information
-        std::string manufacturer = get_device_property(dev, "manufacturer");
-        std::string productName = get_device_property(dev, "product");
-        std::string serial = get_device_property(dev, "serial");
-        const char* _sysnum = udev_device_get_sysnum(dev);
-        std::string sysnum = _sysnum ? _sysnum : "";
-        uint32_t deviceLocation = string_to_int<uint32_t>(sysnum, 10).value_or(0);
-        std::string devPath = udev_device_get_syspath(dev);
-        std::vector<uint32_t> portChain = usbPortChainFromUdevDevice(dev);
+// The usb_devices, ttys and block devices a sysfs scan reads, each sorted like a udev enumeration
+struct _SysfsListing {
+    std::vector<std::string> usbDevices;
+    std::vector<std::string> ttys;
+    std::vector<std::string> blocks;
+};
 
-        // Find associated disk
-        auto diskIter = std::find_if(disks.begin(), disks.end(), [&](const DiskInfo& disk) {
-            return disk.devPath == devPath;
-        });
+static auto _sysfsListing(const std::string& sysRoot) -> _SysfsListing {
+    _SysfsListing listing {
+        .usbDevices = _sysfsDevices(sysRoot + "/bus/usb/devices"),
+        .ttys = _sysfsDevices(sysRoot + "/class/tty"),
+        .blocks = _sysfsDevices(sysRoot + "/class/block"),
+    };
+    // Interfaces ("1-1:1.0") live in the same directory as the usb_devices
+    std::erase_if(listing.usbDevices, [](const std::string& syspath) {
+        return syspath.substr(syspath.rfind('/') + 1).contains(':');
+    });
+    return listing;
+}
 
-        // Find associated serial port
-        auto serialIter =
-            std::find_if(serialPorts.begin(), serialPorts.end(), [&](const SerialInfo& serialInfo) {
-                return serialInfo.devPath == devPath;
-            });
+// Same as _sysfsListing() for a usb_device and everything below it, found by walking its
+// directory instead of the class directories of the whole host
+static auto _sysfsSubtreeListing(const std::string& syspath) -> _SysfsListing {
+    _SysfsListing listing;
+    listing.usbDevices.push_back(syspath);
+    std::error_code ec;
+    auto it = std::filesystem::recursive_directory_iterator(syspath, ec);
+    for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        // subsystem, driver, port... all link back up or across the tree
+        if (it->is_symlink(ec) || !it->is_directory(ec)) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        const auto name = it->path().filename().string();
+        const auto parent = it->path().parent_path().filename().string();
+        if (name == "power" || name.starts_with("ep_")) {
+            it.disable_recursion_pending();
+        } else if (parent == "tty") {
+            listing.ttys.push_back(it->path().string());
+            it.disable_recursion_pending();
+        } else if (parent == "block") {
+            listing.blocks.push_back(it->path().string());
+        } else if (it->path().parent_path().parent_path().filename() == "block") {
+            // Partitions sit next to the queue, holders... directories of their disk
+            if (std::filesystem::exists(it->path() / "partition", ec)) {
+                listing.blocks.push_back(it->path().string());
+            }
+            it.disable_recursion_pending();
+        } else if (!name.contains(':') && std::filesystem::exists(it->path() / "idVendor", ec)) {
+            listing.usbDevices.push_back(it->path().string());
+        }
+    }
+    std::sort(listing.usbDevices.begin(), listing.usbDevices.end());
+    std::sort(listing.ttys.begin(), listing.ttys.end());
+    std::sort(listing.blocks.begin(), listing.blocks.end());
+    return listing;
+}
 
-        // Create USB devices list
-        USBDevices devices;
+auto _scanSysfsDeviceTable(
+    const std::string& root,
+    Fw::FindStats* stats,
+    const ScanScope& scope,
+    size_t threads,
+    const std::stop_token& stop
+) noexcept -> std::expected<DeviceTable, std::string> {
+    std::optional<PhaseTimer> enumerateTimer(std::in_place, stats, &Fw::FindStats::enumerateTime);
+    const auto sysRoot = root + "/sys";
+    std::error_code ec;
+    if (!std::filesystem::is_directory(sysRoot, ec)) {
+        return std::unexpected("Failed to open " + sysRoot);
+    }
+    DeviceTable table;
+    auto visited = [stats](size_t count) {
+        if (stats) {
+            stats->devicesVisited += count;
+        }
+    };
 
-        // Add the standalone device
-        devices.push_back(Fw::USBDevice {
-            .kind = Fw::getUSBDeviceTypeFrom(vid, pid, deviceLocation),
+    if (!scope.subtree.empty() && !std::filesystem::is_directory(scope.subtree, ec)) {
+        return std::unexpected("Failed to open " + scope.subtree);
+    }
+    const auto listing =
+        scope.subtree.empty() ? _sysfsListing(sysRoot) : _sysfsSubtreeListing(scope.subtree);
+    visited(listing.usbDevices.size());
+    _SyspathSet usbDevices(listing.usbDevices.begin(), listing.usbDevices.end());
+    // The usb_devices above a subtree give it its parent and port chain, they aren't read
+    if (!scope.subtree.empty()) {
+        for (auto path = std::filesystem::path(scope.subtree).parent_path();
+             std::filesystem::exists(path / "idVendor", ec);
+             path = path.parent_path())
+        {
+            usbDevices.insert(path.string());
+        }
+    }
+    // Every phase reads into slots of its own and is collected in listing order, the table
+    // is the same whatever the number of threads
+    std::vector<std::optional<UsbNode>> identities(listing.usbDevices.size());
+    auto readIdentity = [&](size_t i, Fw::FindStats* counters) {
+        const auto& syspath = listing.usbDevices[i];
+        uint16_t vid =
+            string_to_int<uint16_t>(_readSysfsAttribute(syspath, "idVendor", counters), 16)
+                .value_or(0);
+        uint16_t pid =
+            string_to_int<uint16_t>(_readSysfsAttribute(syspath, "idProduct", counters), 16)
+                .value_or(0);
+        if (vid == 0 || pid == 0) {
+            return;
+        }
+        const std::string* parent = _sysfsUsbParent(usbDevices, syspath);
+        identities[i] = UsbNode {
+            .syspath = syspath,
+            .parentSyspath = parent ? *parent : "",
             .vid = vid,
             .pid = pid,
-            .name = manufacturer.empty() ? productName : manufacturer + " " + productName,
-            .serial = serial,
-            .location = static_cast<uint8_t>(deviceLocation),
-            .portChain = portChain,
-            .paths = diskIter == disks.end()
-                ? std::nullopt
-                : std::optional<std::vector<std::string>>(diskIter->mountPoints),
-            .port = serialIter == serialPorts.end()
-                ? std::nullopt
-                : std::optional<std::string>(serialIter->ttyName),
-            ._raw = devPath,
+            .manufacturer = {},
+            .product = {},
+            .serial = {},
+            .location = string_to_int<uint32_t>(std::string(_sysnumOf(syspath))).value_or(0),
+            .portChain = {},
+        };
+    };
+    _parallelFor(identities.size(), threads, stats, readIdentity, stop);
+    std::vector<UsbNode> nodes;
+    for (auto& identity: identities) {
+        if (identity.has_value()) {
+            nodes.push_back(std::move(identity.value()));
+        }
+    }
+    identities.clear();
+    _resolveDiscoveryCandidates(
+        table,
+        _keepDiscoveryCandidates(table, std::move(nodes)),
+        scope.ownerKey,
+        [&](size_t, UsbNode& node, const _UsbNodeFields& fields, Fw::FindStats* counters) {
+            if (fields.names) {
+                node.manufacturer = _readSysfsAttribute(node.syspath, "manufacturer", counters);
+                node.product = _readSysfsAttribute(node.syspath, "product", counters);
+            }
+            if (fields.serial) {
+                node.serial = _readSysfsAttribute(node.syspath, "serial", counters);
+            }
+            if (!fields.portChain) {
+                return;
+            }
+            // Same walk as usbPortChainFromUdevDevice(), root hub first. USB nests at most
+            // 7 tiers deep, a bus number on top of that fits without growing.
+            node.portChain.reserve(8);
+            const std::string* current = &node.syspath;
+            while (current) {
+                auto port = string_to_int<uint32_t>(std::string(_sysnumOf(*current)));
+                if (!port.has_value()) {
+                    break;
+                }
+                node.portChain.push_back(port.value());
+                current = _sysfsUsbParent(usbDevices, *current);
+            }
+            std::reverse(node.portChain.begin(), node.portChain.end());
+        },
+        threads,
+        stats,
+        stop
+    );
+    if (stop.stop_requested()) {
+        return std::unexpected(_cancelled);
+    }
+    if (scope.ownerFilter) {
+        _keepMatchingOwner(table, scope.ownerFilter);
+    }
+    const auto kept = _usbDeviceSyspaths(table);
+
+    visited(listing.ttys.size());
+    std::vector<std::optional<SerialInfo>> serialPorts(listing.ttys.size());
+    auto readSerialPort = [&](size_t i, Fw::FindStats* counters) {
+        // Virtual consoles, ptys and ports of rejected usb_devices aren't read any further
+        const std::string* parent = _sysfsUsbParent(usbDevices, listing.ttys[i]);
+        if (!parent || !kept.contains(*parent)) {
+            return;
+        }
+        if (auto devNode = _sysfsDevNode(listing.ttys[i], counters); devNode.has_value()) {
+            serialPorts[i] = SerialInfo {
+                .devPath = *parent,
+                .ttyName = std::move(devNode.value()),
+            };
+        }
+    };
+    _parallelFor(serialPorts.size(), threads, stats, readSerialPort, stop);
+    for (auto& serialPort: serialPorts) {
+        if (serialPort.has_value()) {
+            table.serialPorts.push_back(std::move(serialPort.value()));
+        }
+    }
+
+    struct BlockSlot {
+        const std::string* parent = nullptr;
+        std::optional<BlockDevice> device;
+        bool partition = false;
+    };
+    visited(listing.blocks.size());
+    std::vector<BlockSlot> blocks(listing.blocks.size());
+    auto readBlock = [&](size_t i, Fw::FindStats* counters) {
+        const auto& syspath = listing.blocks[i];
+        const std::string* parent = _sysfsUsbParent(usbDevices, syspath);
+        if (!parent || !kept.contains(*parent)) {
+            return;
+        }
+        auto devNode = _sysfsDevNode(syspath, counters);
+        auto devNum = _readSysfsAttribute(syspath, "dev", counters);
+        auto colon = devNum.find(':');
+        if (!devNode.has_value() || colon == std::string::npos) {
+            return;
+        }
+        auto major = string_to_int<unsigned int>(devNum.substr(0, colon));
+        auto minor = string_to_int<unsigned int>(devNum.substr(colon + 1));
+        if (!major.has_value() || !minor.has_value()) {
+            return;
+        }
+        _SysfsBuffer buffer;
+        blocks[i] = BlockSlot {
+            .parent = parent,
+            .device =
+                BlockDevice {
+                    .devNum = makedev(major.value(), minor.value()),
+                    .devNode = std::move(devNode.value()),
+                },
+            .partition = _readSysfsFile(syspath, "partition", buffer).has_value(),
+        };
+    };
+    _parallelFor(blocks.size(), threads, stats, readBlock, stop);
+    if (stop.stop_requested()) {
+        return std::unexpected(_cancelled);
+    }
+    // Partitions sort right after their disk, so the disk is always known by then
+    std::unordered_map<std::string, size_t> diskSlots;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        auto& block = blocks[i];
+        if (!block.device.has_value()) {
+            continue;
+        }
+        const auto& syspath = listing.blocks[i];
+        if (block.partition) {
+            auto disk = syspath.substr(0, syspath.rfind('/'));
+            if (auto it = diskSlots.find(disk); it != diskSlots.end()) {
+                table.disks[it->second].blockDevices.push_back(std::move(block.device.value()));
+            }
+            continue;
+        }
+        diskSlots.emplace(syspath, table.disks.size());
+        table.disks.push_back(DiskInfo {
+            .devPath = *block.parent,
+            .diskName = block.device->devNode,
+            .blockDevices = { std::move(block.device.value()) },
+            .mountPoints = {},
         });
+    }
+    enumerateTimer.reset();
+    if (!table.disks.empty()) {
+        PhaseTimer mountTimer(stats, &Fw::FindStats::mountTime);
+        const auto mounts = _readMountTable(root + "/proc/self/mountinfo", root + "/proc/mounts");
+        for (auto& disk: table.disks) {
+            disk.mountPoints = _findMountPoints(mounts, disk);
+        }
+    }
+    return table;
+}
 
-        // Create FreeWili device from USB devices
-        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(devices); result.has_value()) {
-            auto fwDevice = std::move(result.value());
-            fwDevices.push_back(std::move(fwDevice));
-        } else {
-            std::cerr << "Failed to create FreeWiliDevice: " << result.error() << std::endl;
+auto _buildDeviceIndex(const DeviceTable& table) -> DeviceIndex {
+    DeviceIndex index;
+    index.nodesBySyspath.reserve(table.usbDevices.size());
+    for (const auto& node: table.usbDevices) {
+        index.nodesBySyspath.emplace(node.syspath, &node);
+        if (!node.parentSyspath.empty()) {
+            index.childrenBySyspath[node.parentSyspath].push_back(&node);
         }
+    }
+    // The first entry wins when a usb_device exposes several ports (debug probe, ESP32)
+    for (const auto& disk: table.disks) {
+        index.disksBySyspath.emplace(disk.devPath, &disk);
+    }
+    for (const auto& serialPort: table.serialPorts) {
+        index.serialPortsBySyspath.emplace(serialPort.devPath, &serialPort);
+    }
+    return index;
+}
 
-        udev_device_unref(dev);
+// Look up the entry attached to the node itself, falling back to its usb_device ancestors.
+template<typename T>
+static auto _findNearest(
+    const DeviceIndex& index,
+    const std::unordered_map<std::string_view, const T*>& entries,
+    const UsbNode& node
+) -> const T* {
+    if (entries.empty()) {
+        return nullptr;
     }
+    const UsbNode* current = &node;
+    while (current) {
+        if (auto it = entries.find(current->syspath); it != entries.end()) {
+            return it->second;
+        }
+        auto parentIter = index.nodesBySyspath.find(current->parentSyspath);
+        current = parentIter == index.nodesBySyspath.end() ? nullptr : parentIter->second;
+    }
+    return nullptr;
+}
 
-    udev_enumerate_unref(enumerate);
-    udev_unref(udev);
+auto _findDiskInfo(const DeviceIndex& index, const UsbNode& node) -> const DiskInfo* {
+    return _findNearest(index, index.disksBySyspath, node);
+}
 
-    // Sort the devices by UniqueID
-    std::sort(
-        fwDevices.begin(),
-        fwDevices.end(),
-        [](const Fw::FreeWiliDevice& lhs, const Fw::FreeWiliDevice& rhs) {
-            return lhs.uniqueID < rhs.uniqueID;
-        }
-    );
+auto _findSerialInfo(const DeviceIndex& index, const UsbNode& node) -> const SerialInfo* {
+    return _findNearest(index, index.serialPortsBySyspath, node);
+}
 
-    return fwDevices;
+// Both discovery paths build their USBDevices here so disks and ports associate the same way.
+static auto _createUSBDevice(const DeviceIndex& index, const UsbNode& node, std::string name)
+    -> Fw::USBDevice {
+    const DiskInfo* disk = _findDiskInfo(index, node);
+    const SerialInfo* serialPort = _findSerialInfo(index, node);
+    return Fw::USBDevice {
+        .kind = Fw::getUSBDeviceTypeFrom(node.vid, node.pid, node.location),
+        .vid = node.vid,
+        .pid = node.pid,
+        .name = std::move(name),
+        .serial = node.serial,
+        .location = static_cast<uint8_t>(node.location),
+        .portChain = node.portChain,
+        .paths = disk ? std::optional<std::vector<std::string>>(disk->mountPoints) : std::nullopt,
+        .port = serialPort ? std::optional<std::string>(serialPort->ttyName) : std::nullopt,
+        ._raw = node.syspath,
+    };
 }
 
-auto _find_all_freewili(
-    const std::vector<DiskInfo>& disks,
-    const std::vector<SerialInfo>& serialPorts
-) noexcept -> std::expected<Fw::FreeWiliDevices, std::string> {
-    using namespace Fw;
-    // helper function to find all usb devices attached to the hub
-    auto findUsbHubChildren = [&](udev* udev,
-                                  udev_list_entry* dev_list_entry,
-                                  udev_list_entry* devices,
-                                  const USBDevice& usbHubDevice) -> USBDevices {
-        USBDevices foundUsbDevices;
-        udev_list_entry_foreach(dev_list_entry, devices) {
-            const char* path = udev_list_entry_get_name(dev_list_entry);
-            struct udev_device* dev = udev_device_new_from_syspath(udev, path);
-
-            struct udev_device* parent =
-                udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
-            if (!parent) {
-                udev_device_unref(dev);
-                continue;
-            }
-            std::string parentPath = udev_device_get_syspath(parent);
-            if (!parentPath.contains(usbHubDevice._raw)) {
-                udev_device_unref(dev);
-                continue;
-            }
-            // Finally we matched a USB child to the parent hub
-            std::string idVendor = get_device_property(dev, "idVendor");
-            std::string idProduct = get_device_property(dev, "idProduct");
-            if (idVendor.empty() || idProduct.empty()) {
-                udev_device_unref(dev);
-                continue;
-            }
-            std::string manufacturer = get_device_property(dev, "manufacturer");
-            std::string productName = get_device_property(dev, "product");
-            std::string serial = get_device_property(dev, "serial");
-            const char* _devPath = udev_device_get_syspath(dev);
-            std::string devPath = _devPath ? _devPath : "";
-            const char* busnum = udev_device_get_sysattr_value(dev, "busnum");
-            const char* devnum = udev_device_get_sysattr_value(dev, "devnum");
-            const char* _sysnum = udev_device_get_sysnum(dev);
-            std::string sysnum = _sysnum ? _sysnum : "";
-            const char* _devNode = udev_device_get_devnode(dev);
-            uint16_t vid = string_to_int<uint16_t>(idVendor, 16).value_or(0);
-            uint16_t pid = string_to_int<uint16_t>(idProduct, 16).value_or(0);
-            uint32_t location = string_to_int<uint32_t>(sysnum, 10).value_or(0);
-            std::vector<uint32_t> portChain = usbPortChainFromUdevDevice(dev);
-            if (vid == 0 || pid == 0) {
-                udev_device_unref(dev);
-                continue;
+auto _findUsbHubChildren(const DeviceIndex& index, std::string_view hubSyspath)
+    -> std::vector<const UsbNode*> {
+    std::vector<const UsbNode*> children;
+    // Walk the whole subtree, nested hubs contribute their children as well
+    std::vector<std::string_view> pending = { hubSyspath };
+    while (!pending.empty()) {
+        auto syspath = pending.back();
+        pending.pop_back();
+        if (auto it = index.childrenBySyspath.find(syspath); it != index.childrenBySyspath.end()) {
+            for (const UsbNode* child: it->second) {
+                children.push_back(child);
+                pending.push_back(child->syspath);
             }
-            auto diskPathIter = std::find_if(disks.begin(), disks.end(), [&](const DiskInfo& disk) {
-                return devPath.contains(disk.devPath);
-            });
-            auto serialIter =
-                std::find_if(serialPorts.begin(), serialPorts.end(), [&](const SerialInfo& serial) {
-                    return devPath.contains(serial.devPath);
-                });
-            foundUsbDevices.push_back(USBDevice {
-                .kind = Fw::getUSBDeviceTypeFrom(vid, pid, location),
-                .vid = vid,
-                .pid = pid,
-                .name = manufacturer + " " + productName,
-                .serial = serial,
-                .location = static_cast<uint8_t>(location),
-                .portChain = portChain,
-                .paths = diskPathIter == disks.end()
-                    ? std::nullopt
-                    : std::optional<std::vector<std::string>>(diskPathIter->mountPoints),
-                .port = serialIter == serialPorts.end()
-                    ? std::nullopt
-                    : std::optional<std::string>(serialIter->ttyName),
-                ._raw = devPath,
-            });
-            udev_device_unref(dev);
-        }
-        return foundUsbDevices;
-    };
+        }
+    }
+    // Nodes live contiguously in the DeviceTable, restore enumeration order
+    std::sort(children.begin(), children.end());
+    return children;
+}
 
-    Fw::FreeWiliDevices fwDevices;
+auto _isDiscoveryOwner(const DeviceIndex& index, const UsbNode& node) -> bool {
+    // Matches both the FREE-WILi and the FREE-WILi2 internal hubs
+    if (Fw::is_freewili_hub(node.vid, node.pid)) {
+        return true;
+    }
+    if (!Fw::isStandAloneDevice(node.vid, node.pid)) {
+        return false;
+    }
+    // Skip if parent is a FreeWili Hub, it's already accounted for there
+    auto parentIter = index.nodesBySyspath.find(node.parentSyspath);
+    return parentIter == index.nodesBySyspath.end()
+        || !Fw::is_freewili_hub(parentIter->second->vid, parentIter->second->pid);
+}
 
-    struct udev* udev = udev_new();
-    if (!udev) {
-        return std::unexpected("Failed to initialize udev");
+auto _findDiscoveryOwners(const DeviceTable& table, const DeviceIndex& index)
+    -> std::vector<const UsbNode*> {
+    std::vector<std::pair<uint64_t, const UsbNode*>> owners;
+    for (const auto& node: table.usbDevices) {
+        if (_isDiscoveryOwner(index, node)) {
+            owners.emplace_back(_generateUniqueIDFromUSBPortChain(node.portChain), &node);
+        }
+    }
+    std::stable_sort(owners.begin(), owners.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+    std::vector<const UsbNode*> sorted;
+    sorted.reserve(owners.size());
+    for (const auto& owner: owners) {
+        sorted.push_back(owner.second);
     }
+    return sorted;
+}
 
-    struct udev_enumerate* enumerate = udev_enumerate_new(udev);
-    udev_enumerate_add_match_subsystem(enumerate, "usb");
-    udev_enumerate_scan_devices(enumerate);
+auto _discoverOwner(const DeviceIndex& index, const UsbNode& owner, Fw::FindStats* stats)
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    Fw::USBDevices devices;
+    if (Fw::is_freewili_hub(owner.vid, owner.pid)) {
+        for (const UsbNode* child: _findUsbHubChildren(index, owner.syspath)) {
+            devices.push_back(
+                _createUSBDevice(index, *child, child->manufacturer + " " + child->product)
+            );
+        }
+        devices.push_back(_createUSBDevice(index, owner, owner.product));
+    } else {
+        devices.push_back(_createUSBDevice(
+            index,
+            owner,
+            owner.manufacturer.empty() ? owner.product : owner.manufacturer + " " + owner.product
+        ));
+    }
+    PhaseTimer buildTimer(stats, &Fw::FindStats::buildTime);
+    return Fw::FreeWiliDevice::fromUSBDevices(std::move(devices));
+}
 
-    struct udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate);
-    struct udev_list_entry* dev_list_entry;
-
-    USBDevices usbHubDevices;
-    udev_list_entry_foreach(dev_list_entry, devices) {
-        const char* path = udev_list_entry_get_name(dev_list_entry);
-        struct udev_device* dev = udev_device_new_from_syspath(udev, path);
-        std::string idVendor = get_device_property(dev, "idVendor");
-        std::string idProduct = get_device_property(dev, "idProduct");
-        std::string manufacturer = get_device_property(dev, "manufacturer");
-        std::string productName = get_device_property(dev, "product");
-        std::string serial = get_device_property(dev, "serial");
-        const char* _sysnum = udev_device_get_sysnum(dev);
-        std::string sysnum = _sysnum ? _sysnum : "";
-        uint16_t vid = string_to_int<uint16_t>(idVendor, 16).value_or(0);
-        uint16_t pid = string_to_int<uint16_t>(idProduct, 16).value_or(0);
-        uint32_t location = string_to_int<uint32_t>(sysnum, 10).value_or(0);
-        std::vector<uint32_t> portChain = usbPortChainFromUdevDevice(dev);
-        // Matches both the FREE-WILi and the FREE-WILi2 internal hubs
-        if (Fw::is_freewili_hub(vid, pid)) {
-            std::string hubSysPath = udev_device_get_syspath(dev);
-            auto hubDevice = USBDevice {
-                .kind = Fw::getUSBDeviceTypeFrom(vid, pid, location),
-                .vid = vid,
-                .pid = pid,
-                .name = productName,
-                .serial = serial,
-                .location = static_cast<uint8_t>(location),
-                .portChain = portChain,
-                .paths = std::nullopt,
-                .port = std::nullopt,
-                ._raw = hubSysPath,
-            };
-            auto usbChildren = findUsbHubChildren(udev, dev_list_entry, devices, hubDevice);
-            usbChildren.push_back(hubDevice);
-            if (auto fwDeviceResult = Fw::FreeWiliDevice::fromUSBDevices(usbChildren);
-                fwDeviceResult.has_value())
-            {
-                fwDevices.push_back(std::move(fwDeviceResult.value()));
-            } else {
-                std::cerr << fwDeviceResult.error();
+auto _mayMatchOwner(const DeviceIndex& index, const UsbNode& owner, const OwnerKey& key) -> bool {
+    if (key.uniqueID.has_value()
+        && _generateUniqueIDFromUSBPortChain(owner.portChain) != key.uniqueID.value())
+    {
+        return false;
+    }
+    if (key.serial.empty() || owner.serial == key.serial) {
+        return true;
+    }
+    if (Fw::is_freewili_hub(owner.vid, owner.pid)) {
+        // FREE-WILi2 falls back to a child serial, FREE-WILi only ever reports the FTDI one
+        for (const UsbNode* child: _findUsbHubChildren(index, owner.syspath)) {
+            if (child->serial == key.serial) {
+                return true;
             }
-        } else {
-            // Not a FreeWili Hub, lets see if its a whitelisted device
-            if (!Fw::is_vid_pid_whitelisted(vid, pid)) {
-                udev_device_unref(dev);
-                continue;
+        }
+        // A FREE-WILi without FTDI chip
+        return key.serial == "Unknown";
+    }
+    return false;
+}
+
+// Keep owners and the usb_devices below hubs, returns their positions in table.usbDevices
+static auto _keepOwners(
+    DeviceTable& table,
+    const DeviceIndex& index,
+    const std::vector<const UsbNode*>& owners
+) -> std::vector<size_t> {
+    std::unordered_set<const UsbNode*> keep(owners.begin(), owners.end());
+    for (const UsbNode* owner: owners) {
+        if (Fw::is_freewili_hub(owner->vid, owner->pid)) {
+            for (const UsbNode* child: _findUsbHubChildren(index, owner->syspath)) {
+                keep.insert(child);
             }
-            // We have a whitelisted device by itself that isn't behind a hub
-            //auto usbChildren = findUsbHubChildren(udev, dev_list_entry, devices, USBDevice);
         }
-        udev_device_unref(dev);
     }
-    udev_enumerate_unref(enumerate);
-    udev_unref(udev);
-    return fwDevices;
+    std::vector<size_t> positions;
+    positions.reserve(keep.size());
+    std::vector<UsbNode> usbDevices;
+    usbDevices.reserve(keep.size());
+    for (size_t i = 0; i < table.usbDevices.size(); ++i) {
+        if (keep.contains(&table.usbDevices[i])) {
+            positions.push_back(i);
+            usbDevices.push_back(std::move(table.usbDevices[i]));
+        }
+    }
+    table.usbDevices = std::move(usbDevices);
+    return positions;
 }
 
-auto Fw::find_all() noexcept -> std::expected<Fw::FreeWiliDevices, std::string> {
-    const auto disks = _listDisks();
-    const auto serialPorts = _listSerialPorts();
+auto _keepOwnersMatchingKey(DeviceTable& table, const OwnerKey& key) -> std::vector<size_t> {
+    const auto index = _buildDeviceIndex(table);
+    std::vector<const UsbNode*> owners;
+    for (const auto& node: table.usbDevices) {
+        if (!_isDiscoveryOwner(index, node) || !_mayMatchOwner(index, node, key)) {
+            continue;
+        }
+        owners.push_back(&node);
+        // No two owners share a port chain
+        if (key.uniqueID.has_value()) {
+            break;
+        }
+    }
+    return _keepOwners(table, index, owners);
+}
 
-    Fw::FreeWiliDevices devices;
-    if (auto result = _find_all_standalone(disks, serialPorts); result.has_value()) {
-        devices = std::move(result.value());
+auto _keepMatchingOwner(DeviceTable& table, const Fw::DevicePredicate& matches) -> void {
+    const auto index = _buildDeviceIndex(table);
+    std::vector<const UsbNode*> owners;
+    for (const UsbNode* owner: _findDiscoveryOwners(table, index)) {
+        if (auto device = _discoverOwner(index, *owner);
+            device.has_value() && matches(device.value()))
+        {
+            table.matchedOwner.emplace(std::move(device.value()));
+            owners.push_back(owner);
+            break;
+        }
     }
-    if (auto result = _find_all_freewili(disks, serialPorts); result.has_value()) {
-        devices.insert(devices.end(), result.value().begin(), result.value().end());
-    } else {
-        return std::unexpected(result.error());
+    _keepOwners(table, index, owners);
+}
+
+auto _attachPortsAndDisks(const DeviceIndex& index, Fw::FreeWiliDevice& device) -> void {
+    for (auto& usbDevice: device.usbDevices) {
+        auto node = index.nodesBySyspath.find(usbDevice._raw);
+        if (node == index.nodesBySyspath.end()) {
+            continue;
+        }
+        if (const DiskInfo* disk = _findDiskInfo(index, *node->second)) {
+            usbDevice.paths = disk->mountPoints;
+        }
+        if (const SerialInfo* serialPort = _findSerialInfo(index, *node->second)) {
+            usbDevice.port = serialPort->ttyName;
+        }
+    }
+}
+
+auto _find_all_standalone(
+    const DeviceTable& table,
+    const DeviceIndex& index,
+    Fw::FindStats* stats
+) noexcept -> Fw::FreeWiliDevices {
+    Fw::FreeWiliDevices fwDevices;
+    for (const auto& node: table.usbDevices) {
+        if (Fw::is_freewili_hub(node.vid, node.pid) || !_isDiscoveryOwner(index, node)) {
+            continue;
+        }
+        if (auto result = _discoverOwner(index, node, stats); result.has_value()) {
+            fwDevices.push_back(std::move(result.value()));
+        } else {
+            std::cerr << "Failed to create FreeWiliDevice: " << result.error() << std::endl;
+        }
+    }
+    return fwDevices;
+}
+
+auto _find_all_freewili(
+    const DeviceTable& table,
+    const DeviceIndex& index,
+    Fw::FindStats* stats
+) noexcept -> Fw::FreeWiliDevices {
+    Fw::FreeWiliDevices fwDevices;
+    for (const auto& node: table.usbDevices) {
+        if (!Fw::is_freewili_hub(node.vid, node.pid)) {
+            continue;
+        }
+        if (auto fwDeviceResult = _discoverOwner(index, node, stats); fwDeviceResult.has_value()) {
+            fwDevices.push_back(std::move(fwDeviceResult.value()));
+        } else {
+            std::cerr << fwDeviceResult.error();
+        }
     }
+    return fwDevices;
+}
+
+// Discovery is the same whichever backend captured the table
+static auto _find_all(const DeviceTable& table, Fw::FindStats* stats) noexcept
+    -> Fw::FreeWiliDevices {
+    // Building is timed on its own inside, whatever remains is resolving
+    const auto buildTime = stats ? stats->buildTime : std::chrono::nanoseconds {};
+    PhaseTimer resolveTimer(stats, &Fw::FindStats::resolveTime);
+    const auto index = _buildDeviceIndex(table);
+    Fw::FreeWiliDevices devices = _find_all_standalone(table, index, stats);
+    auto fwDevices = _find_all_freewili(table, index, stats);
+    devices.insert(
+        devices.end(),
+        std::make_move_iterator(fwDevices.begin()),
+        std::make_move_iterator(fwDevices.end())
+    );
     // Sort the devices by unique ID
     std::sort(
         devices.begin(),
@@ -564,7 +1353,189 @@ auto Fw::find_all() noexcept -> std::expected<Fw::FreeWiliDevices, std::string>
             return lhs.uniqueID < rhs.uniqueID;
         }
     );
+    if (stats) {
+        stats->resolveTime -= stats->buildTime - buildTime;
+    }
     return devices;
 }
 
+// Builds owners one at a time in find_all() order and stops at the first one predicate accepts
+static auto _find_first(
+    const DeviceTable& table,
+    const Fw::DevicePredicate& predicate,
+    Fw::FindStats* stats
+) noexcept -> std::optional<Fw::FreeWiliDevice> {
+    const auto buildTime = stats ? stats->buildTime : std::chrono::nanoseconds {};
+    PhaseTimer resolveTimer(stats, &Fw::FindStats::resolveTime);
+    const auto index = _buildDeviceIndex(table);
+    std::optional<Fw::FreeWiliDevice> found;
+    for (const UsbNode* owner: _findDiscoveryOwners(table, index)) {
+        if (auto device = _discoverOwner(index, *owner, stats);
+            device.has_value() && predicate(device.value()))
+        {
+            found.emplace(std::move(device.value()));
+            break;
+        }
+    }
+    if (stats) {
+        stats->resolveTime -= stats->buildTime - buildTime;
+    }
+    return found;
+}
+
+// One enumeration pass feeds both the standalone and hub discovery
+static auto _scan(const Fw::FindOptions& options, const ScanScope& scope = {}) noexcept
+    -> std::expected<DeviceTable, std::string> {
+    return options.backend == Fw::FindBackend::Sysfs || !options.root.empty()
+        ? _scanSysfsDeviceTable(options.root, options.stats, scope, options.threads, options.stop)
+        : _scanDeviceTable(options.stats, scope, options.stop);
+}
+
+// Targeted lookups. With an ownerKey, predicate only looks at the usb_devices: key and
+// predicate narrow the scan down before serial ports and disks are read, and the device the
+// scan built to test is the result.
+static auto _lookup(
+    const Fw::FindOptions& options,
+    const Fw::DevicePredicate& predicate,
+    std::optional<OwnerKey> ownerKey,
+    const std::string& notFound
+) noexcept -> std::expected<Fw::FreeWiliDevice, std::string> {
+    Fw::FindStats* stats = options.stats;
+    if (stats) {
+        *stats = Fw::FindStats {};
+    }
+    PhaseTimer totalTimer(stats, &Fw::FindStats::totalTime);
+    if (options.stop.stop_requested()) {
+        return std::unexpected(_cancelled);
+    }
+    const bool keyed = ownerKey.has_value();
+    auto table = keyed
+        ? _scan(options, { .ownerFilter = predicate, .ownerKey = *ownerKey, .subtree = {} })
+        : _scan(options);
+    if (!table.has_value()) {
+        return std::unexpected(table.error());
+    }
+    std::optional<Fw::FreeWiliDevice> device;
+    if (keyed) {
+        if (table->matchedOwner.has_value()) {
+            PhaseTimer resolveTimer(stats, &Fw::FindStats::resolveTime);
+            device = std::move(table->matchedOwner);
+            _attachPortsAndDisks(_buildDeviceIndex(table.value()), device.value());
+        }
+    } else {
+        device = _find_first(table.value(), predicate, stats);
+    }
+    if (stats) {
+        stats->usbDevicesMatched = table->usbDevices.size();
+        stats->devicesFound = device.has_value() ? 1 : 0;
+    }
+    if (!device.has_value()) {
+        return std::unexpected(notFound);
+    }
+    return std::move(device.value());
+}
+
+auto Fw::find_all() noexcept -> std::expected<Fw::FreeWiliDevices, std::string> {
+    return Fw::find_all(Fw::FindOptions {});
+}
+
+auto Fw::find_all(const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevices, std::string> {
+    Fw::FindStats* stats = options.stats;
+    if (stats) {
+        *stats = Fw::FindStats {};
+    }
+    PhaseTimer totalTimer(stats, &Fw::FindStats::totalTime);
+    if (options.stop.stop_requested()) {
+        return std::unexpected(_cancelled);
+    }
+    auto table = _scan(options);
+    if (!table.has_value()) {
+        return std::unexpected(table.error());
+    }
+    auto devices = _find_all(table.value(), stats);
+    if (stats) {
+        stats->usbDevicesMatched = table->usbDevices.size();
+        stats->devicesFound = devices.size();
+    }
+    return devices;
+}
+
+auto Fw::find_first(const Fw::DevicePredicate& predicate, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return _lookup(options, predicate, std::nullopt, "No FreeWili device matched");
+}
+
+auto Fw::find_by_serial(const std::string& serial, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    // The serial is known from the usb_devices alone, the filter settles it before the scan
+    // reads any serial port or disk
+    const auto matches = [&serial](const Fw::FreeWiliDevice& device) {
+        return device.serial == serial;
+    };
+    return _lookup(
+        options,
+        matches,
+        OwnerKey { .serial = serial, .uniqueID = std::nullopt },
+        "No FreeWili device with serial " + serial
+    );
+}
+
+auto Fw::find_by_unique_id(uint64_t uniqueID, const Fw::FindOptions& options) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    const auto matches = [uniqueID](const Fw::FreeWiliDevice& device) {
+        return device.uniqueID == uniqueID;
+    };
+    return _lookup(
+        options,
+        matches,
+        OwnerKey { .serial = {}, .uniqueID = uniqueID },
+        "No FreeWili device with unique ID " + std::to_string(uniqueID)
+    );
+}
+
+auto Fw::refresh(Fw::FreeWiliDevice& device, const Fw::FindOptions& options) noexcept
+    -> std::expected<void, std::string> {
+    // Standalone devices are their own subtree
+    std::string owner;
+    if (device.standalone) {
+        owner = device.usbDevices.empty() ? "" : device.usbDevices.front()._raw;
+    } else if (auto hub = device.getHubUSBDevice(); hub.has_value()) {
+        owner = hub->_raw;
+    }
+    if (owner.empty()) {
+        return std::unexpected("No syspath to refresh " + device.name + " from");
+    }
+
+    Fw::FindStats* stats = options.stats;
+    if (stats) {
+        *stats = Fw::FindStats {};
+    }
+    PhaseTimer totalTimer(stats, &Fw::FindStats::totalTime);
+    auto table = _scan(options, { .ownerFilter = {}, .ownerKey = {}, .subtree = owner });
+    if (!table.has_value()) {
+        return std::unexpected(table.error());
+    }
+    std::optional<PhaseTimer> resolveTimer(std::in_place, stats, &Fw::FindStats::resolveTime);
+    const auto index = _buildDeviceIndex(table.value());
+    auto node = index.nodesBySyspath.find(owner);
+    // Something else may have been plugged into the same port in the meantime
+    if (node == index.nodesBySyspath.end() || !_isDiscoveryOwner(index, *node->second)) {
+        return std::unexpected(device.name + " is no longer connected at " + owner);
+    }
+    auto refreshed = _discoverOwner(index, *node->second, stats);
+    resolveTimer.reset();
+    if (stats) {
+        // Building is timed on its own inside, whatever remains is resolving
+        stats->resolveTime -= stats->buildTime;
+        stats->usbDevicesMatched = table->usbDevices.size();
+        stats->devicesFound = refreshed.has_value() ? 1 : 0;
+    }
+    if (!refreshed.has_value()) {
+        return std::unexpected(refreshed.error());
+    }
+    device = std::move(refreshed.value());
+    return {};
+}
+
 #endif // __linux__
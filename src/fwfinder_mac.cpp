@@ -596,8 +596,10 @@ static auto _find_all_fw_hub_based() noexcept -> std::expected<Fw::FreeWiliDevic
     // Convert hub groups to FreeWiliDevices
     Fw::FreeWiliDevices fwDevices;
     for (auto&& devices: hubGroups) {
-        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(devices); result.has_value()) {
-            fwDevices.push_back(result.value());
+        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(std::move(devices));
+            result.has_value())
+        {
+            fwDevices.push_back(std::move(result.value()));
         }
     }
 
@@ -708,8 +710,10 @@ auto _find_all_standalone() noexcept -> std::expected<Fw::FreeWiliDevices, std::
     // Create FreeWiliDevice instances for each standalone device found
     Fw::FreeWiliDevices fwDevices;
     for (auto&& [deviceKey, devices]: standaloneDevices) {
-        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(devices); result.has_value()) {
-            fwDevices.push_back(result.value());
+        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(std::move(devices));
+            result.has_value())
+        {
+            fwDevices.push_back(std::move(result.value()));
         }
     }
 
@@ -1276,7 +1276,9 @@ auto _find_all_freewili() noexcept -> std::expected<Fw::FreeWiliDevices, std::st
             });
         }
         // Create FreeWili device from USB devices with UniqueID
-        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(devices); result.has_value()) {
+        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(std::move(devices));
+            result.has_value())
+        {
             auto fwDevice = std::move(result.value());
             fwDevices.push_back(std::move(fwDevice));
         } else {
@@ -1350,8 +1352,10 @@ auto _find_all_standalone() noexcept -> std::expected<Fw::FreeWiliDevices, std::
             .port = device.second->port,
             ._raw = device.second->instanceId,
         });
-        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(devices); result.has_value()) {
-            fwDevices.push_back(result.value());
+        if (auto result = Fw::FreeWiliDevice::fromUSBDevices(std::move(devices));
+            result.has_value())
+        {
+            fwDevices.push_back(std::move(result.value()));
         } else {
             return std::unexpected(result.error());
         }
@@ -0,0 +1,68 @@
+#include <fwwatcher.hpp>
+
+#include <chrono>
+#include <expected>
+#include <memory>
+#include <string>
+
+auto Fw::getDeviceEventTypeName(Fw::DeviceEventType type) -> std::string {
+    switch (type) {
+        case Fw::DeviceEventType::Added:
+            return "Added";
+        case Fw::DeviceEventType::Removed:
+            return "Removed";
+        case Fw::DeviceEventType::Changed:
+            return "Changed";
+        default:
+            return "Unknown";
+    }
+}
+
+#if !defined(__linux__)
+
+// Hotplug notifications are only implemented on top of udev for now
+struct Fw::DeviceWatcher::Impl {};
+
+auto Fw::DeviceWatcher::create() noexcept -> std::expected<Fw::DeviceWatcher, std::string> {
+    return std::unexpected("DeviceWatcher is not supported on this platform");
+}
+
+Fw::DeviceWatcher::DeviceWatcher(std::unique_ptr<Impl> impl) noexcept: impl(std::move(impl)) {}
+
+Fw::DeviceWatcher::DeviceWatcher(DeviceWatcher&& other) noexcept = default;
+
+Fw::DeviceWatcher& Fw::DeviceWatcher::operator=(DeviceWatcher&& other) noexcept = default;
+
+Fw::DeviceWatcher::~DeviceWatcher() = default;
+
+auto Fw::DeviceWatcher::fd() const noexcept -> int {
+    return -1;
+}
+
+auto Fw::DeviceWatcher::poll() noexcept -> std::expected<Fw::DeviceEvents, std::string> {
+    return std::unexpected("DeviceWatcher is not supported on this platform");
+}
+
+auto Fw::DeviceWatcher::devices() const noexcept -> Fw::FreeWiliDevices {
+    return {};
+}
+
+auto Fw::DeviceWatcher::wait_for(const Fw::DevicePredicate&, std::chrono::milliseconds) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return std::unexpected("DeviceWatcher is not supported on this platform");
+}
+
+auto Fw::wait_for(const Fw::DevicePredicate&, std::chrono::milliseconds) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return std::unexpected("DeviceWatcher is not supported on this platform");
+}
+
+auto Fw::wait_for_mount(
+    const Fw::FreeWiliDevice& device,
+    std::chrono::milliseconds,
+    const Fw::FindOptions&
+) noexcept -> std::expected<Fw::FreeWiliDevice, std::string> {
+    return std::unexpected(device.name + " was not mounted: not supported on this platform");
+}
+
+#endif // !__linux__
@@ -0,0 +1,629 @@
+#ifdef __linux__
+
+    #include <fwfinder.hpp>
+    #include <fwfinder_linux.hpp>
+    #include <fwwatcher.hpp>
+    #include <usbdef.hpp>
+
+    #include <fcntl.h>
+    #include <libudev.h>
+    #include <poll.h>
+    #include <sys/epoll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+
+    #include <expected>
+    #include <string>
+    #include <algorithm>
+    #include <array>
+    #include <cerrno>
+    #include <chrono>
+    #include <cstring>
+    #include <memory>
+    #include <optional>
+    #include <set>
+    #include <variant>
+
+// Every field the watcher reports on, FreeWiliDevice::operator== only compares uniqueID
+static auto _isSameDevice(const Fw::FreeWiliDevice& lhs, const Fw::FreeWiliDevice& rhs) -> bool {
+    return lhs.deviceType == rhs.deviceType && lhs.name == rhs.name && lhs.serial == rhs.serial
+        && lhs.standalone == rhs.standalone && lhs.usbDevices == rhs.usbDevices;
+}
+
+auto DeviceTopology::_ownerOf(const std::string& usbSyspath) const -> std::optional<std::string> {
+    auto it = nodes.find(usbSyspath);
+    if (it == nodes.end()) {
+        return std::nullopt;
+    }
+    // The nearest FreeWili hub owns everything below it, standalone devices included
+    const UsbNode* current = &it->second;
+    while (current) {
+        if (Fw::is_freewili_hub(current->vid, current->pid)) {
+            return current->syspath;
+        }
+        auto parentIter = nodes.find(current->parentSyspath);
+        current = parentIter == nodes.end() ? nullptr : &parentIter->second;
+    }
+    if (Fw::isStandAloneDevice(it->second.vid, it->second.pid)) {
+        return it->second.syspath;
+    }
+    return std::nullopt;
+}
+
+auto DeviceTopology::_markDirty(const std::string& usbSyspath) -> void {
+    if (auto owner = _ownerOf(usbSyspath); owner.has_value()) {
+        dirtyOwners.insert(std::move(owner.value()));
+    }
+    if (ownerDevices.contains(usbSyspath)) {
+        dirtyOwners.insert(usbSyspath);
+    }
+    // Owners below the node change hands when a hub comes or goes
+    const auto prefix = usbSyspath + "/";
+    for (auto it = ownerDevices.lower_bound(prefix);
+         it != ownerDevices.end() && it->first.starts_with(prefix);
+         ++it)
+    {
+        dirtyOwners.insert(it->first);
+    }
+}
+
+auto DeviceTopology::_refreshDisk(const std::string& diskSyspath) -> void {
+    auto it = disks.find(diskSyspath);
+    if (it == disks.end()) {
+        return;
+    }
+    auto& disk = it->second;
+    // Keep the disk itself, partitions are re-attached in syspath order
+    disk.blockDevices.erase(
+        disk.blockDevices.begin() + std::min<std::ptrdiff_t>(1, std::ssize(disk.blockDevices)),
+        disk.blockDevices.end()
+    );
+    for (const auto& [syspath, partition]: partitions) {
+        if (partition.diskSyspath == diskSyspath) {
+            disk.blockDevices.push_back(partition.blockDevice);
+        }
+    }
+    disk.mountPoints = _findMountPoints(mounts, disk);
+    _markDirty(disk.devPath);
+}
+
+auto DeviceTopology::apply(const TopologyEvent& event) -> void {
+    if (event.action == TopologyAction::Remove) {
+        if (auto it = nodes.find(event.syspath); it != nodes.end()) {
+            _markDirty(event.syspath);
+            nodes.erase(it);
+        } else if (auto it = serialPorts.find(event.syspath); it != serialPorts.end()) {
+            _markDirty(it->second.devPath);
+            serialPorts.erase(it);
+        } else if (auto it = disks.find(event.syspath); it != disks.end()) {
+            _markDirty(it->second.devPath);
+            disks.erase(it);
+        } else if (auto it = partitions.find(event.syspath); it != partitions.end()) {
+            auto diskSyspath = it->second.diskSyspath;
+            partitions.erase(it);
+            _refreshDisk(diskSyspath);
+        }
+        return;
+    }
+
+    pendingAdditions = true;
+    if (const auto* node = std::get_if<UsbNode>(&event.device)) {
+        // A change can turn the node into or out of an owner, mark both sides
+        _markDirty(event.syspath);
+        nodes.insert_or_assign(event.syspath, *node);
+        _markDirty(event.syspath);
+    } else if (const auto* serialPort = std::get_if<SerialInfo>(&event.device)) {
+        if (auto it = serialPorts.find(event.syspath); it != serialPorts.end()) {
+            _markDirty(it->second.devPath);
+        }
+        serialPorts.insert_or_assign(event.syspath, *serialPort);
+        _markDirty(serialPort->devPath);
+    } else if (const auto* disk = std::get_if<DiskInfo>(&event.device)) {
+        if (auto it = disks.find(event.syspath); it != disks.end()) {
+            _markDirty(it->second.devPath);
+        }
+        disks.insert_or_assign(event.syspath, *disk);
+        _refreshDisk(event.syspath);
+    } else if (const auto* partition = std::get_if<PartitionInfo>(&event.device)) {
+        partitions.insert_or_assign(event.syspath, *partition);
+        _refreshDisk(partition->diskSyspath);
+    }
+}
+
+auto DeviceTopology::replay(const std::vector<TopologyEvent>& events) -> Fw::DeviceEvents {
+    Fw::DeviceEvents deviceEvents;
+    auto append = [&](Fw::DeviceEvents flushed) {
+        deviceEvents.insert(
+            deviceEvents.end(),
+            std::make_move_iterator(flushed.begin()),
+            std::make_move_iterator(flushed.end())
+        );
+    };
+    for (const auto& event: events) {
+        if (event.action == TopologyAction::Remove && pendingAdditions) {
+            append(flush());
+        }
+        apply(event);
+    }
+    append(flush());
+    return deviceEvents;
+}
+
+auto DeviceTopology::updateMounts(MountTable mountTable) -> void {
+    mounts = std::move(mountTable);
+    for (auto& [syspath, disk]: disks) {
+        if (auto mountPoints = _findMountPoints(mounts, disk); mountPoints != disk.mountPoints) {
+            disk.mountPoints = std::move(mountPoints);
+            _markDirty(disk.devPath);
+        }
+    }
+}
+
+auto DeviceTopology::_discover(const std::string& owner) const -> Fw::FreeWiliDevices {
+    auto ownerIter = nodes.find(owner);
+    if (ownerIter == nodes.end() || _ownerOf(owner) != owner) {
+        return {};
+    }
+    // Children, their ttys and their disks all live below the owner's syspath
+    const auto prefix = owner + "/";
+    DeviceTable table;
+    table.usbDevices.push_back(ownerIter->second);
+    for (auto it = nodes.lower_bound(prefix); it != nodes.end() && it->first.starts_with(prefix);
+         ++it)
+    {
+        table.usbDevices.push_back(it->second);
+    }
+    for (auto it = serialPorts.lower_bound(prefix);
+         it != serialPorts.end() && it->first.starts_with(prefix);
+         ++it)
+    {
+        table.serialPorts.push_back(it->second);
+    }
+    for (auto it = disks.lower_bound(prefix); it != disks.end() && it->first.starts_with(prefix);
+         ++it)
+    {
+        table.disks.push_back(it->second);
+    }
+
+    const auto index = _buildDeviceIndex(table);
+    auto devices = _find_all_standalone(table, index);
+    auto fwDevices = _find_all_freewili(table, index);
+    devices.insert(
+        devices.end(),
+        std::make_move_iterator(fwDevices.begin()),
+        std::make_move_iterator(fwDevices.end())
+    );
+    return devices;
+}
+
+auto DeviceTopology::flush() -> Fw::DeviceEvents {
+    pendingAdditions = false;
+    Fw::DeviceEvents events;
+    if (dirtyOwners.empty()) {
+        return events;
+    }
+
+    // Take back what the dirty owners reported last time, then rediscover them
+    std::map<uint64_t, Fw::FreeWiliDevice> previous;
+    for (const auto& owner: dirtyOwners) {
+        if (auto it = ownerDevices.find(owner); it != ownerDevices.end()) {
+            for (auto uniqueID: it->second) {
+                if (auto node = devicesById.extract(uniqueID); !node.empty()) {
+                    previous.insert(std::move(node));
+                }
+            }
+            ownerDevices.erase(it);
+        }
+    }
+    std::set<uint64_t> current;
+    for (const auto& owner: dirtyOwners) {
+        std::vector<uint64_t> uniqueIDs;
+        for (auto& device: _discover(owner)) {
+            auto uniqueID = device.uniqueID;
+            uniqueIDs.push_back(uniqueID);
+            current.insert(uniqueID);
+            devicesById.erase(uniqueID);
+            devicesById.emplace(uniqueID, std::move(device));
+        }
+        if (!uniqueIDs.empty()) {
+            ownerDevices.emplace(owner, std::move(uniqueIDs));
+        }
+    }
+    dirtyOwners.clear();
+
+    std::set<uint64_t> uniqueIDs = current;
+    for (const auto& [uniqueID, device]: previous) {
+        uniqueIDs.insert(uniqueID);
+    }
+    for (auto uniqueID: uniqueIDs) {
+        auto previousIter = previous.find(uniqueID);
+        if (!current.contains(uniqueID)) {
+            events.push_back({ Fw::DeviceEventType::Removed, std::move(previousIter->second) });
+        } else if (previousIter == previous.end()) {
+            events.push_back({ Fw::DeviceEventType::Added, devicesById.at(uniqueID) });
+        } else if (const auto& device = devicesById.at(uniqueID);
+                   !_isSameDevice(previousIter->second, device))
+        {
+            events.push_back({ Fw::DeviceEventType::Changed, device });
+        }
+    }
+    return events;
+}
+
+auto DeviceTopology::devices() const -> Fw::FreeWiliDevices {
+    Fw::FreeWiliDevices devices;
+    devices.reserve(devicesById.size());
+    for (const auto& [uniqueID, device]: devicesById) {
+        devices.push_back(device);
+    }
+    return devices;
+}
+
+struct Fw::DeviceWatcher::Impl {
+    struct udev* udev = nullptr;
+    struct udev_monitor* monitor = nullptr;
+    /// /proc/self/mountinfo raises POLLPRI once per mount table change and per open file, the
+    /// copy in the epoll set is used up by whoever waits on fd(), poll() checks this one
+    int mountInfoFd = -1;
+    int mountWakeUpFd = -1;
+    /// What fd() returns, the monitor socket and mountWakeUpFd
+    int epollFd = -1;
+    DeviceTopology topology;
+
+    Impl() = default;
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    ~Impl() {
+        for (int fd: { epollFd, mountWakeUpFd, mountInfoFd }) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        if (monitor) {
+            udev_monitor_unref(monitor);
+        }
+        if (udev) {
+            udev_unref(udev);
+        }
+    }
+};
+
+// Mount points only need to be re-read when a disk or partition is involved
+static auto _hasBlockEvents(const std::vector<TopologyEvent>& events) -> bool {
+    return std::any_of(events.begin(), events.end(), [](const TopologyEvent& event) {
+        return std::holds_alternative<DiskInfo>(event.device)
+            || std::holds_alternative<PartitionInfo>(event.device);
+    });
+}
+
+// Consumes the pending notification, the next call only reports later changes
+static auto _mountTableChanged(int mountInfoFd) -> bool {
+    pollfd pfd { .fd = mountInfoFd, .events = POLLPRI, .revents = 0 };
+    return mountInfoFd >= 0 && ::poll(&pfd, 1, 0) > 0;
+}
+
+// The monitor socket is non-blocking, this drains whatever is queued
+static auto _receiveTopologyEvents(struct udev_monitor* monitor) -> std::vector<TopologyEvent> {
+    std::vector<TopologyEvent> events;
+    while (struct udev_device* dev = udev_monitor_receive_device(monitor)) {
+        const char* _action = udev_device_get_action(dev);
+        std::string_view action = _action ? _action : "";
+        // bind, unbind and move don't change what discovery sees
+        std::optional<TopologyAction> topologyAction;
+        if (action == "add") {
+            topologyAction = TopologyAction::Add;
+        } else if (action == "change") {
+            topologyAction = TopologyAction::Change;
+        } else if (action == "remove") {
+            topologyAction = TopologyAction::Remove;
+        }
+        if (topologyAction.has_value()) {
+            if (auto event = _topologyEventFromUdev(dev, topologyAction.value());
+                event.has_value())
+            {
+                events.push_back(std::move(event.value()));
+            }
+        }
+        udev_device_unref(dev);
+    }
+    return events;
+}
+
+auto _waitForDevice(
+    DeviceTopology& topology,
+    const TopologyWaitSources& sources,
+    const Fw::DevicePredicate& predicate,
+    std::chrono::steady_clock::time_point deadline
+) -> std::expected<Fw::FreeWiliDevice, std::string> {
+    for (auto& device: topology.devices()) {
+        if (predicate(device)) {
+            return std::move(device);
+        }
+    }
+    for (;;) {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()
+        );
+        if (remaining.count() <= 0) {
+            return std::unexpected("Timed out waiting for a FreeWili device");
+        }
+        std::array<pollfd, 2> fds {
+            pollfd { .fd = sources.eventFd, .events = POLLIN, .revents = 0 },
+            pollfd { .fd = sources.mountInfoFd, .events = POLLPRI, .revents = 0 },
+        };
+        // Negative descriptors are ignored by poll()
+        auto ready = ::poll(fds.data(), fds.size(), static_cast<int>(remaining.count()));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0) {
+            return std::unexpected(
+                std::string("Failed to wait for devices: ") + std::strerror(errno)
+            );
+        }
+        if (ready == 0) {
+            continue;
+        }
+        std::vector<TopologyEvent> events;
+        if (fds[0].revents != 0 && sources.drain) {
+            events = sources.drain();
+        }
+        if ((fds[1].revents != 0 || _hasBlockEvents(events)) && sources.readMounts) {
+            topology.updateMounts(sources.readMounts());
+        }
+        for (auto& event: topology.replay(events)) {
+            if (event.type != Fw::DeviceEventType::Removed && predicate(event.device)) {
+                return std::move(event.device);
+            }
+        }
+    }
+}
+
+// Listens for the usb_devices, ttys and block devices discovery is made of
+static auto _openUdevMonitor(struct udev* udev) -> std::expected<udev_monitor*, std::string> {
+    struct udev_monitor* monitor = udev_monitor_new_from_netlink(udev, "udev");
+    if (!monitor) {
+        return std::unexpected("Failed to create udev monitor");
+    }
+    udev_monitor_filter_add_match_subsystem_devtype(monitor, "usb", "usb_device");
+    udev_monitor_filter_add_match_subsystem_devtype(monitor, "tty", nullptr);
+    udev_monitor_filter_add_match_subsystem_devtype(monitor, "block", nullptr);
+    if (udev_monitor_enable_receiving(monitor) < 0) {
+        udev_monitor_unref(monitor);
+        return std::unexpected("Failed to enable udev monitor");
+    }
+    return monitor;
+}
+
+// Devices already attached are the starting point of topology, not events. Enumerated once the
+// monitor is listening so nothing plugged in between is missed, devices seen by both are just
+// applied twice.
+static auto _seedTopology(struct udev* udev, DeviceTopology& topology) -> void {
+    std::vector<TopologyEvent> events;
+    _enumerateUdevDevices(udev, [&](udev_device* dev) {
+        if (auto event = _topologyEventFromUdev(dev, TopologyAction::Add); event.has_value()) {
+            events.push_back(std::move(event.value()));
+        }
+    });
+    if (_hasBlockEvents(events)) {
+        topology.updateMounts(_readMountTable("/proc/self/mountinfo", "/proc/mounts"));
+    }
+    topology.replay(events);
+}
+
+auto Fw::DeviceWatcher::create() noexcept -> std::expected<Fw::DeviceWatcher, std::string> {
+    auto impl = std::make_unique<Impl>();
+    impl->udev = udev_new();
+    if (!impl->udev) {
+        return std::unexpected("Failed to initialize udev");
+    }
+    auto monitor = _openUdevMonitor(impl->udev);
+    if (!monitor.has_value()) {
+        return std::unexpected(monitor.error());
+    }
+    impl->monitor = monitor.value();
+
+    impl->epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (impl->epollFd < 0) {
+        return std::unexpected(std::string("Failed to create epoll set: ") + std::strerror(errno));
+    }
+    const int monitorFd = udev_monitor_get_fd(impl->monitor);
+    epoll_event monitorEvent { .events = EPOLLIN, .data = {} };
+    if (::epoll_ctl(impl->epollFd, EPOLL_CTL_ADD, monitorFd, &monitorEvent) < 0) {
+        return std::unexpected(
+            std::string("Failed to watch udev monitor: ") + std::strerror(errno)
+        );
+    }
+    // Without /proc mounts are still re-read on block events, just not on their own
+    impl->mountInfoFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    impl->mountWakeUpFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    epoll_event mountEvent { .events = EPOLLPRI, .data = {} };
+    if (impl->mountInfoFd >= 0 && impl->mountWakeUpFd >= 0) {
+        ::epoll_ctl(impl->epollFd, EPOLL_CTL_ADD, impl->mountWakeUpFd, &mountEvent);
+    }
+
+    _seedTopology(impl->udev, impl->topology);
+    return DeviceWatcher(std::move(impl));
+}
+
+Fw::DeviceWatcher::DeviceWatcher(std::unique_ptr<Impl> impl) noexcept: impl(std::move(impl)) {}
+
+Fw::DeviceWatcher::DeviceWatcher(DeviceWatcher&& other) noexcept = default;
+
+Fw::DeviceWatcher& Fw::DeviceWatcher::operator=(DeviceWatcher&& other) noexcept = default;
+
+Fw::DeviceWatcher::~DeviceWatcher() = default;
+
+auto Fw::DeviceWatcher::fd() const noexcept -> int {
+    return impl ? impl->epollFd : -1;
+}
+
+auto Fw::DeviceWatcher::poll() noexcept -> std::expected<Fw::DeviceEvents, std::string> {
+    if (!impl) {
+        return std::unexpected("DeviceWatcher has been moved from");
+    }
+    // Level triggered, collecting the ready list is enough to stop fd() from reporting what
+    // is handled below
+    std::array<epoll_event, 2> ready {};
+    ::epoll_wait(impl->epollFd, ready.data(), ready.size(), 0);
+    const bool mountsChanged = _mountTableChanged(impl->mountInfoFd);
+    auto events = _receiveTopologyEvents(impl->monitor);
+    if (mountsChanged || _hasBlockEvents(events)) {
+        impl->topology.updateMounts(_readMountTable("/proc/self/mountinfo", "/proc/mounts"));
+    }
+    return impl->topology.replay(events);
+}
+
+auto Fw::DeviceWatcher::wait_for(
+    const Fw::DevicePredicate& predicate,
+    std::chrono::milliseconds timeout
+) noexcept -> std::expected<Fw::FreeWiliDevice, std::string> {
+    if (!impl) {
+        return std::unexpected("DeviceWatcher has been moved from");
+    }
+    return _waitForDevice(
+        impl->topology,
+        TopologyWaitSources {
+            .eventFd = udev_monitor_get_fd(impl->monitor),
+            .mountInfoFd = impl->mountInfoFd,
+            .drain = [&] { return _receiveTopologyEvents(impl->monitor); },
+            .readMounts = [] { return _readMountTable("/proc/self/mountinfo", "/proc/mounts"); },
+        },
+        predicate,
+        std::chrono::steady_clock::now() + timeout
+    );
+}
+
+auto Fw::wait_for(const Fw::DevicePredicate& predicate, std::chrono::milliseconds timeout) noexcept
+    -> std::expected<Fw::FreeWiliDevice, std::string> {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    struct udev* udev = udev_new();
+    if (!udev) {
+        return std::unexpected("Failed to initialize udev");
+    }
+    auto monitor = _openUdevMonitor(udev);
+    if (!monitor.has_value()) {
+        udev_unref(udev);
+        return std::unexpected(monitor.error());
+    }
+    // Both listen before the host is enumerated, whatever the enumeration misses wakes the wait
+    const int mountInfoFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    // Seeded with the attached devices, a child plugged in under a hub that was already there
+    // is attributed to it the way find_all() does
+    DeviceTopology topology;
+    _seedTopology(udev, topology);
+    auto device = _waitForDevice(
+        topology,
+        TopologyWaitSources {
+            .eventFd = udev_monitor_get_fd(monitor.value()),
+            .mountInfoFd = mountInfoFd,
+            .drain = [&] { return _receiveTopologyEvents(monitor.value()); },
+            .readMounts = [] { return _readMountTable("/proc/self/mountinfo", "/proc/mounts"); },
+        },
+        predicate,
+        deadline
+    );
+    if (mountInfoFd >= 0) {
+        ::close(mountInfoFd);
+    }
+    udev_monitor_unref(monitor.value());
+    udev_unref(udev);
+    return device;
+}
+
+auto Fw::wait_for_mount(
+    const Fw::FreeWiliDevice& device,
+    std::chrono::milliseconds timeout,
+    const Fw::FindOptions& options
+) noexcept -> std::expected<Fw::FreeWiliDevice, std::string> {
+    if (device.getUSBDevices(Fw::USBDeviceType::MassStorage).empty()) {
+        return std::unexpected(device.name + " has no mass storage");
+    }
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    // The live mount table raises POLLPRI when it changes. A captured tree is a plain file
+    // that its writer replaces, watched through inotify, and no udev event concerns it.
+    struct udev* udev = nullptr;
+    struct udev_monitor* monitor = nullptr;
+    int mountFd = -1;
+    short mountEvents = POLLPRI;
+    if (options.root.empty()) {
+        // Without a monitor, a disk showing up late is only seen once it is mounted
+        udev = udev_new();
+        if (udev) {
+            monitor = _openUdevMonitor(udev).value_or(nullptr);
+        }
+        mountFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    } else {
+        mountFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        mountEvents = POLLIN;
+        for (const auto* directory: { "/proc", "/proc/self" }) {
+            ::inotify_add_watch(
+                mountFd,
+                (options.root + directory).c_str(),
+                IN_CLOSE_WRITE | IN_MOVED_TO
+            );
+        }
+    }
+    auto release = [&] {
+        if (mountFd >= 0) {
+            ::close(mountFd);
+        }
+        if (monitor) {
+            udev_monitor_unref(monitor);
+        }
+        if (udev) {
+            udev_unref(udev);
+        }
+    };
+
+    for (;;) {
+        // Listening already, a mount while refreshing still wakes the next poll() up
+        auto refreshed = device;
+        if (Fw::refresh(refreshed, options).has_value()
+            && !refreshed.getMassStoragePaths().empty())
+        {
+            release();
+            return refreshed;
+        }
+        std::array<pollfd, 2> fds {
+            pollfd { .fd = monitor ? udev_monitor_get_fd(monitor) : -1,
+                     .events = POLLIN,
+                     .revents = 0 },
+            pollfd { .fd = mountFd, .events = mountEvents, .revents = 0 },
+        };
+        int ready = 0;
+        do {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()
+            );
+            if (remaining.count() <= 0) {
+                release();
+                return std::unexpected(device.name + " was not mounted: timed out");
+            }
+            // Negative descriptors are ignored by poll()
+            ready = ::poll(fds.data(), fds.size(), static_cast<int>(remaining.count()));
+        } while (ready == 0 || (ready < 0 && errno == EINTR));
+        if (ready < 0) {
+            auto error = std::string(std::strerror(errno));
+            release();
+            return std::unexpected(device.name + " was not mounted: " + error);
+        }
+        // The refresh reads the device itself, what the notifications were about doesn't matter
+        if (fds[0].revents != 0) {
+            while (struct udev_device* dev = udev_monitor_receive_device(monitor)) {
+                udev_device_unref(dev);
+            }
+        }
+        if (fds[1].revents != 0 && !options.root.empty()) {
+            std::array<char, 4096> buffer;
+            while (::read(mountFd, buffer.data(), buffer.size()) > 0) {}
+        }
+    }
+}
+
+auto Fw::DeviceWatcher::devices() const noexcept -> Fw::FreeWiliDevices {
+    return impl ? impl->topology.devices() : Fw::FreeWiliDevices {};
+}
+
+#endif // __linux__
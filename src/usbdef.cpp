@@ -2,17 +2,36 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <iterator>
 
-auto Fw::is_vid_pid_whitelisted(uint16_t vid, uint16_t pid) -> bool {
-    //auto values = Fw::WhitelistVIDPID;
-    if (auto vidIter = Fw::WhitelistVIDPID.find(vid); vidIter != Fw::WhitelistVIDPID.end()) {
-        auto pids = vidIter->second;
-        return std::find(pids.begin(), pids.end(), pid) != pids.end();
+// A sparse hash keeps the compile time multiplier search short
+static_assert(std::size(Fw::KnownUSBDevices) < Fw::USBDescriptorHash.slots.size() / 2);
+// Hubs are classified as such and never standalone
+static_assert(std::all_of(
+    std::begin(Fw::KnownUSBDevices),
+    std::end(Fw::KnownUSBDevices),
+    [](const Fw::USBDeviceDescriptor& descriptor) {
+        return descriptor.hub == (descriptor.kind == Fw::USBDeviceType::Hub)
+            && !(descriptor.hub && descriptor.standalone);
     }
-    return false;
+));
+static_assert(Fw::find_usb_descriptor(Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB)->hub);
+static_assert(
+    Fw::find_usb_descriptor(Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_DEFCON_BADGE_2025)->standalone
+);
+static_assert(
+    Fw::find_usb_descriptor(Fw::USB_VID_FW2_DEBUG_PROBE, Fw::USB_PID_FW2_DEBUG_PROBE)->kind
+    == Fw::USBDeviceType::DebugProbe
+);
+static_assert(Fw::find_usb_descriptor(Fw::USB_VID_FW_RPI, 0xFFFF) == nullptr);
+static_assert(Fw::find_usb_descriptor(0x0000, 0x0000) == nullptr);
+static_assert(Fw::find_usb_descriptor(0xFFFF, 0xFFFF) == nullptr);
+
+auto Fw::is_vid_pid_whitelisted(uint16_t vid, uint16_t pid) -> bool {
+    return Fw::find_usb_descriptor(vid, pid) != nullptr;
 }
 
 auto Fw::is_freewili_hub(uint16_t vid, uint16_t pid) -> bool {
-    return (vid == Fw::USB_VID_FW_HUB && pid == Fw::USB_PID_FW_HUB)
-        || (vid == Fw::USB_VID_FW2_HUB && pid == Fw::USB_PID_FW2_HUB);
+    const auto* descriptor = Fw::find_usb_descriptor(vid, pid);
+    return descriptor && descriptor->hub;
 }
@@ -0,0 +1,54 @@
+#include "alloc_counter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations { 0 };
+static std::atomic<size_t> allocatedBytes { 0 };
+
+auto allocationCount() noexcept -> AllocationCount {
+    return AllocationCount {
+        .allocations = allocations.load(std::memory_order_relaxed),
+        .bytes = allocatedBytes.load(std::memory_order_relaxed),
+    };
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+// std::pmr::new_delete_resource() allocates through the aligned overloads
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    auto align = static_cast<size_t>(alignment);
+    // aligned_alloc() wants a non-zero multiple of the alignment
+    auto rounded = (std::max<size_t>(size, 1) + align - 1) / align * align;
+    if (void* pointer = std::aligned_alloc(align, rounded)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+/// Counted by the global operator new of test/alloc_counter.cpp, for every thread
+struct AllocationCount {
+    size_t allocations;
+    size_t bytes;
+};
+
+/// Allocations made so far, and the heap bytes they asked for
+auto allocationCount() noexcept -> AllocationCount;
+
+/// Counts the allocations made between its construction and count()
+class AllocationCounter {
+public:
+    AllocationCounter() noexcept: start(allocationCount().allocations) {}
+
+    auto count() const noexcept -> size_t {
+        return allocationCount().allocations - start;
+    }
+
+private:
+    size_t start;
+};
@@ -0,0 +1,208 @@
+#pragma once
+#ifdef __linux__
+
+    #include <fwfinder.hpp>
+    #include <usbdef.hpp>
+
+    #include <unistd.h>
+
+    #include <cstdint>
+    #include <cstdio>
+    #include <filesystem>
+    #include <fstream>
+    #include <string>
+
+/// A throwaway filesystem root holding a synthetic sys/ and proc/mounts, for
+/// Fw::FindOptions::root. Device paths are relative to sys/, ie. "devices/pci0000:00/...".
+///
+/// Trees are generated instead of checked in, sysfs names contain ':' which
+/// doesn't survive a checkout on Windows.
+class SysfsFixture {
+public:
+    explicit SysfsFixture(const std::string& name):
+        root(std::filesystem::temp_directory_path()
+             / ("fwfinder_" + name + "_" + std::to_string(::getpid()))) {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "sys");
+        std::filesystem::create_directories(root / "proc");
+        std::ofstream(root / "proc" / "mounts", std::ios::trunc);
+    }
+    ~SysfsFixture() {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+    SysfsFixture(const SysfsFixture&) = delete;
+    SysfsFixture& operator=(const SysfsFixture&) = delete;
+
+    auto write(const std::string& path, const std::string& contents) -> void {
+        std::filesystem::create_directories((root / "sys" / path).parent_path());
+        std::ofstream(root / "sys" / path) << contents << "\n";
+    }
+
+    /// FindOptions enumerating the fixture, every other field spelled out at its default
+    auto options(Fw::FindStats* stats = nullptr, size_t threads = 1) const -> Fw::FindOptions {
+        return Fw::FindOptions {
+            .backend = Fw::FindBackend::Default,
+            .root = root.string(),
+            .stats = stats,
+            .threads = threads,
+            .stop = {},
+        };
+    }
+
+    /// Link a device into a /sys/bus or /sys/class directory, like the kernel does
+    auto link(const std::string& directory, const std::string& path) -> void {
+        std::filesystem::create_directories(root / "sys" / directory);
+        std::filesystem::create_directory_symlink(
+            root / "sys" / path,
+            root / "sys" / directory / std::filesystem::path(path).filename()
+        );
+    }
+
+    auto usbDevice(
+        const std::string& path,
+        uint16_t vid,
+        uint16_t pid,
+        const std::string& serial,
+        const std::string& product = "USB Device"
+    ) -> void {
+        char id[5];
+        std::snprintf(id, sizeof(id), "%04x", vid);
+        write(path + "/idVendor", id);
+        std::snprintf(id, sizeof(id), "%04x", pid);
+        write(path + "/idProduct", id);
+        if (!serial.empty()) {
+            write(path + "/serial", serial);
+        }
+        write(path + "/product", product);
+        link("bus/usb/devices", path);
+    }
+
+    /// cdc_acm style tty: <usb device>/<interface>/tty/<name>
+    auto acmPort(const std::string& usbPath, const std::string& interface, const std::string& name)
+        -> void {
+        auto path = usbPath + "/" + interface + "/tty/" + name;
+        write(path + "/uevent", "DEVNAME=" + name);
+        link("class/tty", path);
+    }
+
+    /// ftdi_sio style tty: <usb device>/<interface>/<name>/tty/<name>
+    auto ftdiPort(const std::string& usbPath, const std::string& interface, const std::string& name)
+        -> void {
+        auto path = usbPath + "/" + interface + "/" + name + "/tty/" + name;
+        write(path + "/uevent", "DEVNAME=" + name);
+        link("class/tty", path);
+    }
+
+    /// usb-storage disk with one partition, the partition is mounted when mountPoint is set
+    auto disk(
+        const std::string& usbPath,
+        const std::string& name,
+        unsigned int minor,
+        const std::string& mountPoint = ""
+    ) -> void {
+        auto interface = usbPath.substr(usbPath.rfind('/') + 1) + ":1.0";
+        auto path = usbPath + "/" + interface + "/host0/target0:0:0/0:0:0:0/block/" + name;
+        write(path + "/uevent", "DEVTYPE=disk\nDEVNAME=" + name);
+        write(path + "/dev", "8:" + std::to_string(minor));
+        link("class/block", path);
+        write(path + "/" + name + "1/uevent", "DEVTYPE=partition\nDEVNAME=" + name + "1");
+        write(path + "/" + name + "1/dev", "8:" + std::to_string(minor + 1));
+        write(path + "/" + name + "1/partition", "1");
+        link("class/block", path + "/" + name + "1");
+        if (!mountPoint.empty()) {
+            std::ofstream(root / "proc" / "mounts", std::ios::app)
+                << "/dev/" << name << "1 " << mountPoint << " vfat rw,relatime 0 0\n";
+        }
+    }
+
+    std::filesystem::path root;
+};
+
+/// @brief Add a FREE-WILi2 laid out like the FX0025 capture documented in usbdef.hpp.
+/// @param fixture tree to populate
+/// @param hubPath path of the FREE-WILi2 internal hub, ie. "devices/.../usb3/3-4/3-4.1"
+/// @param serial hub serial
+/// @param index distinguishes tty and disk names when several boards share a tree
+inline auto addFreeWili2(
+    SysfsFixture& fixture,
+    const std::string& hubPath,
+    const std::string& serial,
+    size_t index
+) -> void {
+    const auto hubName = hubPath.substr(hubPath.rfind('/') + 1);
+    auto child = [&](uint32_t port) {
+        return hubPath + "/" + hubName + "." + std::to_string(port);
+    };
+    auto interface = [&](uint32_t port, uint32_t number) {
+        return hubName + "." + std::to_string(port) + ":1." + std::to_string(number);
+    };
+    auto acm = [&](size_t port) {
+        return "ttyACM" + std::to_string(index * 4 + port);
+    };
+
+    fixture.usbDevice(hubPath, Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB, serial, "FREE-WILi2");
+    fixture.usbDevice(child(1), Fw::USB_VID_FW2_MAIN, Fw::USB_PID_FW2_MAIN, serial, "FW2 v07");
+    fixture.acmPort(child(1), interface(1, 0), acm(0));
+    fixture.usbDevice(
+        child(3),
+        Fw::USB_VID_FW2_FTDI,
+        Fw::USB_PID_FW2_FTDI,
+        serial,
+        "FREE-WILi FW2"
+    );
+    fixture.ftdiPort(child(3), interface(3, 0), "ttyUSB" + std::to_string(index));
+    fixture.usbDevice(
+        child(4),
+        Fw::USB_VID_FW2_DEBUG_PROBE,
+        Fw::USB_PID_FW2_DEBUG_PROBE,
+        "E66568714F28A828",
+        "FreeWili Debug Probe (CMSIS-DAP)"
+    );
+    fixture.acmPort(child(4), interface(4, 4), acm(1));
+    fixture.acmPort(child(4), interface(4, 6), acm(2));
+    fixture.usbDevice(
+        child(5),
+        Fw::USB_VID_FW2_ESP32,
+        Fw::USB_PID_FW2_ESP32_JTAG,
+        "3C:DC:75:9A:BB:40",
+        "USB JTAG/serial debug unit"
+    );
+    fixture.acmPort(child(5), interface(5, 0), acm(3));
+    fixture.usbDevice(
+        child(6),
+        Fw::USB_VID_FW2_MASS_STORAGE,
+        Fw::USB_PID_FW2_MASS_STORAGE,
+        "0000395D5D4D",
+        "FW Ultra Fast Media"
+    );
+    // sda, sdb, ... sdz, sdaa like the kernel, so partition names never collide with disks
+    std::string disk;
+    for (size_t n = index + 1; n > 0; n = (n - 1) / 26) {
+        disk.insert(disk.begin(), static_cast<char>('a' + (n - 1) % 26));
+    }
+    fixture.disk(
+        child(6),
+        "sd" + disk,
+        static_cast<unsigned int>(index * 16),
+        "/media/fw/" + serial
+    );
+}
+
+/// @brief Add hubCount FREE-WILi2 boards, 8 per root hub, each root hub also carrying a keyboard.
+inline auto addFreeWili2Farm(SysfsFixture& fixture, size_t hubCount) -> void {
+    const std::string controller = "devices/pci0000:00/0000:00:14.0";
+    const size_t portsPerRootHub = 8;
+    for (size_t i = 0; i < hubCount; ++i) {
+        auto bus = std::to_string(i / portsPerRootHub + 1);
+        auto rootHub = controller + "/usb" + bus;
+        if (i % portsPerRootHub == 0) {
+            fixture.usbDevice(rootHub, 0x1D6B, 0x0002, "0000:00:14.0", "xHCI Host Controller");
+            fixture.usbDevice(rootHub + "/" + bus + "-9", 0x046D, 0xC31C, "", "USB Keyboard");
+        }
+        auto port = std::to_string(i % portsPerRootHub + 1);
+        addFreeWili2(fixture, rootHub + "/" + bus + "-" + port, "FX" + std::to_string(1000 + i), i);
+    }
+}
+
+#endif // __linux__
@@ -2,9 +2,17 @@
 
 #include <fwfinder.hpp>
 #include <fwbuilder.hpp>
+#include <fwcompact.hpp>
 #include <usbdef.hpp>
 
+#include "alloc_counter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdio>
+#include <map>
+#include <memory_resource>
 
 TEST(FwFinder, getUSBDeviceTypeFrom) {
     ASSERT_EQ(
@@ -436,6 +444,14 @@ TEST_F(FreeWiliDeviceMethodTest, GetMainUSBDevice_WithMassStorage_ReturnsMainMas
     EXPECT_EQ(device.paths.value()[0], "/mnt/freewili_main");
 }
 
+TEST_F(FreeWiliDeviceMethodTest, GetMassStoragePaths) {
+    EXPECT_EQ(
+        deviceWithMassStorage_->getMassStoragePaths(),
+        (std::vector<std::string> { "/mnt/freewili_main", "/mnt/freewili_display" })
+    );
+    EXPECT_TRUE(minimalDevice_->getMassStoragePaths().empty());
+}
+
 TEST_F(FreeWiliDeviceMethodTest, GetMainUSBDevice_MinimalDevice_ReturnsError) {
     auto result = minimalDevice_->getMainUSBDevice();
     EXPECT_FALSE(result.has_value());
@@ -870,3 +886,240 @@ TEST(FW2Device, GetMassStorageViaFilter) {
     );
     EXPECT_TRUE(massStorageDevices[0].paths.has_value());
 }
+
+TEST(FW2Device, ViewUSBDevicesBorrowsStorage) {
+    auto result = FW2DeviceTestSetup::createFullFW2Device();
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    auto all = result->viewUSBDevices();
+    EXPECT_EQ(all.data(), result->usbDevices.data());
+    EXPECT_EQ(all.size(), result->usbDevices.size());
+
+    for (auto kind: { Fw::USBDeviceType::MassStorage,
+                      Fw::USBDeviceType::ESP32,
+                      Fw::USBDeviceType::SerialDisplay })
+    {
+        auto copies = result->getUSBDevices(kind);
+        size_t i = 0;
+        for (const auto& usbDevice: result->viewUSBDevices(kind)) {
+            ASSERT_LT(i, copies.size());
+            EXPECT_EQ(usbDevice._raw, copies[i++]._raw);
+            EXPECT_GE(&usbDevice, all.data());
+            EXPECT_LT(&usbDevice, all.data() + all.size());
+        }
+        EXPECT_EQ(i, copies.size());
+    }
+}
+
+TEST(FW2Device, FindUSBDevicesPointIntoDevice) {
+    auto result = FW2DeviceTestSetup::createFullFW2Device();
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    auto main = result->findMainUSBDevice();
+    ASSERT_TRUE(main.has_value());
+    EXPECT_EQ(main.value()->_raw, result->getMainUSBDevice()->_raw);
+    auto hub = result->findHubUSBDevice();
+    ASSERT_TRUE(hub.has_value());
+    EXPECT_EQ(hub.value(), &result->usbDevices[0]);
+    auto esp32 = result->findESP32USBDevice();
+    ASSERT_TRUE(esp32.has_value());
+    EXPECT_EQ(esp32.value()->kind, Fw::USBDeviceType::ESP32);
+    auto probe = result->findDebugProbeUSBDevice();
+    ASSERT_TRUE(probe.has_value());
+    EXPECT_EQ(probe.value()->kind, Fw::USBDeviceType::DebugProbe);
+    auto fpga = result->findFPGAUSBDevice();
+    ASSERT_TRUE(fpga.has_value());
+    EXPECT_EQ(fpga.value()->kind, Fw::USBDeviceType::FTDI);
+
+    auto display = result->findDisplayUSBDevice();
+    ASSERT_FALSE(display.has_value());
+    EXPECT_EQ(display.error(), Fw::USBDeviceError::NotFound);
+    EXPECT_EQ(result->getDisplayUSBDevice().error(), "Display USB device not found");
+}
+
+TEST(FwFinder, FindUSBDeviceOnStandaloneDevice) {
+    auto device = Fw::FreeWiliDevice::fromUSBDevices({ Fw::USBDevice {
+        .kind = Fw::USBDeviceType::MassStorage,
+        .vid = Fw::USB_VID_FW_RPI,
+        .pid = Fw::USB_PID_FW_RPI_2350_UF2_PID,
+        .name = "Raspberry Pi RP2350 Boot",
+        .serial = "E0C9125B0D9B",
+        .location = 2,
+        .portChain = { 3, 2 },
+        .paths = std::nullopt,
+        .port = std::nullopt,
+        ._raw = "/sys/devices/pci0000:00/0000:00:14.0/usb3/3-2",
+    } });
+    ASSERT_TRUE(device.has_value()) << device.error();
+    ASSERT_TRUE(device->standalone);
+
+    auto main = device->findMainUSBDevice();
+    ASSERT_TRUE(main.has_value());
+    EXPECT_EQ(main.value(), device->viewUSBDevices().data());
+
+    auto hub = device->findHubUSBDevice();
+    ASSERT_FALSE(hub.has_value());
+    EXPECT_EQ(hub.error(), Fw::USBDeviceError::Standalone);
+    EXPECT_EQ(Fw::getUSBDeviceErrorMessage(hub.error()), "Standalone device");
+    EXPECT_EQ(
+        device->getHubUSBDevice().error(),
+        Fw::getDeviceTypeName(device->deviceType)
+            + " is a standalone device and has no HUB USB device."
+    );
+    EXPECT_EQ(device->findESP32USBDevice().error(), Fw::USBDeviceError::Standalone);
+    EXPECT_EQ(
+        Fw::getUSBDeviceErrorMessage(Fw::USBDeviceError::NotFound),
+        "USB device not found"
+    );
+}
+
+TEST(CompactDevices, RoundTripsFreeWiliDevices) {
+    auto fw2 = FW2DeviceTestSetup::createFullFW2Device();
+    ASSERT_TRUE(fw2.has_value()) << fw2.error();
+    auto fw1 = FreeWiliDeviceTestSetup::createDeviceWithMassStorage();
+    ASSERT_TRUE(fw1.has_value()) << fw1.error();
+    const Fw::FreeWiliDevices devices = { fw1.value(), fw2.value() };
+
+    auto compact = Fw::CompactDevices::from(devices);
+    ASSERT_TRUE(compact.has_value()) << compact.error();
+    ASSERT_EQ(compact->devices().size(), 2);
+    EXPECT_EQ(
+        compact->usbDevices().size(),
+        fw1->usbDevices.size() + fw2->usbDevices.size()
+    );
+
+    auto restored = compact->toFreeWiliDevices();
+    ASSERT_TRUE(restored.has_value()) << restored.error();
+    ASSERT_EQ(restored->size(), devices.size());
+    for (size_t i = 0; i < devices.size(); ++i) {
+        EXPECT_EQ(restored->at(i).deviceType, devices[i].deviceType);
+        EXPECT_EQ(restored->at(i).name, devices[i].name);
+        EXPECT_EQ(restored->at(i).serial, devices[i].serial);
+        EXPECT_EQ(restored->at(i).uniqueID, devices[i].uniqueID);
+        EXPECT_EQ(restored->at(i).standalone, devices[i].standalone);
+        // USBDevice::operator== compares every field, nullopt and empty included
+        EXPECT_EQ(restored->at(i).usbDevices, devices[i].usbDevices);
+    }
+}
+
+TEST(CompactDevices, InternsStrings) {
+    auto fw2 = FW2DeviceTestSetup::createFullFW2Device();
+    ASSERT_TRUE(fw2.has_value()) << fw2.error();
+
+    auto compact = Fw::CompactDevices::from({ fw2.value() });
+    ASSERT_TRUE(compact.has_value()) << compact.error();
+    const auto& device = compact->devices()[0];
+    EXPECT_EQ(compact->string(device.serial), fw2->serial);
+
+    // The hub and the FTDI chip share the device serial, it's stored once
+    for (const auto& usbDevice: compact->usbDevices(device)) {
+        if (compact->string(usbDevice.serial) == fw2->serial) {
+            EXPECT_EQ(usbDevice.serial, device.serial);
+        }
+        if (usbDevice.kind == Fw::USBDeviceType::MassStorage) {
+            ASSERT_TRUE(usbDevice.hasPaths);
+            EXPECT_FALSE(compact->paths(usbDevice).empty());
+        } else {
+            EXPECT_TRUE(compact->paths(usbDevice).empty());
+        }
+    }
+    EXPECT_GT(compact->memoryUsage(), 0);
+}
+
+TEST(CompactDevices, PortChainLimits) {
+    auto chain = Fw::PortChain::from(std::vector<uint32_t> { 3, 4, 1 });
+    ASSERT_TRUE(chain.has_value()) << chain.error();
+    EXPECT_EQ(chain->size(), 3);
+    EXPECT_EQ((*chain)[1], 4);
+    EXPECT_EQ(chain->toVector(), (std::vector<uint32_t> { 3, 4, 1 }));
+
+    EXPECT_FALSE(Fw::PortChain::from(std::vector<uint32_t>(Fw::PortChain::capacity + 1, 1))
+                     .has_value());
+    EXPECT_FALSE(Fw::PortChain::from(std::vector<uint32_t> { 1, 256 }).has_value());
+    EXPECT_TRUE(Fw::PortChain::from(std::vector<uint32_t>(Fw::PortChain::capacity, 1))
+                    .has_value());
+}
+
+TEST(FW2Device, FromUSBDevicesMovesStorage) {
+    auto full = FW2DeviceTestSetup::createFullFW2Device();
+    ASSERT_TRUE(full.has_value()) << full.error();
+
+    auto usbDevices = full->usbDevices;
+    AllocationCounter copyAllocations;
+    auto copied = Fw::FreeWiliDevice::fromUSBDevices(usbDevices);
+    auto copies = copyAllocations.count();
+    ASSERT_TRUE(copied.has_value()) << copied.error();
+
+    const auto* storage = usbDevices.data();
+    AllocationCounter moveAllocations;
+    auto moved = Fw::FreeWiliDevice::fromUSBDevices(std::move(usbDevices));
+    auto moves = moveAllocations.count();
+    ASSERT_TRUE(moved.has_value()) << moved.error();
+    EXPECT_EQ(moved->usbDevices.data(), storage);
+    EXPECT_LT(moves, copies);
+
+    EXPECT_EQ(moved->name, copied->name);
+    EXPECT_EQ(moved->serial, copied->serial);
+    EXPECT_EQ(moved->uniqueID, copied->uniqueID);
+    EXPECT_EQ(moved->usbDevices, copied->usbDevices);
+}
+
+TEST(CompactDevices, TablesLiveInTheirResource) {
+    auto fw2 = FW2DeviceTestSetup::createFullFW2Device();
+    ASSERT_TRUE(fw2.has_value()) << fw2.error();
+
+    // Nothing may spill out of the buffer
+    std::array<std::byte, 8 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena(
+        buffer.data(),
+        buffer.size(),
+        std::pmr::null_memory_resource()
+    );
+    auto compact = Fw::CompactDevices::from({ fw2.value() }, &arena);
+    ASSERT_TRUE(compact.has_value()) << compact.error();
+    EXPECT_EQ(compact->get_allocator().resource(), &arena);
+    auto restored = compact->toFreeWiliDevices();
+    ASSERT_TRUE(restored.has_value()) << restored.error();
+    EXPECT_EQ(restored->at(0).usbDevices, fw2->usbDevices);
+
+    // Copies leave the arena, moves stay in it
+    auto copy = compact.value();
+    EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    EXPECT_EQ(copy.string(copy.devices()[0].serial), fw2->serial);
+    auto moved = std::move(compact.value());
+    EXPECT_EQ(moved.get_allocator().resource(), &arena);
+}
+
+TEST(FW2Device, SortMovesDevices) {
+    Fw::FreeWiliDevices devices;
+    for (uint32_t port: { 4u, 2u, 3u }) {
+        auto result = FW2DeviceTestSetup::createFullFW2Device();
+        ASSERT_TRUE(result.has_value()) << result.error();
+        auto usbDevices = std::move(result->usbDevices);
+        for (auto& usbDevice: usbDevices) {
+            usbDevice.portChain[0] = port;
+        }
+        auto device = Fw::FreeWiliDevice::fromUSBDevices(std::move(usbDevices));
+        ASSERT_TRUE(device.has_value()) << device.error();
+        devices.push_back(std::move(device.value()));
+    }
+    std::map<uint64_t, const Fw::USBDevice*> storage;
+    for (const auto& device: devices) {
+        storage[device.uniqueID] = device.usbDevices.data();
+    }
+
+    // A copy assignment would leave every device in the buffer of the one it replaced
+    AllocationCounter counter;
+    std::sort(devices.begin(), devices.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.uniqueID < rhs.uniqueID;
+    });
+    EXPECT_EQ(counter.count(), 0);
+    for (const auto& device: devices) {
+        EXPECT_EQ(device.usbDevices.data(), storage[device.uniqueID]);
+    }
+
+    Fw::FreeWiliDevice moved = devices[1];
+    moved = std::move(devices[0]);
+    EXPECT_EQ(moved.usbDevices.data(), storage[moved.uniqueID]);
+    EXPECT_EQ(devices[0].deviceType, Fw::DeviceType::Unknown);
+}
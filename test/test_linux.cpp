@@ -0,0 +1,994 @@
+#ifdef __linux__
+
+    #include <gtest/gtest.h>
+
+    #include <fwasync.hpp>
+    #include <fwcache.hpp>
+    #include <fwcompact.hpp>
+    #include <fwfinder.hpp>
+    #include <fwfinder_linux.hpp>
+    #include <fwwatcher.hpp>
+    #include <usbdef.hpp>
+
+    #include "alloc_counter.hpp"
+    #include "sysfs_fixture.hpp"
+
+    #include <poll.h>
+    #include <sched.h>
+    #include <sys/mount.h>
+    #include <sys/sysmacros.h>
+    #include <unistd.h>
+
+    #include <array>
+    #include <chrono>
+    #include <condition_variable>
+    #include <coroutine>
+    #include <filesystem>
+    #include <fstream>
+    #include <future>
+    #include <memory_resource>
+    #include <mutex>
+    #include <sstream>
+    #include <stop_token>
+    #include <string>
+    #include <thread>
+
+static auto makeNode(
+    const std::string& syspath,
+    const std::string& parentSyspath,
+    uint16_t vid,
+    uint16_t pid,
+    std::vector<uint32_t> portChain,
+    const std::string& serial = ""
+) -> UsbNode {
+    return UsbNode {
+        .syspath = syspath,
+        .parentSyspath = parentSyspath,
+        .vid = vid,
+        .pid = pid,
+        .manufacturer = "",
+        .product = "USB Device",
+        .serial = serial,
+        .location = portChain.back(),
+        .portChain = portChain,
+    };
+}
+
+TEST(LinuxDiscovery, findUsbHubChildren) {
+    const std::string root = "/sys/devices/pci0000:00/0000:00:14.0/usb1";
+    DeviceTable table;
+    table.usbDevices = {
+        makeNode(root, "", 0x1D6B, 0x0002, { 1 }),
+        makeNode(root + "/1-1", root, Fw::USB_VID_FW_HUB, Fw::USB_PID_FW_HUB, { 1, 1 }),
+        makeNode(
+            root + "/1-1/1-1.1",
+            root + "/1-1",
+            Fw::USB_VID_FW_ICS,
+            Fw::USB_PID_FW_MAIN_CDC_PID,
+            { 1, 1, 1 }
+        ),
+        makeNode(
+            root + "/1-1/1-1.3",
+            root + "/1-1",
+            Fw::USB_VID_FW_FTDI,
+            Fw::USB_PID_FW_FTDI,
+            { 1, 1, 3 },
+            "FW4607"
+        ),
+        // 1-10 shares the "1-1" prefix but is a sibling of the hub, not a child
+        makeNode(root + "/1-10", root, 0x046D, 0xC31C, { 1, 10 }),
+    };
+    const auto index = _buildDeviceIndex(table);
+
+    auto children = _findUsbHubChildren(index, root + "/1-1");
+    ASSERT_EQ(children.size(), 2);
+    ASSERT_EQ(children[0]->syspath, root + "/1-1/1-1.1");
+    ASSERT_EQ(children[1]->syspath, root + "/1-1/1-1.3");
+
+    auto fwDevices = _find_all_freewili(table, index);
+    ASSERT_EQ(fwDevices.size(), 1);
+    ASSERT_EQ(fwDevices[0].usbDevices.size(), 3);
+    ASSERT_EQ(fwDevices[0].serial, "FW4607");
+}
+
+TEST(LinuxDiscovery, diskAndSerialAssociation) {
+    const std::string root = "/sys/devices/pci0000:00/0000:00:14.0/usb1";
+    DeviceTable table;
+    table.usbDevices = {
+        makeNode(root, "", 0x1D6B, 0x0002, { 1 }),
+        makeNode(
+            root + "/1-2",
+            root,
+            Fw::USB_VID_FW_RPI,
+            Fw::USB_PID_FW_RPI_2350_UF2_PID,
+            { 1, 2 },
+            "E0C9125B0D9B"
+        ),
+        makeNode(root + "/1-3", root, Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_WINKY, { 1, 3 }, "W1"),
+    };
+    table.disks = {
+        DiskInfo {
+            .devPath = root + "/1-2",
+            .diskName = "/dev/sdb",
+            .blockDevices = {},
+            .mountPoints = { "/media/RP2350" },
+        },
+    };
+    table.serialPorts = {
+        SerialInfo { .devPath = root + "/1-3", .ttyName = "/dev/ttyACM0" },
+        SerialInfo { .devPath = root + "/1-3", .ttyName = "/dev/ttyACM1" },
+    };
+    const auto index = _buildDeviceIndex(table);
+
+    const auto* disk = _findDiskInfo(index, table.usbDevices[1]);
+    ASSERT_NE(disk, nullptr);
+    ASSERT_EQ(disk->diskName, "/dev/sdb");
+    ASSERT_EQ(_findSerialInfo(index, table.usbDevices[1]), nullptr);
+    // The first port of a usb_device wins
+    const auto* serialPort = _findSerialInfo(index, table.usbDevices[2]);
+    ASSERT_NE(serialPort, nullptr);
+    ASSERT_EQ(serialPort->ttyName, "/dev/ttyACM0");
+    ASSERT_EQ(_findDiskInfo(index, table.usbDevices[0]), nullptr);
+
+    auto fwDevices = _find_all_standalone(table, index);
+    ASSERT_EQ(fwDevices.size(), 2);
+    ASSERT_EQ(fwDevices[0].deviceType, Fw::DeviceType::UF2);
+    ASSERT_EQ(fwDevices[0].usbDevices[0].paths, std::vector<std::string> { "/media/RP2350" });
+    ASSERT_FALSE(fwDevices[0].usbDevices[0].port.has_value());
+    ASSERT_EQ(fwDevices[1].deviceType, Fw::DeviceType::Winky);
+    ASSERT_EQ(fwDevices[1].usbDevices[0].port, "/dev/ttyACM0");
+}
+
+TEST(LinuxDiscovery, parseMountInfo) {
+    std::istringstream mountInfo(
+        "22 1 259:2 / / rw,relatime shared:1 - ext4 /dev/nvme0n1p2 rw\n"
+        "310 22 0:52 / /var/lib/docker/overlay2/abc/merged rw shared:170 - overlay overlay rw\n"
+        "412 22 8:17 / /media/fw/RP2350 rw,nosuid,nodev shared:231 - vfat /dev/sdb1 rw\n"
+        "413 22 8:17 / /mnt/FW\\040Media rw shared:232 - vfat /dev/sdb1 rw\n"
+        "414 22 8:32 / /media/fw/whole rw shared:233 - vfat /dev/sdc rw\n"
+        "garbage\n"
+    );
+    auto mounts = _parseMountInfo(mountInfo);
+    ASSERT_EQ(mounts.mountPointsByDevNum.size(), 4);
+
+    auto disk = DiskInfo {
+        .devPath = "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2",
+        .diskName = "/dev/sdb",
+        .blockDevices = {
+            BlockDevice { .devNum = makedev(8, 16), .devNode = "/dev/sdb" },
+            BlockDevice { .devNum = makedev(8, 17), .devNode = "/dev/sdb1" },
+        },
+        .mountPoints = {},
+    };
+    auto mountPoints = _findMountPoints(mounts, disk);
+    ASSERT_EQ(mountPoints, (std::vector<std::string> { "/media/fw/RP2350", "/mnt/FW Media" }));
+
+    disk.blockDevices = { BlockDevice { .devNum = makedev(8, 48), .devNode = "/dev/sdd" } };
+    ASSERT_TRUE(_findMountPoints(mounts, disk).empty());
+}
+
+// A FREE-WILi2 plugged into 1-1 as udev reports it, children first then their ttys and disks
+static auto recordedFreeWili2Plug(const std::string& root) -> std::vector<TopologyEvent> {
+    const std::string hub = root + "/1-1";
+    const std::string disk = hub + "/1-1.6/1-1.6:1.0/host0/target0:0:0/0:0:0:0/block/sda";
+    auto usbEvent = [](UsbNode node) {
+        auto syspath = node.syspath;
+        return TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = std::move(syspath),
+            .device = std::move(node),
+        };
+    };
+    return {
+        usbEvent(makeNode(root, "", 0x1D6B, 0x0002, { 1 })),
+        usbEvent(makeNode(hub, root, Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB, { 1, 1 }, "FX0025")),
+        usbEvent(makeNode(
+            hub + "/1-1.1",
+            hub,
+            Fw::USB_VID_FW2_MAIN,
+            Fw::USB_PID_FW2_MAIN,
+            { 1, 1, 1 },
+            "FX0025"
+        )),
+        usbEvent(makeNode(
+            hub + "/1-1.6",
+            hub,
+            Fw::USB_VID_FW2_MASS_STORAGE,
+            Fw::USB_PID_FW2_MASS_STORAGE,
+            { 1, 1, 6 },
+            "FX0025"
+        )),
+        // Unrelated keyboard on the same root hub
+        usbEvent(makeNode(root + "/1-9", root, 0x046D, 0xC31C, { 1, 9 })),
+        TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = hub + "/1-1.1/1-1.1:1.0/tty/ttyACM0",
+            .device =
+                SerialInfo {
+                    .devPath = hub + "/1-1.1",
+                    .ttyName = "/dev/ttyACM0",
+                },
+        },
+        TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = disk,
+            .device =
+                DiskInfo {
+                    .devPath = hub + "/1-1.6",
+                    .diskName = "/dev/sda",
+                    .blockDevices = {
+                        BlockDevice { .devNum = makedev(8, 0), .devNode = "/dev/sda" },
+                    },
+                    .mountPoints = {},
+                },
+        },
+        TopologyEvent {
+            .action = TopologyAction::Add,
+            .syspath = disk + "/sda1",
+            .device =
+                PartitionInfo {
+                    .diskSyspath = disk,
+                    .blockDevice = BlockDevice { .devNum = makedev(8, 1), .devNode = "/dev/sda1" },
+                },
+        },
+    };
+}
+
+static auto removalsOf(const std::vector<TopologyEvent>& events) -> std::vector<TopologyEvent> {
+    std::vector<TopologyEvent> removals;
+    for (auto it = events.rbegin(); it != events.rend(); ++it) {
+        removals.push_back(
+            TopologyEvent { .action = TopologyAction::Remove, .syspath = it->syspath, .device = {} }
+        );
+    }
+    return removals;
+}
+
+TEST(LinuxDiscovery, topologyRecordedPlugAndUnplug) {
+    const std::string root = "/sys/devices/pci0000:00/0000:00:14.0/usb1";
+    const auto plug = recordedFreeWili2Plug(root);
+    DeviceTopology topology;
+
+    // The whole plug burst coalesces into a single Added
+    auto events = topology.replay(plug);
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].type, Fw::DeviceEventType::Added);
+    ASSERT_EQ(events[0].device.deviceType, Fw::DeviceType::FreeWili2);
+    ASSERT_EQ(events[0].device.serial, "FX0025");
+    ASSERT_EQ(events[0].device.getMainUSBDevice().value().port, "/dev/ttyACM0");
+    const auto uniqueID = events[0].device.uniqueID;
+
+    // Replaying the same adds, as the enumeration racing the monitor does, is a no-op
+    ASSERT_TRUE(topology.replay(plug).empty());
+
+    // Mounting the partition changes the device in place
+    std::istringstream mountInfo("412 22 8:1 / /media/fw/FX0025 rw - vfat /dev/sda1 rw\n");
+    topology.updateMounts(_parseMountInfo(mountInfo));
+    events = topology.flush();
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].type, Fw::DeviceEventType::Changed);
+    ASSERT_EQ(events[0].device.uniqueID, uniqueID);
+    auto storage = events[0].device.getUSBDevices(Fw::USBDeviceType::MassStorage);
+    ASSERT_EQ(storage.size(), 1);
+    ASSERT_EQ(storage[0].paths, std::vector<std::string> { "/media/fw/FX0025" });
+
+    // Unplugging tears everything down with a single Removed
+    events = topology.replay(removalsOf(plug));
+    ASSERT_EQ(events.size(), 1);
+    ASSERT_EQ(events[0].type, Fw::DeviceEventType::Removed);
+    ASSERT_EQ(events[0].device.uniqueID, uniqueID);
+    ASSERT_TRUE(topology.devices().empty());
+}
+
+TEST(LinuxDiscovery, topologyShortLivedDevice) {
+    const std::string root = "/sys/devices/pci0000:00/0000:00:14.0/usb1";
+    DeviceTopology topology;
+    topology.replay(recordedFreeWili2Plug(root));
+    ASSERT_EQ(topology.devices().size(), 1);
+
+    // A UF2 bootloader that comes and goes between two polls is still reported
+    auto uf2 = makeNode(
+        root + "/1-2",
+        root,
+        Fw::USB_VID_FW_RPI,
+        Fw::USB_PID_FW_RPI_2350_UF2_PID,
+        { 1, 2 },
+        "E0C9125B0D9B"
+    );
+    auto events = topology.replay({
+        TopologyEvent { .action = TopologyAction::Add, .syspath = uf2.syspath, .device = uf2 },
+        TopologyEvent { .action = TopologyAction::Remove, .syspath = uf2.syspath, .device = {} },
+    });
+    ASSERT_EQ(events.size(), 2);
+    ASSERT_EQ(events[0].type, Fw::DeviceEventType::Added);
+    ASSERT_EQ(events[0].device.deviceType, Fw::DeviceType::UF2);
+    ASSERT_EQ(events[1].type, Fw::DeviceEventType::Removed);
+    ASSERT_EQ(events[1].device.uniqueID, events[0].device.uniqueID);
+    // The FREE-WILi2 next to it was never touched
+    ASSERT_EQ(topology.devices().size(), 1);
+    ASSERT_EQ(topology.devices()[0].deviceType, Fw::DeviceType::FreeWili2);
+}
+
+TEST(LinuxDiscovery, waitForDevice) {
+    using namespace std::chrono_literals;
+    const std::string root = "/sys/devices/pci0000:00/0000:00:14.0/usb1";
+    const auto plug = recordedFreeWili2Plug(root);
+    std::istringstream mountInfo("412 22 8:1 / /media/fw/FX0025 rw - vfat /dev/sda1 rw\n");
+    const auto mounted = _parseMountInfo(mountInfo);
+
+    // Batches go through a pipe so the wait really blocks, like on a udev monitor
+    int pipeFds[2];
+    ASSERT_EQ(::pipe(pipeFds), 0);
+    std::mutex mutex;
+    std::vector<TopologyEvent> queued;
+    MountTable mounts;
+    auto send = [&](std::vector<TopologyEvent> batch, MountTable mountTable) {
+        {
+            std::lock_guard lock(mutex);
+            queued.insert(queued.end(), batch.begin(), batch.end());
+            mounts = std::move(mountTable);
+        }
+        ASSERT_EQ(::write(pipeFds[1], "x", 1), 1);
+    };
+    const TopologyWaitSources sources {
+        .eventFd = pipeFds[0],
+        .mountInfoFd = -1,
+        .drain =
+            [&] {
+                char buffer[64];
+                EXPECT_GT(::read(pipeFds[0], buffer, sizeof(buffer)), 0);
+                std::lock_guard lock(mutex);
+                return std::exchange(queued, {});
+            },
+        .readMounts =
+            [&] {
+                std::lock_guard lock(mutex);
+                return mounts;
+            },
+    };
+    size_t calls = 0;
+    auto mountedFreeWili2 = [&](const Fw::FreeWiliDevice& device) {
+        ++calls;
+        auto storage = device.getUSBDevices(Fw::USBDeviceType::MassStorage);
+        return device.deviceType == Fw::DeviceType::FreeWili2 && !storage.empty()
+            && !storage[0].paths.value_or(std::vector<std::string> {}).empty();
+    };
+    DeviceTopology topology;
+
+    // Nothing shows up
+    auto start = std::chrono::steady_clock::now();
+    auto device = _waitForDevice(topology, sources, mountedFreeWili2, start + 30ms);
+    ASSERT_FALSE(device.has_value());
+    ASSERT_GE(std::chrono::steady_clock::now() - start, 30ms);
+    ASSERT_EQ(calls, 0);
+
+    // The board is reported before its partition is mounted, the wait goes on until it is
+    std::thread plugger([&] {
+        std::this_thread::sleep_for(20ms);
+        send(plug, {});
+        std::this_thread::sleep_for(20ms);
+        auto partition = plug.back();
+        partition.action = TopologyAction::Change;
+        send({ partition }, mounted);
+    });
+    device = _waitForDevice(
+        topology,
+        sources,
+        mountedFreeWili2,
+        std::chrono::steady_clock::now() + 5s
+    );
+    plugger.join();
+    ASSERT_TRUE(device.has_value()) << device.error();
+    ASSERT_EQ(device->serial, "FX0025");
+    ASSERT_EQ(
+        device->getUSBDevices(Fw::USBDeviceType::MassStorage)[0].paths.value(),
+        std::vector<std::string> { "/media/fw/FX0025" }
+    );
+    // Once for the Added board without paths, once for the Changed one
+    ASSERT_EQ(calls, 2);
+
+    // Devices already known are accepted without waiting
+    device = _waitForDevice(topology, sources, mountedFreeWili2, std::chrono::steady_clock::now());
+    ASSERT_TRUE(device.has_value());
+    ASSERT_EQ(calls, 3);
+
+    // The main processor comes back under a hub that stayed plugged in, like after a reboot.
+    // Known from the enumeration, the hub owns the new node instead of dropping it.
+    auto withoutMain = plug;
+    std::erase_if(withoutMain, [](const TopologyEvent& event) {
+        return event.syspath.ends_with("/1-1.1") || event.syspath.ends_with("/ttyACM0");
+    });
+    DeviceTopology seeded;
+    seeded.replay(withoutMain);
+    auto withMain = [&](const Fw::FreeWiliDevice& device) {
+        return !device.getUSBDevices(Fw::USBDeviceType::SerialMain).empty();
+    };
+    std::thread rebooter([&] {
+        std::this_thread::sleep_for(20ms);
+        send({ plug[2], plug[5] }, {});
+    });
+    device = _waitForDevice(seeded, sources, withMain, std::chrono::steady_clock::now() + 5s);
+    rebooter.join();
+    ASSERT_TRUE(device.has_value()) << device.error();
+    ASSERT_EQ(device->deviceType, Fw::DeviceType::FreeWili2);
+    ASSERT_EQ(device->uniqueID, topology.devices()[0].uniqueID);
+    ASSERT_EQ(device->getUSBDevices(Fw::USBDeviceType::SerialMain)[0].port, "/dev/ttyACM0");
+
+    ::close(pipeFds[0]);
+    ::close(pipeFds[1]);
+}
+
+TEST(LinuxDiscovery, watcherMountNotification) {
+    // A private mount namespace keeps the tmpfs away from the host and its automounter
+    if (::geteuid() != 0 || ::unshare(CLONE_NEWNS) != 0
+        || ::mount("none", "/", nullptr, MS_REC | MS_PRIVATE, nullptr) != 0)
+    {
+        GTEST_SKIP() << "Needs root to mount in a private namespace";
+    }
+    auto watcher = Fw::DeviceWatcher::create();
+    if (!watcher.has_value()) {
+        GTEST_SKIP() << watcher.error();
+    }
+    ASSERT_TRUE(watcher->poll().has_value());
+    pollfd pfd { .fd = watcher->fd(), .events = POLLIN, .revents = 0 };
+    ASSERT_EQ(::poll(&pfd, 1, 0), 0);
+
+    const auto mountPoint = std::filesystem::temp_directory_path()
+        / ("fwfinder_mount_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(mountPoint);
+    ASSERT_EQ(::mount("tmpfs", mountPoint.c_str(), "tmpfs", 0, nullptr), 0);
+    // The mount alone wakes fd() up, poll() takes the notification
+    ASSERT_EQ(::poll(&pfd, 1, 1000), 1);
+    ASSERT_TRUE(watcher->poll().has_value());
+    ASSERT_EQ(::poll(&pfd, 1, 0), 0);
+
+    ASSERT_EQ(::umount(mountPoint.c_str()), 0);
+    ASSERT_EQ(::poll(&pfd, 1, 1000), 1);
+    ASSERT_TRUE(watcher->poll().has_value());
+    std::filesystem::remove(mountPoint);
+}
+
+TEST(LinuxDiscovery, sysfsBackend) {
+    SysfsFixture sysfs("sysfs_backend");
+    const std::string usb1 = "devices/pci0000:00/0000:00:14.0/usb1";
+    const std::string hub = usb1 + "/1-1";
+    sysfs.usbDevice(usb1, 0x1D6B, 0x0002, "0000:00:14.0");
+    sysfs.usbDevice(hub, Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB, "FX0025");
+    sysfs.usbDevice(hub + "/1-1.1", Fw::USB_VID_FW2_MAIN, Fw::USB_PID_FW2_MAIN, "FX0025");
+    sysfs.acmPort(hub + "/1-1.1", "1-1.1:1.0", "ttyACM0");
+    // Interfaces are listed next to the devices but aren't usb_devices
+    sysfs.write(hub + "/1-1.1/1-1.1:1.0/bInterfaceClass", "02");
+    sysfs.link("bus/usb/devices", hub + "/1-1.1/1-1.1:1.0");
+    sysfs.usbDevice(
+        hub + "/1-1.6",
+        Fw::USB_VID_FW2_MASS_STORAGE,
+        Fw::USB_PID_FW2_MASS_STORAGE,
+        "FX0025"
+    );
+    sysfs.disk(hub + "/1-1.6", "sda", 0);
+    sysfs.write("devices/virtual/tty/tty0/uevent", "DEVNAME=tty0");
+    sysfs.link("class/tty", "devices/virtual/tty/tty0");
+
+    auto table = _scanSysfsDeviceTable(sysfs.root.string());
+    ASSERT_TRUE(table.has_value()) << table.error();
+    const auto devices = (sysfs.root / "sys" / "devices").string();
+    // The root hub isn't part of the FREE-WILi2, only its syspath is kept as the hub parent
+    ASSERT_EQ(table->usbDevices.size(), 3);
+    ASSERT_EQ(table->usbDevices[0].syspath, devices + "/pci0000:00/0000:00:14.0/usb1/1-1");
+    ASSERT_EQ(table->usbDevices[0].parentSyspath, devices + "/pci0000:00/0000:00:14.0/usb1");
+    ASSERT_EQ(table->usbDevices[0].portChain, (std::vector<uint32_t> { 1, 1 }));
+    ASSERT_EQ(table->usbDevices[1].parentSyspath, table->usbDevices[0].syspath);
+    ASSERT_EQ(table->usbDevices[1].portChain, (std::vector<uint32_t> { 1, 1, 1 }));
+    ASSERT_EQ(table->usbDevices[2].location, 6);
+    ASSERT_EQ(table->usbDevices[2].serial, "FX0025");
+    ASSERT_EQ(table->serialPorts.size(), 1);
+    ASSERT_EQ(table->serialPorts[0].ttyName, "/dev/ttyACM0");
+    ASSERT_EQ(table->serialPorts[0].devPath, table->usbDevices[1].syspath);
+    ASSERT_EQ(table->disks.size(), 1);
+    ASSERT_EQ(table->disks[0].devPath, table->usbDevices[2].syspath);
+    ASSERT_EQ(table->disks[0].blockDevices.size(), 2);
+    ASSERT_EQ(table->disks[0].blockDevices[1].devNum, makedev(8, 1));
+
+    ASSERT_FALSE(_scanSysfsDeviceTable((sysfs.root / "missing").string()).has_value());
+}
+
+// The FX0025 capture from usbdef.hpp, replayed through the public API
+TEST(LinuxDiscovery, fixtureFreeWili2FX0025) {
+    SysfsFixture sysfs("fx0025");
+    const std::string usb3 = "devices/pci0000:00/0000:00:14.0/usb3";
+    sysfs.usbDevice(usb3, 0x1D6B, 0x0002, "0000:00:14.0", "xHCI Host Controller");
+    sysfs.usbDevice(usb3 + "/3-4", 0x05E3, 0x0610, "", "USB2.1 Hub");
+    addFreeWili2(sysfs, usb3 + "/3-4/3-4.1", "FX0025", 0);
+
+    auto devices = Fw::find_all(sysfs.options());
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), 1);
+    const auto& device = devices->at(0);
+    ASSERT_EQ(device.deviceType, Fw::DeviceType::FreeWili2);
+    ASSERT_EQ(device.name, "FREE-WILi2");
+    ASSERT_EQ(device.serial, "FX0025");
+    ASSERT_FALSE(device.standalone);
+    ASSERT_EQ(device.usbDevices.size(), 6);
+    ASSERT_EQ(device.getMainUSBDevice().value().port, "/dev/ttyACM0");
+    ASSERT_EQ(device.getFPGAUSBDevice().value().port, "/dev/ttyUSB0");
+    // The debug probe exposes two ports, the first one is reported
+    ASSERT_EQ(device.getDebugProbeUSBDevice().value().port, "/dev/ttyACM1");
+    ASSERT_EQ(device.getESP32USBDevice().value().port, "/dev/ttyACM3");
+    ASSERT_EQ(
+        device.getESP32USBDevice().value().location,
+        static_cast<uint32_t>(Fw::FW2HubPortLocation::ESP32)
+    );
+    auto storage = device.getUSBDevices(Fw::USBDeviceType::MassStorage);
+    ASSERT_EQ(storage.size(), 1);
+    ASSERT_EQ(storage[0].paths, std::vector<std::string> { "/media/fw/FX0025" });
+    ASSERT_EQ(device.getHubUSBDevice().value().portChain, (std::vector<uint32_t> { 3, 4, 1 }));
+}
+
+TEST(LinuxDiscovery, findStats) {
+    SysfsFixture sysfs("stats");
+    const std::string usb3 = "devices/pci0000:00/0000:00:14.0/usb3";
+    sysfs.usbDevice(usb3, 0x1D6B, 0x0002, "0000:00:14.0", "xHCI Host Controller");
+    sysfs.usbDevice(usb3 + "/3-4", 0x05E3, 0x0610, "", "USB2.1 Hub");
+    addFreeWili2(sysfs, usb3 + "/3-4/3-4.1", "FX0025", 0);
+    // Rejected on their VID/PID, nothing else of them is read
+    sysfs.usbDevice(usb3 + "/3-7", 0x0781, 0x5581, "4C530001", "Ultra");
+    sysfs.disk(usb3 + "/3-7", "sdz", 240, "/media/stick");
+    sysfs.usbDevice(usb3 + "/3-8", 0x067B, 0x2303, "", "USB-Serial Controller");
+    sysfs.ftdiPort(usb3 + "/3-8", "3-8:1.0", "ttyUSB9");
+    sysfs.usbDevice(usb3 + "/3-9", 0x046D, 0xC31C, "", "USB Keyboard");
+
+    // Stale values from a previous call are overwritten
+    Fw::FindStats stats { .devicesFound = 42 };
+    auto devices = Fw::find_all(sysfs.options(&stats));
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), 1);
+    ASSERT_EQ(stats.devicesFound, 1);
+    // 11 usb_devices, 6 ttys, 2 disks and their partitions
+    ASSERT_EQ(stats.devicesVisited, 21);
+    // The FREE-WILi2 hub and its 5 children
+    ASSERT_EQ(stats.usbDevicesMatched, 6);
+    // idVendor and idProduct of every usb_device, manufacturer, product and serial of the
+    // matched ones, uevent of their ttys, uevent and dev of their block devices. Reading
+    // everything would take 11 * 5 + 6 + 4 * 2 = 69.
+    ASSERT_EQ(stats.attributeReads, 11 * 2 + 6 * 3 + 5 + 2 * 2);
+    ASSERT_GT(stats.enumerateTime.count(), 0);
+    ASSERT_GT(stats.mountTime.count(), 0);
+    ASSERT_GT(stats.buildTime.count(), 0);
+    ASSERT_GE(stats.resolveTime.count(), 0);
+    ASSERT_LE(
+        stats.enumerateTime + stats.mountTime + stats.resolveTime + stats.buildTime,
+        stats.totalTime
+    );
+
+    // A failed enumeration still reports how long it took
+    auto missingRoot = sysfs.options(&stats);
+    missingRoot.root = "/nonexistent";
+    ASSERT_FALSE(Fw::find_all(missingRoot));
+    ASSERT_EQ(stats.devicesFound, 0);
+    ASSERT_GT(stats.totalTime.count(), 0);
+}
+
+TEST(LinuxDiscovery, targetedLookup) {
+    SysfsFixture sysfs("lookup");
+    addFreeWili2Farm(sysfs, 12);
+    auto devices = Fw::find_all(sysfs.options());
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), 12);
+    const auto& expected = devices->at(7);
+
+    Fw::FindStats stats;
+    auto bySerial = Fw::find_by_serial(expected.serial, sysfs.options(&stats));
+    ASSERT_TRUE(bySerial.has_value()) << bySerial.error();
+    ASSERT_EQ(bySerial->serial, expected.serial);
+    ASSERT_EQ(bySerial->uniqueID, expected.uniqueID);
+    ASSERT_EQ(bySerial->usbDevices, expected.usbDevices);
+    ASSERT_EQ(stats.devicesFound, 1);
+    ASSERT_EQ(stats.usbDevicesMatched, 6);
+    // Identity of every usb_device: 2 roots, 2 keyboards and 12 boards of 6. The serial of
+    // every board, names, ttys and disks of the one looked up only: 6 usb_devices, 5 ttys and
+    // 2 block devices.
+    ASSERT_EQ(stats.attributeReads, (2 + 2 + 12 * 6) * 2 + 12 * 6 + 6 * 2 + 5 + 2 * 2);
+
+    auto byUniqueID = Fw::find_by_unique_id(expected.uniqueID, sysfs.options(&stats));
+    ASSERT_TRUE(byUniqueID.has_value()) << byUniqueID.error();
+    ASSERT_EQ(byUniqueID->serial, expected.serial);
+    ASSERT_EQ(byUniqueID->usbDevices, expected.usbDevices);
+    ASSERT_EQ(stats.usbDevicesMatched, 6);
+    // The port chain gives the unique ID away, no other board gets a string read
+    ASSERT_EQ(stats.attributeReads, (2 + 2 + 12 * 6) * 2 + 6 * 3 + 5 + 2 * 2);
+
+    // Devices are tested in find_all() order and the search stops at the first match
+    const auto hasMassStorage = [](const Fw::FreeWiliDevice& device) {
+        return device.getUSBDevices(Fw::USBDeviceType::MassStorage)[0].paths.has_value();
+    };
+    std::vector<uint64_t> tested;
+    auto first = Fw::find_first(
+        [&](const Fw::FreeWiliDevice& device) {
+            tested.push_back(device.uniqueID);
+            return hasMassStorage(device) && device.serial == devices->at(4).serial;
+        },
+        sysfs.options()
+    );
+    ASSERT_TRUE(first.has_value()) << first.error();
+    ASSERT_EQ(first->uniqueID, devices->at(4).uniqueID);
+    ASSERT_EQ(tested.size(), 5);
+    for (size_t i = 0; i < tested.size(); ++i) {
+        ASSERT_EQ(tested[i], devices->at(i).uniqueID);
+    }
+
+    auto missing = Fw::find_by_serial("FX9999", sysfs.options());
+    ASSERT_FALSE(missing.has_value());
+    ASSERT_EQ(missing.error(), "No FreeWili device with serial FX9999");
+    ASSERT_FALSE(Fw::find_by_unique_id(0, sysfs.options()).has_value());
+    ASSERT_FALSE(Fw::find_first([](const auto&) { return false; }, sysfs.options()));
+    auto missingRoot = sysfs.options();
+    missingRoot.root = "/nonexistent";
+    ASSERT_FALSE(Fw::find_by_serial(expected.serial, missingRoot).has_value());
+}
+
+TEST(LinuxDiscovery, refreshSubtree) {
+    SysfsFixture sysfs("refresh");
+    addFreeWili2Farm(sysfs, 8);
+    const std::string usb3 = "devices/pci0000:00/0000:00:14.0/usb3";
+    sysfs.usbDevice(usb3, 0x1D6B, 0x0002, "0000:00:14.0", "xHCI Host Controller");
+    sysfs.usbDevice(usb3 + "/3-2", Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_WINKY, "W0001", "Winky");
+    sysfs.acmPort(usb3 + "/3-2", "3-2:1.0", "ttyACM90");
+    const auto options = sysfs.options();
+    auto devices = Fw::find_all(options);
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), 9);
+    auto device = *std::find_if(devices->begin(), devices->end(), [](const auto& device) {
+        return device.serial == "FX1003";
+    });
+    const auto mainPort = device.getMainUSBDevice().value().port.value();
+    ASSERT_EQ(mainPort, "/dev/ttyACM12");
+
+    // Flashing re-enumerates the main processor, its tty comes back under another name
+    const auto hub = device.getHubUSBDevice().value()._raw;
+    std::filesystem::remove_all(hub + "/1-4.1/1-4.1:1.0/tty");
+    sysfs.acmPort(
+        std::filesystem::relative(hub, sysfs.root / "sys").string() + "/1-4.1",
+        "1-4.1:1.0",
+        "ttyACM40"
+    );
+    const auto uniqueID = device.uniqueID;
+    Fw::FindStats stats;
+    auto refreshed = Fw::refresh(device, sysfs.options(&stats));
+    ASSERT_TRUE(refreshed.has_value()) << refreshed.error();
+    ASSERT_EQ(device.uniqueID, uniqueID);
+    ASSERT_EQ(device.serial, "FX1003");
+    ASSERT_EQ(device.getMainUSBDevice().value().port, "/dev/ttyACM40");
+    ASSERT_EQ(device.usbDevices.size(), 6);
+    ASSERT_EQ(
+        device.getUSBDevices(Fw::USBDeviceType::MassStorage)[0].paths,
+        std::vector<std::string> { "/media/fw/FX1003" }
+    );
+    // Only the board: 6 usb_devices, 5 ttys, a disk and its partition
+    ASSERT_EQ(stats.devicesVisited, 6 + 5 + 2);
+    ASSERT_EQ(stats.attributeReads, 6 * 5 + 5 + 2 * 2);
+    ASSERT_EQ(stats.devicesFound, 1);
+
+    auto winky = *std::find_if(devices->begin(), devices->end(), [](const auto& device) {
+        return device.standalone;
+    });
+    ASSERT_EQ(winky.deviceType, Fw::DeviceType::Winky);
+    ASSERT_TRUE(Fw::refresh(winky, options).has_value());
+    ASSERT_EQ(winky.getMainUSBDevice().value().port, "/dev/ttyACM90");
+
+    // Unplugged: an error and the device is left as it was
+    std::filesystem::remove_all(hub);
+    const auto before = device;
+    ASSERT_FALSE(Fw::refresh(device, options).has_value());
+    ASSERT_EQ(device.usbDevices, before.usbDevices);
+}
+
+TEST(LinuxDiscovery, waitForMount) {
+    using namespace std::chrono_literals;
+    SysfsFixture sysfs("wait_for_mount");
+    addFreeWili2Farm(sysfs, 2);
+    const auto mountsPath = sysfs.root / "proc" / "mounts";
+    std::stringstream mounts;
+    mounts << std::ifstream(mountsPath).rdbuf();
+    // The automounter isn't done yet
+    std::ofstream(mountsPath, std::ios::trunc);
+    auto devices = Fw::find_all(sysfs.options());
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), 2);
+    const auto device = devices->at(1);
+    ASSERT_TRUE(device.getMassStoragePaths().empty());
+
+    // Nothing gets mounted
+    auto start = std::chrono::steady_clock::now();
+    auto mounted = Fw::wait_for_mount(device, 50ms, sysfs.options());
+    ASSERT_FALSE(mounted.has_value());
+    ASSERT_EQ(mounted.error(), device.name + " was not mounted: timed out");
+    ASSERT_GE(std::chrono::steady_clock::now() - start, 50ms);
+
+    // Mounted while the call waits, the write wakes it up long before the timeout
+    std::thread automounter([&] {
+        std::this_thread::sleep_for(50ms);
+        std::ofstream(mountsPath, std::ios::trunc) << mounts.str();
+    });
+    start = std::chrono::steady_clock::now();
+    mounted = Fw::wait_for_mount(device, 30s, sysfs.options());
+    automounter.join();
+    ASSERT_TRUE(mounted.has_value()) << mounted.error();
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 10s);
+    ASSERT_EQ(mounted->uniqueID, device.uniqueID);
+    ASSERT_EQ(
+        mounted->getMassStoragePaths(),
+        std::vector<std::string> { "/media/fw/" + device.serial }
+    );
+
+    // Already mounted, no waiting
+    ASSERT_TRUE(Fw::wait_for_mount(mounted.value(), 0ms, sysfs.options()).has_value());
+
+    auto noStorage = device;
+    std::erase_if(noStorage.usbDevices, [](const Fw::USBDevice& usbDevice) {
+        return usbDevice.kind == Fw::USBDeviceType::MassStorage;
+    });
+    ASSERT_EQ(
+        Fw::wait_for_mount(noStorage, 0ms, sysfs.options()).error(),
+        device.name + " has no mass storage"
+    );
+}
+
+TEST(LinuxDiscovery, discoveryCache) {
+    SysfsFixture sysfs("cache");
+    addFreeWili2Farm(sysfs, 2);
+    Fw::FindStats stats;
+    Fw::DiscoveryCache cache(sysfs.options(&stats));
+    ASSERT_EQ(cache.generation(), 0);
+    ASSERT_TRUE(cache.isStale());
+
+    // Concurrent callers share a single scan
+    std::vector<std::shared_ptr<const Fw::DiscoverySnapshot>> snapshots(4);
+    std::vector<std::thread> threads;
+    for (auto& snapshot: snapshots) {
+        threads.emplace_back([&cache, &snapshot] { snapshot = cache.snapshot().value(); });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    for (const auto& snapshot: snapshots) {
+        ASSERT_EQ(snapshot, snapshots.front());
+    }
+    ASSERT_EQ(snapshots.front()->generation, 1);
+    ASSERT_EQ(snapshots.front()->devices.size(), 2);
+    ASSERT_FALSE(cache.isStale());
+    stats.devicesFound = 42;
+    ASSERT_EQ(cache.snapshot().value(), snapshots.front());
+    ASSERT_EQ(stats.devicesFound, 42);
+
+    // A board is plugged in
+    const std::string usb3 = "devices/pci0000:00/0000:00:14.0/usb3";
+    sysfs.usbDevice(usb3, 0x1D6B, 0x0002, "0000:00:14.0", "xHCI Host Controller");
+    addFreeWili2(sysfs, usb3 + "/3-1", "FX0025", 2);
+    ASSERT_TRUE(cache.isStale());
+    ASSERT_TRUE(cache.isStale());
+    auto devices = cache.find_all();
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), 3);
+    ASSERT_EQ(cache.generation(), 2);
+    ASSERT_EQ(stats.devicesFound, 3);
+    // The snapshot handed out earlier is left alone
+    ASSERT_EQ(snapshots.front()->devices.size(), 2);
+
+    // Its disk is mounted somewhere else
+    std::ofstream(sysfs.root / "proc" / "mounts", std::ios::app)
+        << "/dev/sdc1 /media/elsewhere vfat rw 0 0\n";
+    auto remounted = cache.snapshot().value();
+    ASSERT_EQ(remounted->generation, 3);
+    auto board = std::find_if(remounted->devices.begin(), remounted->devices.end(), [](auto& d) {
+        return d.serial == "FX0025";
+    });
+    ASSERT_EQ(
+        board->getUSBDevices(Fw::USBDeviceType::MassStorage)[0].paths,
+        (std::vector<std::string> { "/media/fw/FX0025", "/media/elsewhere" })
+    );
+
+    cache.invalidate();
+    ASSERT_TRUE(cache.isStale());
+    ASSERT_EQ(cache.snapshot().value()->generation, 4);
+}
+
+// Thousands of fake devices on a plain CI box, deterministic across runs
+TEST(LinuxDiscovery, parallelSysfsScan) {
+    const size_t hubCount = 40;
+    SysfsFixture sysfs("parallel");
+    addFreeWili2Farm(sysfs, hubCount);
+
+    Fw::FindStats serialStats;
+    auto serial = Fw::find_all(sysfs.options(&serialStats));
+    ASSERT_TRUE(serial.has_value()) << serial.error();
+    ASSERT_EQ(serial->size(), hubCount);
+    // More threads than items, a few, and one per core
+    for (size_t threads: std::array<size_t, 4> { 3, 8, 500, 0 }) {
+        Fw::FindStats stats;
+        auto devices = Fw::find_all(sysfs.options(&stats, threads));
+        ASSERT_TRUE(devices.has_value()) << devices.error();
+        ASSERT_EQ(devices->size(), serial->size());
+        for (size_t i = 0; i < devices->size(); ++i) {
+            ASSERT_EQ(devices->at(i).uniqueID, serial->at(i).uniqueID);
+            ASSERT_EQ(devices->at(i).serial, serial->at(i).serial);
+            ASSERT_EQ(devices->at(i).usbDevices, serial->at(i).usbDevices);
+        }
+        ASSERT_EQ(stats.attributeReads, serialStats.attributeReads);
+        ASSERT_EQ(stats.devicesVisited, serialStats.devicesVisited);
+    }
+
+    // Targeted lookups narrow the parallel scan down the same way
+    auto device = Fw::find_by_serial("FX1017", sysfs.options(nullptr, 4));
+    ASSERT_TRUE(device.has_value()) << device.error();
+    ASSERT_EQ(device->serial, "FX1017");
+}
+
+// Allocations grow with what the scan reads and reports, not with anything else it touches.
+// A visited sysfs entry costs its resolved path, its lookup slot and the attributes kept
+// from it. A reported USBDevice costs its name, serial, paths and port chain, once in the
+// device table and once in the FreeWiliDevice built from it.
+TEST(LinuxDiscovery, findAllAllocationsBounded) {
+    constexpr size_t perVisitedEntry = 6;
+    constexpr size_t perReportedUsbDevice = 8;
+    // The sysfs root, the mount table and the result vector
+    constexpr size_t perScan = 100;
+    auto check = [&](size_t hubCount) {
+        SysfsFixture sysfs("allocations_" + std::to_string(hubCount));
+        addFreeWili2Farm(sysfs, hubCount);
+        Fw::FindStats stats;
+        const auto options = sysfs.options(&stats);
+        AllocationCounter counter;
+        auto devices = Fw::find_all(options);
+        auto count = counter.count();
+        ASSERT_TRUE(devices.has_value()) << devices.error();
+        ASSERT_EQ(devices->size(), hubCount);
+        size_t usbDevices = 0;
+        for (const auto& device: devices.value()) {
+            usbDevices += device.usbDevices.size();
+        }
+        EXPECT_LE(
+            count,
+            stats.devicesVisited * perVisitedEntry + usbDevices * perReportedUsbDevice + perScan
+        );
+    };
+    check(8);
+    check(16);
+}
+
+TEST(LinuxDiscovery, findAllIntoArena) {
+    SysfsFixture sysfs("arena");
+    addFreeWili2Farm(sysfs, 4);
+    const auto options = sysfs.options();
+    auto devices = Fw::find_all(options);
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+
+    std::pmr::monotonic_buffer_resource arena;
+    auto compact = Fw::find_all(&arena, options);
+    ASSERT_TRUE(compact.has_value()) << compact.error();
+    EXPECT_EQ(compact->get_allocator().resource(), &arena);
+    auto restored = compact->toFreeWiliDevices();
+    ASSERT_TRUE(restored.has_value()) << restored.error();
+    ASSERT_EQ(restored->size(), devices->size());
+    for (size_t i = 0; i < devices->size(); ++i) {
+        ASSERT_EQ(restored->at(i).serial, devices->at(i).serial);
+        ASSERT_EQ(restored->at(i).usbDevices, devices->at(i).usbDevices);
+    }
+
+    std::stop_source stop;
+    stop.request_stop();
+    auto cancelledOptions = sysfs.options();
+    cancelledOptions.stop = stop.get_token();
+    auto cancelled = Fw::find_all(&arena, cancelledOptions);
+    ASSERT_FALSE(cancelled.has_value());
+    ASSERT_EQ(cancelled.error(), "Discovery was cancelled");
+}
+
+// Smallest coroutine that can co_await, it starts right away and nobody waits for it
+struct FireAndForget {
+    struct promise_type {
+        auto get_return_object() noexcept -> FireAndForget {
+            return {};
+        }
+        auto initial_suspend() noexcept -> std::suspend_never {
+            return {};
+        }
+        auto final_suspend() noexcept -> std::suspend_never {
+            return {};
+        }
+        auto return_void() noexcept -> void {}
+        auto unhandled_exception() noexcept -> void {
+            std::terminate();
+        }
+    };
+};
+
+TEST(LinuxDiscovery, findAllAsync) {
+    using namespace std::chrono_literals;
+    SysfsFixture sysfs("async");
+    addFreeWili2Farm(sysfs, 12);
+    const auto options = sysfs.options(nullptr, 2);
+    auto expected = Fw::find_all(options);
+    ASSERT_TRUE(expected.has_value()) << expected.error();
+    ASSERT_EQ(expected->size(), 12);
+
+    auto future = Fw::find_all_async(options);
+    ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    auto devices = future.get();
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices.value(), expected.value());
+
+    // More scans than library threads queue up and all get their result
+    std::vector<std::future<std::expected<Fw::FreeWiliDevices, std::string>>> queued;
+    for (int i = 0; i < 8; ++i) {
+        queued.push_back(Fw::find_all_async(options));
+    }
+    for (auto& scan: queued) {
+        ASSERT_EQ(scan.wait_for(10s), std::future_status::ready);
+        ASSERT_EQ(scan.get(), expected);
+    }
+
+    std::stop_source stop;
+    stop.request_stop();
+    auto cancelledOptions = sysfs.options();
+    cancelledOptions.stop = stop.get_token();
+    auto cancelled = Fw::find_all_async(cancelledOptions).get();
+    ASSERT_FALSE(cancelled.has_value());
+    ASSERT_EQ(cancelled.error(), "Discovery was cancelled");
+    // The synchronous call shares the engine, and the cancellation
+    Fw::FindOptions liveOptions {};
+    liveOptions.stop = stop.get_token();
+    ASSERT_EQ(Fw::find_all(liveOptions).error(), "Discovery was cancelled");
+
+    // Resumed through an executor like asio::post(), here a handle picked up by the test thread
+    std::mutex mutex;
+    std::condition_variable posted;
+    std::coroutine_handle<> handle;
+    std::promise<std::expected<Fw::FreeWiliDevices, std::string>> awaited;
+    auto post = [&](std::coroutine_handle<> suspended) {
+        std::lock_guard lock(mutex);
+        handle = suspended;
+        posted.notify_one();
+    };
+    auto scan = [&]() -> FireAndForget {
+        awaited.set_value(co_await Fw::find_all_awaitable(options, post));
+    };
+    scan();
+    {
+        std::unique_lock lock(mutex);
+        ASSERT_TRUE(posted.wait_for(lock, 5s, [&] { return static_cast<bool>(handle); }));
+    }
+    auto result = awaited.get_future();
+    ASSERT_EQ(result.wait_for(0s), std::future_status::timeout);
+    handle.resume();
+    ASSERT_EQ(result.wait_for(0s), std::future_status::ready);
+    auto awaitedDevices = result.get();
+    ASSERT_TRUE(awaitedDevices.has_value()) << awaitedDevices.error();
+    ASSERT_EQ(awaitedDevices.value(), expected.value());
+}
+
+TEST(LinuxDiscovery, fixtureScale) {
+    const size_t hubCount = 500;
+    SysfsFixture sysfs("scale");
+    addFreeWili2Farm(sysfs, hubCount);
+
+    auto devices = Fw::find_all(sysfs.options());
+    ASSERT_TRUE(devices.has_value()) << devices.error();
+    ASSERT_EQ(devices->size(), hubCount);
+    for (size_t i = 1; i < devices->size(); ++i) {
+        ASSERT_LT(devices->at(i - 1).uniqueID, devices->at(i).uniqueID);
+    }
+    for (const auto& device: devices.value()) {
+        ASSERT_EQ(device.deviceType, Fw::DeviceType::FreeWili2);
+        ASSERT_EQ(device.usbDevices.size(), 6);
+        ASSERT_TRUE(device.getMainUSBDevice().value().port.has_value());
+        ASSERT_EQ(
+            device.getUSBDevices(Fw::USBDeviceType::MassStorage)[0].paths,
+            std::vector<std::string> { "/media/fw/" + device.serial }
+        );
+    }
+    auto again = Fw::find_all(sysfs.options());
+    ASSERT_TRUE(again.has_value());
+    ASSERT_EQ(again.value(), devices.value());
+}
+
+#endif // __linux__
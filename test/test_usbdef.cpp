@@ -2,6 +2,10 @@
 
 #include <usbdef.hpp>
 
+#include <iterator>
+#include <tuple>
+#include <vector>
+
 TEST(USBVidPidMatch, BasicAssertions) {
     ASSERT_EQ(Fw::USB_VID_FW_HUB, 0x0424);
     ASSERT_EQ(Fw::USB_PID_FW_HUB, 0x2513);
@@ -60,3 +64,52 @@ TEST(USBVidPidMatch, IsFreeWiliHub) {
     ASSERT_FALSE(Fw::is_freewili_hub(Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW_HUB));
     ASSERT_FALSE(Fw::is_freewili_hub(0, 0));
 }
+
+TEST(USBVidPidMatch, DescriptorTable) {
+    // Pairs a FreeWili is made of and what they classify as, the table must cover exactly these
+    const std::vector<std::tuple<uint16_t, uint16_t, Fw::USBDeviceType>> expected = {
+        { Fw::USB_VID_FW_HUB, Fw::USB_PID_FW_HUB, Fw::USBDeviceType::Hub },
+        { Fw::USB_VID_FW_FTDI, Fw::USB_PID_FW_FTDI, Fw::USBDeviceType::FTDI },
+        { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_CDC_PID, Fw::USBDeviceType::Serial },
+        { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_2040_UF2_PID, Fw::USBDeviceType::MassStorage },
+        { Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_2350_UF2_PID, Fw::USBDeviceType::MassStorage },
+        { Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_MAIN_CDC_PID, Fw::USBDeviceType::SerialMain },
+        { Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_DISPLAY_CDC_PID, Fw::USBDeviceType::SerialDisplay },
+        { Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_WINKY, Fw::USBDeviceType::SerialMain },
+        { Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_DEFCON_2024, Fw::USBDeviceType::SerialMain },
+        { Fw::USB_VID_FW_ICS, Fw::USB_PID_FW_DEFCON_BADGE_2025, Fw::USBDeviceType::SerialMain },
+        { Fw::USB_VID_FW2_HUB, Fw::USB_PID_FW2_HUB, Fw::USBDeviceType::Hub },
+        { Fw::USB_VID_FW2_MAIN, Fw::USB_PID_FW2_MAIN, Fw::USBDeviceType::SerialMain },
+        { Fw::USB_VID_FW2_DISPLAY, Fw::USB_PID_FW2_DISPLAY, Fw::USBDeviceType::SerialDisplay },
+        { Fw::USB_VID_FW2_DEBUG_PROBE,
+          Fw::USB_PID_FW2_DEBUG_PROBE,
+          Fw::USBDeviceType::DebugProbe },
+        { Fw::USB_VID_FW2_ESP32, Fw::USB_PID_FW2_ESP32_JTAG, Fw::USBDeviceType::ESP32 },
+        { Fw::USB_VID_FW2_MASS_STORAGE,
+          Fw::USB_PID_FW2_MASS_STORAGE,
+          Fw::USBDeviceType::MassStorage },
+    };
+    ASSERT_EQ(std::size(Fw::KnownUSBDevices), expected.size());
+    for (const auto& [vid, pid, kind]: expected) {
+        const auto* descriptor = Fw::find_usb_descriptor(vid, pid);
+        ASSERT_NE(descriptor, nullptr) << std::hex << vid << ":" << pid;
+        ASSERT_EQ(descriptor->kind, kind) << std::hex << vid << ":" << pid;
+        ASSERT_TRUE(Fw::is_vid_pid_whitelisted(vid, pid));
+    }
+
+    // Only the badges, Winky and the RP2350 bootloader enumerate on their own
+    size_t standalone = 0;
+    for (const auto& descriptor: Fw::KnownUSBDevices) {
+        ASSERT_EQ(descriptor.standalone, Fw::isStandAloneDevice(descriptor.vid, descriptor.pid));
+        standalone += descriptor.standalone ? 1 : 0;
+    }
+    ASSERT_EQ(standalone, 4);
+    ASSERT_TRUE(Fw::isStandAloneDevice(Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_2350_UF2_PID));
+    ASSERT_FALSE(Fw::isStandAloneDevice(Fw::USB_VID_FW_RPI, Fw::USB_PID_FW_RPI_2040_UF2_PID));
+
+    // The CP210x bridge isn't part of any FreeWili the finder reports
+    ASSERT_FALSE(
+        Fw::is_vid_pid_whitelisted(Fw::USB_VID_FW_ESP32_SERIAL, Fw::USB_PID_FW_ESP32_SERIAL)
+    );
+    ASSERT_EQ(Fw::find_usb_descriptor(0x046D, 0xC31C), nullptr);
+}